@@ -0,0 +1,1027 @@
+// Headless rendering benchmarks. Every scenario is deterministic (fixed
+// geometry, fixed seeds) and writes one JSON object to the report:
+//   xve_bench [--frames N] [--warmup N] [--size WxH] [--out bench.json]
+//             [scenario[=count] ...]
+// With no scenarios named, all of them run with their default counts. The
+// exit status is non-zero when an argument is malformed or a scenario's
+// correctness checks fail.
+
+#include "xve_bench_harness.hpp"
+#include "config.h"
+#include "xve_args.hpp"
+#include "xve_compute_pipeline.hpp"
+#include "xve_dynamic_uniforms.hpp"
+#include "xve_mesh_optimizer.hpp"
+#include "xve_model.hpp"
+#include "xve_pipeline_cache.hpp"
+#include "xve_pipeline_manager.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+struct XveBenchOptions {
+  uint32_t frames = 300;
+  uint32_t warmupFrames = 30;
+  uint32_t width = 1280;
+  uint32_t height = 720;
+  std::string outPath = "bench.json";
+  /// Scenario name and count; a count of 0 means the scenario's default.
+  std::vector<std::pair<std::string, uint64_t>> scenarios;
+  /// Where the engine log goes once the logging scenario is done with it.
+  LoggerWriteFn logWriter;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+/// Indexed grid of `triangleCount` triangles covering most of clip space.
+static XveModel::Builder makeGrid(uint64_t triangleCount) {
+  auto quadCount = (triangleCount + 1) / 2;
+  auto columns = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(std::sqrt(quadCount))));
+  auto rows = (quadCount + columns - 1) / columns;
+
+  XveModel::Builder builder{};
+  for (uint64_t y = 0; y <= rows; y++) {
+    for (uint64_t x = 0; x <= columns; x++) {
+      float u = static_cast<float>(x) / columns;
+      float v = static_cast<float>(y) / rows;
+      builder.vertices.push_back(
+          {{u * 1.8f - 0.9f, v * 1.8f - 0.9f, 0.0f}, {u, v, 0.5f}});
+    }
+  }
+
+  auto stride = static_cast<uint32_t>(columns + 1);
+  for (uint64_t t = 0; t < triangleCount; t++) {
+    auto quad = t / 2;
+    auto base = static_cast<uint32_t>((quad / columns) * stride +
+                                      quad % columns);
+    if (t % 2 == 0) {
+      builder.indices.insert(builder.indices.end(),
+                             {base, base + stride, base + 1});
+    } else {
+      builder.indices.insert(builder.indices.end(),
+                             {base + 1, base + stride, base + stride + 1});
+    }
+  }
+  return builder;
+}
+
+static XveModel::Builder makeTriangle() {
+  XveModel::Builder builder{};
+  builder.vertices = {
+      {{0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+      {{0.5f, 0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+      {{-0.5f, 0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+  };
+  return builder;
+}
+
+/// One model of `count` triangles in a single draw: vertex throughput.
+static XveBenchResult benchTriangles(XveBenchHarness &harness,
+                                     const XveBenchOptions &options,
+                                     uint64_t count) {
+  XveBenchResult result{.name = "triangles", .count = count};
+
+  auto start = Clock::now();
+  XveModel model{harness.getGeometryPool(), harness.getUploadManager(),
+                 makeGrid(count)};
+  harness.getUploadManager().waitIdle();
+  result.metrics.push_back({"load_ms", elapsedMs(start)});
+
+  std::vector<XveDrawCommand> draws{
+      harness.draw(harness.getPipeline(), &model)};
+  harness.renderFrames(draws, options.frames, options.warmupFrames, result);
+  harness.collect(result);
+  return result;
+}
+
+/// `count` draws of one triangle: per-draw CPU recording cost, recorded with
+/// 1, 2, 4, ... workers up to the default thread count. The frame times
+/// and scopes reported are those of the last (widest) run.
+static XveBenchResult benchDrawCalls(XveBenchHarness &harness,
+                                     const XveBenchOptions &options,
+                                     uint64_t count) {
+  XveBenchResult result{.name = "draw_calls", .count = count};
+
+  XveModel model{harness.getGeometryPool(), harness.getUploadManager(),
+                 makeTriangle()};
+  harness.getUploadManager().waitIdle();
+
+  std::vector<XveDrawCommand> draws(
+      count, harness.draw(harness.getPipeline(), &model));
+
+  std::vector<uint32_t> threadCounts;
+  auto maxThreads = XveThreadPool::defaultThreadCount();
+  for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  auto originalThreads = harness.getRecorderThreadCount();
+  std::vector<std::pair<std::string, double>> recordMetrics;
+  for (auto threads : threadCounts) {
+    harness.setRecorderThreadCount(threads);
+    result = XveBenchResult{.name = "draw_calls", .count = count};
+    harness.renderFrames(draws, options.frames, options.warmupFrames,
+                         result);
+    harness.collect(result);
+    for (auto &scope : result.scopes) {
+      if (!scope.gpu && scope.name == "record") {
+        recordMetrics.push_back(
+            {std::format("threads_{}_record_avg_ms", threads), scope.avgMs});
+        recordMetrics.push_back(
+            {std::format("threads_{}_record_p99_ms", threads), scope.p99Ms});
+      }
+    }
+  }
+  harness.setRecorderThreadCount(originalThreads);
+
+  result.metrics = std::move(recordMetrics);
+  return result;
+}
+
+/// `count` copies of one triangle from a single instanced draw, against the
+/// same instance data drawn with one draw call per copy.
+static XveBenchResult benchInstances(XveBenchHarness &harness,
+                                     const XveBenchOptions &options,
+                                     uint64_t count) {
+  XveBenchResult result{.name = "instances", .count = count};
+  auto &device = harness.getDevice();
+  auto &uploadManager = harness.getUploadManager();
+
+  XveModel model{harness.getGeometryPool(), uploadManager, makeTriangle()};
+
+  auto columns = static_cast<uint32_t>(
+      std::ceil(std::sqrt(static_cast<double>(count))));
+  auto cellSize = 2.0f / columns;
+  std::vector<XveModel::Instance> instances(count);
+  for (uint32_t i = 0; i < count; i++) {
+    auto &instance = instances[i];
+    instance.transform[0][0] = cellSize / 2.0f;
+    instance.transform[1][1] = cellSize / 2.0f;
+    instance.transform[2][2] = cellSize / 2.0f;
+    instance.transform[3] =
+        glm::vec4{-1.0f + cellSize * (i % columns + 0.5f),
+                  -1.0f + cellSize * (i / columns + 0.5f), 0.0f, 1.0f};
+  }
+
+  vk::Buffer instanceBuffer;
+  XveAllocation instanceAllocation;
+  uploadManager.createDeviceLocalBuffer(
+      instances.data(), sizeof(XveModel::Instance) * count,
+      vk::BufferUsageFlagBits::eVertexBuffer, instanceBuffer,
+      instanceAllocation);
+  uploadManager.waitIdle();
+
+  std::vector<XveDrawCommand> perDraw;
+  perDraw.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    perDraw.push_back({harness.getPipeline(), &model, instanceBuffer, 0, i});
+  }
+  XveBenchResult baseline{.name = "instances_per_draw", .count = count};
+  harness.renderFrames(perDraw, options.frames, options.warmupFrames,
+                       baseline);
+  harness.collect(baseline);
+
+  std::vector<XveDrawCommand> instanced{
+      {harness.getPipeline(), &model, instanceBuffer, 0, 0,
+       static_cast<uint32_t>(count)}};
+  harness.renderFrames(instanced, options.frames, options.warmupFrames,
+                       result);
+  harness.collect(result);
+
+  result.metrics.push_back(
+      {"per_draw_p50_ms", baseline.frameTimes.percentile(0.5)});
+  result.metrics.push_back(
+      {"per_draw_p99_ms", baseline.frameTimes.percentile(0.99)});
+  for (auto &scope : baseline.scopes) {
+    if (!scope.gpu && scope.name == "record") {
+      result.metrics.push_back({"per_draw_record_avg_ms", scope.avgMs});
+    }
+  }
+
+  device.destroyBuffer(instanceBuffer, instanceAllocation);
+  return result;
+}
+
+/// `count` objects on a grid twice the size of the screen, so about three
+/// quarters fall outside the frustum. Culled and drawn on the GPU, against
+/// drawing all of them as CPU-built instanced batches. Half the objects are
+/// triangles and half quads, so the culler handles more than one batch.
+static XveBenchResult benchGpuCulling(XveBenchHarness &harness,
+                                      const XveBenchOptions &options,
+                                      uint64_t count) {
+  XveBenchResult result{.name = "gpu_culling", .count = count};
+  if (!XveGpuCuller::isSupported(harness.getDevice())) {
+    result.metrics.push_back({"supported", 0.0});
+    return result;
+  }
+  auto &device = harness.getDevice();
+  auto &uploadManager = harness.getUploadManager();
+
+  auto triangle = makeTriangle();
+  triangle.optimize();
+  XveModel triangleModel{harness.getGeometryPool(), uploadManager, triangle};
+  XveModel quadModel{harness.getGeometryPool(), uploadManager, makeGrid(2)};
+  auto half = static_cast<uint32_t>(count / 2);
+
+  auto columns = static_cast<uint32_t>(
+      std::ceil(std::sqrt(static_cast<double>(count))));
+  auto cellSize = 4.0f / columns;
+  std::vector<XveGpuCuller::Object> objects(count);
+  std::vector<XveModel::Instance> instances(count);
+  for (uint32_t i = 0; i < count; i++) {
+    auto &object = objects[i];
+    object.model = i < half ? &triangleModel : &quadModel;
+    object.transform[0][0] = cellSize / 2.0f;
+    object.transform[1][1] = cellSize / 2.0f;
+    object.transform[2][2] = cellSize / 2.0f;
+    object.transform[3] =
+        glm::vec4{-2.0f + cellSize * (i % columns + 0.5f),
+                  -2.0f + cellSize * (i / columns + 0.5f), 0.0f, 1.0f};
+    instances[i] = {object.transform, object.color};
+  }
+
+  vk::Buffer instanceBuffer;
+  XveAllocation instanceAllocation;
+  uploadManager.createDeviceLocalBuffer(
+      instances.data(), sizeof(XveModel::Instance) * count,
+      vk::BufferUsageFlagBits::eVertexBuffer, instanceBuffer,
+      instanceAllocation);
+  XveGpuCuller culler{device, uploadManager,
+                      harness.getTarget().getFramesInFlight(), objects};
+  uploadManager.waitIdle();
+
+  XveBenchResult baseline{.name = "gpu_culling_baseline", .count = count};
+  std::vector<XveDrawCommand> instanced{
+      {harness.getPipeline(), &triangleModel, instanceBuffer, 0, 0, half},
+      {harness.getPipeline(), &quadModel, instanceBuffer, 0, half,
+       static_cast<uint32_t>(count) - half}};
+  harness.renderFrames(instanced, options.frames, options.warmupFrames,
+                       baseline);
+
+  harness.setGpuCuller(&culler);
+  harness.renderFrames({}, options.frames, options.warmupFrames, result);
+  harness.setGpuCuller(nullptr);
+  harness.collect(result);
+
+  result.metrics.push_back({"supported", 1.0});
+  result.metrics.push_back(
+      {"unculled_p50_ms", baseline.frameTimes.percentile(0.5)});
+  result.metrics.push_back(
+      {"unculled_p99_ms", baseline.frameTimes.percentile(0.99)});
+
+  device.destroyBuffer(instanceBuffer, instanceAllocation);
+  return result;
+}
+
+/// Builds `count` pipeline permutations through an XvePipelineCache with no
+/// file on disk, saves it, then builds them again after loading it back the
+/// way startup does. Draws with all of them to measure state changes.
+static XveBenchResult benchPipelines(XveBenchHarness &harness,
+                                     const XveBenchOptions &options,
+                                     uint64_t count) {
+  XveBenchResult result{.name = "pipelines", .count = count};
+  auto &device = harness.getDevice();
+
+  // Depth bias is baked into the pipeline, so each value is a distinct
+  // compile without changing the shaders.
+  std::vector<PipelineConfigInfo> configs;
+  for (uint64_t i = 0; i < count; i++) {
+    auto config = harness.pipelineConfig();
+    config.rasterizationInfo.depthBiasEnable = VK_TRUE;
+    config.rasterizationInfo.depthBiasConstantFactor =
+        static_cast<float>(i + 1);
+    configs.push_back(config);
+  }
+
+  // Kept apart from the game's cache so neither run disturbs the other.
+  std::filesystem::path cachePath = PIPELINE_CACHE_FILE;
+  cachePath += ".bench";
+  std::filesystem::remove(cachePath);
+
+  std::vector<std::unique_ptr<XvePipeline>> pipelines;
+  for (auto pass : {"cold", "warm"}) {
+    pipelines.clear();
+    // Startup cost: loading and validating the file, then compiling. The
+    // cache saves itself when it goes out of scope.
+    auto start = Clock::now();
+    XvePipelineCache cache{device.getPhysicalDevice(), device.getDevice(),
+                           cachePath};
+    for (auto &config : configs) {
+      pipelines.push_back(std::make_unique<XvePipeline>(
+          device, SIMPLE_SHADER_VERT, SIMPLE_SHADER_FRAG, config,
+          cache.get()));
+    }
+    auto ms = elapsedMs(start);
+    result.metrics.push_back({std::format("{}_startup_ms", pass), ms});
+    result.metrics.push_back(
+        {std::format("{}_ms_per_pipeline", pass), ms / count});
+  }
+
+  std::error_code error;
+  auto cacheBytes = std::filesystem::file_size(cachePath, error);
+  if (error) {
+    result.failures.push_back(
+        std::format("Pipeline cache was not saved to {}", cachePath.string()));
+  } else {
+    result.metrics.push_back(
+        {"cache_file_kb", static_cast<double>(cacheBytes) / 1024.0});
+  }
+  std::filesystem::remove(cachePath, error);
+
+  XveModel model{harness.getGeometryPool(), harness.getUploadManager(),
+                 makeTriangle()};
+  harness.getUploadManager().waitIdle();
+
+  std::vector<XveDrawCommand> draws;
+  for (auto &pipeline : pipelines) {
+    draws.push_back(harness.draw(pipeline.get(), &model));
+  }
+  harness.renderFrames(draws, options.frames, options.warmupFrames, result);
+  harness.collect(result);
+  return result;
+}
+
+/// `count` pipeline permutations compiled by XvePipelineManager with 1, 2,
+/// 4, ... workers up to the default thread count, waiting on every handle.
+/// Each run gets its own permutations so none is served from the cache
+/// filled by another.
+static XveBenchResult benchPipelineThreads(XveBenchHarness &harness,
+                                           const XveBenchOptions &,
+                                           uint64_t count) {
+  // Wall time with more workers must beat one worker by at least this much.
+  static constexpr double MIN_SPEEDUP = 1.1;
+
+  XveBenchResult result{.name = "pipeline_threads", .count = count};
+  auto &device = harness.getDevice();
+
+  std::vector<uint32_t> threadCounts;
+  auto maxThreads = XveThreadPool::defaultThreadCount();
+  for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  double singleThreadMs = 0.0;
+  double bestMs = 0.0;
+  for (size_t run = 0; run < threadCounts.size(); run++) {
+    auto threads = threadCounts[run];
+    std::vector<PipelineConfigInfo> configs;
+    for (uint64_t i = 0; i < count; i++) {
+      auto config = harness.pipelineConfig();
+      config.rasterizationInfo.depthBiasEnable = VK_TRUE;
+      config.rasterizationInfo.depthBiasConstantFactor =
+          static_cast<float>(run * count + i + 1);
+      configs.push_back(config);
+    }
+
+    XvePipelineManager manager{device, threads};
+    auto start = Clock::now();
+    std::vector<XvePipelineHandle> handles;
+    for (auto &config : configs) {
+      handles.push_back(
+          manager.request(SIMPLE_SHADER_VERT, SIMPLE_SHADER_FRAG, config));
+    }
+    uint64_t failed = 0;
+    for (auto &handle : handles) {
+      handle.wait();
+      failed += handle.hasFailed();
+    }
+    auto ms = elapsedMs(start);
+
+    if (failed > 0) {
+      result.failures.push_back(std::format(
+          "{} of {} pipelines failed with {} threads", failed, count,
+          threads));
+    }
+    result.metrics.push_back({std::format("threads_{}_ms", threads), ms});
+    if (threads == 1) {
+      singleThreadMs = ms;
+      bestMs = ms;
+    } else {
+      bestMs = std::min(bestMs, ms);
+      result.metrics.push_back(
+          {std::format("threads_{}_speedup", threads), singleThreadMs / ms});
+    }
+  }
+
+  if (maxThreads > 1 && singleThreadMs < bestMs * MIN_SPEEDUP) {
+    result.failures.push_back(std::format(
+        "Compile time doesn't scale: {:.1f} ms on 1 thread, best {:.1f} ms "
+        "on up to {}",
+        singleThreadMs, bestMs, maxThreads));
+  }
+  harness.collect(result);
+  return result;
+}
+
+/// `count` 1k-triangle models through the upload manager into the geometry
+/// pool, half of them freed and the pool compacted, then the rest drawn.
+static XveBenchResult benchUploads(XveBenchHarness &harness,
+                                   const XveBenchOptions &options,
+                                   uint64_t count) {
+  XveBenchResult result{.name = "model_uploads", .count = count};
+  auto &uploadManager = harness.getUploadManager();
+  auto grid = makeGrid(1000);
+
+  auto bytesBefore = uploadManager.getStats().bytesUploaded;
+  auto stallsBefore = uploadManager.getStats().stallCount;
+  auto start = Clock::now();
+  std::vector<std::unique_ptr<XveModel>> models;
+  for (uint64_t i = 0; i < count; i++) {
+    models.push_back(std::make_unique<XveModel>(harness.getGeometryPool(),
+                                                uploadManager, grid));
+  }
+  uploadManager.waitIdle();
+  auto ms = elapsedMs(start);
+
+  auto bytes = uploadManager.getStats().bytesUploaded - bytesBefore;
+  result.metrics.push_back({"upload_ms", ms});
+  result.metrics.push_back({"upload_mb", bytes / (1024.0 * 1024.0)});
+  result.metrics.push_back(
+      {"upload_mb_per_s", bytes / (1024.0 * 1024.0) / (ms / 1000.0)});
+  result.metrics.push_back(
+      {"staging_stalls",
+       static_cast<double>(uploadManager.getStats().stallCount -
+                           stallsBefore)});
+
+  // Freeing every other model leaves the pool as fragmented as it gets;
+  // compaction then packs the survivors back together.
+  auto &pool = harness.getGeometryPool();
+  for (uint64_t i = 0; i < models.size(); i += 2) {
+    models[i].reset();
+  }
+  std::erase(models, nullptr);
+  result.metrics.push_back(
+      {"pool_fragmentation", pool.getStats().vertices.fragmentation()});
+  start = Clock::now();
+  auto compactedBytes = pool.compact(uploadManager);
+  result.metrics.push_back({"compact_ms", elapsedMs(start)});
+  result.metrics.push_back(
+      {"compact_mb", compactedBytes / (1024.0 * 1024.0)});
+  result.metrics.push_back(
+      {"pool_fragmentation_compacted",
+       pool.getStats().vertices.fragmentation()});
+
+  std::vector<XveDrawCommand> draws;
+  for (auto &model : models) {
+    draws.push_back(harness.draw(harness.getPipeline(), model.get()));
+  }
+  harness.renderFrames(draws, options.frames, options.warmupFrames, result);
+  harness.collect(result);
+  return result;
+}
+
+/// `count` resizes, each followed by a frame. Headless runs have no
+/// swapchain, so this rebuilds the offscreen target's attachments instead.
+static XveBenchResult benchRecreate(XveBenchHarness &harness,
+                                    const XveBenchOptions &, uint64_t count) {
+  XveBenchResult result{.name = "recreate", .count = count};
+  auto &target = harness.getTarget();
+  auto original = target.getExtent();
+  auto half = vk::Extent2D{original.width / 2, original.height / 2};
+
+  XveModel model{harness.getGeometryPool(), harness.getUploadManager(),
+                 makeTriangle()};
+  harness.getUploadManager().waitIdle();
+  std::vector<XveDrawCommand> draws{
+      harness.draw(harness.getPipeline(), &model)};
+
+  XveHistogram recreateTimes{0.01, 10000};
+  for (uint64_t i = 0; i < count; i++) {
+    auto start = Clock::now();
+    target.recreate(i % 2 == 0 ? half : original);
+    recreateTimes.record(elapsedMs(start));
+    harness.renderFrame(draws);
+    result.frameTimes.record(elapsedMs(start));
+    result.frames++;
+  }
+  if (target.getExtent().width != original.width) {
+    target.recreate(original);
+  }
+  harness.getDevice().getDevice().waitIdle();
+
+  result.metrics.push_back({"recreate_avg_ms", recreateTimes.mean()});
+  result.metrics.push_back(
+      {"recreate_p99_ms", recreateTimes.percentile(0.99)});
+  result.metrics.push_back({"recreate_max_ms", recreateTimes.max()});
+  harness.collect(result);
+  return result;
+}
+
+/// `count` random allocate/free calls of mixed sizes, alignments and
+/// resource kinds. The sequence runs once timed, then again with every
+/// allocation checked for alignment and overlap; both runs must hand all
+/// memory back.
+static XveBenchResult benchAllocator(XveBenchHarness &harness,
+                                     const XveBenchOptions &,
+                                     uint64_t count) {
+  static constexpr size_t MAX_LIVE = 4096;
+  static constexpr size_t MAX_REPORTED_FAILURES = 10;
+  // Past half the default block size, so these get dedicated blocks.
+  static constexpr vk::DeviceSize LARGE_SIZE = 48ull * 1024 * 1024;
+
+  XveBenchResult result{.name = "allocator", .count = count};
+  auto &device = harness.getDevice();
+  // A private allocator starts out empty, so its stats must end that way.
+  XveMemoryAllocator allocator{device.getPhysicalDevice(), device.getDevice()};
+
+  auto memoryProperties = device.getPhysicalDevice().getMemoryProperties();
+  uint32_t memoryTypeIndex = 0;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if (memoryProperties.memoryTypes[i].propertyFlags &
+        vk::MemoryPropertyFlagBits::eDeviceLocal) {
+      memoryTypeIndex = i;
+      break;
+    }
+  }
+
+  uint64_t violations = 0;
+  auto fail = [&](std::string message) {
+    if (violations++ < MAX_REPORTED_FAILURES) {
+      result.failures.push_back(std::move(message));
+    }
+  };
+
+  // Live ranges by memory and offset, mapped to their end.
+  std::map<std::pair<vk::DeviceMemory, vk::DeviceSize>, vk::DeviceSize>
+      ranges;
+  auto check = [&](const XveAllocation &allocation,
+                   const vk::MemoryRequirements &requirements) {
+    if (allocation.offset % requirements.alignment != 0) {
+      fail(std::format("Offset {} not aligned to {}", allocation.offset,
+                       requirements.alignment));
+    }
+    if (allocation.size < requirements.size) {
+      fail(std::format("Got {} bytes for {} requested", allocation.size,
+                       requirements.size));
+    }
+    auto key = std::pair{allocation.memory, allocation.offset};
+    auto end = allocation.offset + allocation.size;
+    auto next = ranges.lower_bound(key);
+    if (next != ranges.end() && next->first.first == allocation.memory &&
+        next->first.second < end) {
+      fail(std::format("[{}, {}) overlaps a range at {}", allocation.offset,
+                       end, next->first.second));
+    }
+    if (next != ranges.begin()) {
+      auto previous = std::prev(next);
+      if (previous->first.first == allocation.memory &&
+          previous->second > allocation.offset) {
+        fail(std::format("[{}, {}) overlaps a range ending at {}",
+                         allocation.offset, end, previous->second));
+      }
+    }
+    ranges[key] = end;
+  };
+
+  auto run = [&](bool validate) {
+    std::mt19937 random{42};
+    std::uniform_int_distribution<vk::DeviceSize> sizes{256, 256 * 1024};
+    std::vector<XveAllocation> live;
+    live.reserve(MAX_LIVE);
+
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+      bool allocate = live.empty() ||
+                      (live.size() < MAX_LIVE && random() % 2 == 0);
+      if (allocate) {
+        auto kind = random() % 2 == 0
+                        ? XveMemoryAllocator::ResourceKind::Linear
+                        : XveMemoryAllocator::ResourceKind::Optimal;
+        // 16 bytes up to 64 KiB, the range buffers and images ask for.
+        auto alignment = vk::DeviceSize{16} << (random() % 13);
+        auto size = random() % 1024 == 0 ? LARGE_SIZE : sizes(random);
+        auto requirements =
+            vk::MemoryRequirements{size, alignment, 1u << memoryTypeIndex};
+        live.push_back(
+            allocator.allocate(requirements, memoryTypeIndex, kind));
+        if (validate) {
+          check(live.back(), requirements);
+        }
+      } else {
+        auto index = random() % live.size();
+        std::swap(live[index], live.back());
+        if (validate) {
+          ranges.erase({live.back().memory, live.back().offset});
+        }
+        allocator.free(live.back());
+        live.pop_back();
+      }
+    }
+    auto ms = elapsedMs(start);
+
+    if (!validate) {
+      // Taken with the survivors still allocated, so fragmentation
+      // reflects the churn.
+      result.memory = allocator.getStats();
+      result.metrics.push_back({"ns_per_op", ms * 1e6 / count});
+      result.metrics.push_back(
+          {"fragmentation", result.memory.fragmentation()});
+    }
+
+    for (auto &allocation : live) {
+      allocator.free(allocation);
+    }
+    ranges.clear();
+    allocator.trim();
+    auto stats = allocator.getStats();
+    if (stats.usedBytes != 0 || stats.allocationCount != 0 ||
+        stats.blockCount != 0) {
+      fail(std::format("{} bytes in {} allocations and {} blocks left after "
+                       "freeing everything",
+                       stats.usedBytes, stats.allocationCount,
+                       stats.blockCount));
+    }
+  };
+  run(false);
+  run(true);
+
+  result.metrics.push_back({"violations", static_cast<double>(violations)});
+  result.scopes = harness.getProfiler().getSummaries();
+  return result;
+}
+
+/// ACMR of a `count`-triangle grid in shuffled order, before and after
+/// optimizeVertexCache().
+static XveBenchResult benchMeshOptimizer(XveBenchHarness &harness,
+                                         const XveBenchOptions &,
+                                         uint64_t count) {
+  XveBenchResult result{.name = "mesh_optimizer", .count = count};
+  auto grid = makeGrid(count);
+  auto vertexCount = static_cast<uint32_t>(grid.vertices.size());
+
+  std::vector<uint32_t> order(count);
+  for (uint32_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937{42});
+  std::vector<uint32_t> indices;
+  indices.reserve(grid.indices.size());
+  for (auto triangle : order) {
+    indices.insert(indices.end(), grid.indices.begin() + triangle * 3,
+                   grid.indices.begin() + triangle * 3 + 3);
+  }
+
+  result.metrics.push_back(
+      {"acmr_before", XveMeshOptimizer::computeAcmr(indices, vertexCount)});
+  auto start = Clock::now();
+  auto optimized =
+      XveMeshOptimizer::optimizeVertexCache(indices, vertexCount);
+  result.metrics.push_back({"optimize_ms", elapsedMs(start)});
+  result.metrics.push_back(
+      {"acmr_after", XveMeshOptimizer::computeAcmr(optimized, vertexCount)});
+
+  harness.collect(result);
+  return result;
+}
+
+/// `count` Info messages; the log output is discarded while it runs.
+static XveBenchResult benchLogging(XveBenchHarness &harness,
+                                   const XveBenchOptions &options,
+                                   uint64_t count) {
+  XveBenchResult result{.name = "logging", .count = count};
+
+  Logger::flush();
+  Logger::setWriteFunction([](const std::string &) {});
+
+  Logger logger;
+  auto start = Clock::now();
+  for (uint64_t i = 0; i < count; i++) {
+    logger.log(LogLevel::Info, "Benchmark message {} of {}: {:.3f}", i,
+               count, i * 0.5);
+  }
+  auto callMs = elapsedMs(start);
+  Logger::flush();
+  auto totalMs = elapsedMs(start);
+
+  Logger::setWriteFunction(options.logWriter);
+
+  result.metrics.push_back({"ns_per_log", callMs * 1e6 / count});
+  result.metrics.push_back({"ns_per_log_flushed", totalMs * 1e6 / count});
+  harness.collect(result);
+  return result;
+}
+
+/// `count` 256-byte payloads, past what push constants can carry, pushed
+/// through XveDynamicUniforms and bound at their offsets for a compute
+/// dispatch each. The shader copies every payload out, and each copy must
+/// match what was pushed.
+static XveBenchResult benchDynamicUniforms(XveBenchHarness &harness,
+                                           const XveBenchOptions &,
+                                           uint64_t count) {
+  static constexpr size_t MAX_REPORTED_FAILURES = 10;
+
+  struct Payload {
+    glm::vec4 values[16];
+  };
+  struct Slot {
+    uint32_t slot;
+  };
+
+  XveBenchResult result{.name = "dynamic_uniforms", .count = count};
+  auto &device = harness.getDevice();
+
+  // Offsets are aligned to at most 256 bytes, the largest alignment limit
+  // the spec allows, so this always fits.
+  std::vector<std::unique_ptr<XveFrameContext>> frames;
+  frames.push_back(std::make_unique<XveFrameContext>(
+      device, (count + 1) * std::max<vk::DeviceSize>(sizeof(Payload), 256)));
+  auto &frame = *frames.front();
+  XveDynamicUniforms uniforms{device, frames, sizeof(Payload),
+                              vk::ShaderStageFlagBits::eCompute};
+
+  vk::Buffer copyBuffer;
+  XveAllocation copyAllocation;
+  device.createBuffer(sizeof(Payload) * count,
+                      vk::BufferUsageFlagBits::eStorageBuffer,
+                      vk::MemoryPropertyFlagBits::eHostVisible |
+                          vk::MemoryPropertyFlagBits::eHostCoherent,
+                      copyBuffer, copyAllocation);
+
+  auto copyBinding = vk::DescriptorSetLayoutBinding{
+      0, vk::DescriptorType::eStorageBuffer, 1,
+      vk::ShaderStageFlagBits::eCompute};
+  auto copyLayout = device.getDevice().createDescriptorSetLayout(
+      vk::DescriptorSetLayoutCreateInfo{vk::DescriptorSetLayoutCreateFlags(),
+                                        1, &copyBinding});
+  std::array<vk::DescriptorSetLayout, 2> setLayouts{uniforms.getLayout(),
+                                                    copyLayout};
+  auto pushConstantRange = XvePipeline::pushConstantRange<Slot>(
+      vk::ShaderStageFlagBits::eCompute);
+  auto pipelineLayout = device.getDevice().createPipelineLayout(
+      vk::PipelineLayoutCreateInfo{
+          vk::PipelineLayoutCreateFlags(),
+          static_cast<uint32_t>(setLayouts.size()),
+          setLayouts.data(),
+          1,
+          &pushConstantRange,
+      });
+  XveComputePipeline pipeline{device, UNIFORM_COPY_SHADER_COMP,
+                              pipelineLayout};
+
+  frame.begin();
+  auto copySet = frame.allocateDescriptorSet(copyLayout);
+  auto copyInfo = vk::DescriptorBufferInfo{copyBuffer, 0, VK_WHOLE_SIZE};
+  device.getDevice().updateDescriptorSets(
+      vk::WriteDescriptorSet{copySet, 0, 0, 1,
+                             vk::DescriptorType::eStorageBuffer, nullptr,
+                             &copyInfo},
+      {});
+
+  std::vector<Payload> payloads(count);
+  for (uint64_t i = 0; i < count; i++) {
+    for (uint32_t j = 0; j < 16; j++) {
+      payloads[i].values[j] = glm::vec4{static_cast<float>(i),
+                                        static_cast<float>(j), 1.0f, 2.0f};
+    }
+  }
+
+  auto cmd = frame.getCommandBuffer();
+  cmd.begin(vk::CommandBufferBeginInfo{
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  pipeline.bind(cmd);
+  cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 1,
+                         copySet, {});
+  auto start = Clock::now();
+  for (uint64_t i = 0; i < count; i++) {
+    auto offset = uniforms.push(frame, payloads[i]);
+    uniforms.bind(cmd, 0, pipelineLayout, 0, offset,
+                  vk::PipelineBindPoint::eCompute);
+    XvePipeline::pushConstants(cmd, pipelineLayout,
+                               vk::ShaderStageFlagBits::eCompute,
+                               Slot{static_cast<uint32_t>(i)});
+    cmd.dispatch(1, 1, 1);
+  }
+  auto recordMs = elapsedMs(start);
+  auto barrier = vk::MemoryBarrier{vk::AccessFlagBits::eShaderWrite,
+                                   vk::AccessFlagBits::eHostRead};
+  cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                      vk::PipelineStageFlagBits::eHost, {}, barrier, {},
+                      {});
+  cmd.end();
+
+  device.getGraphicsQueue().submit(vk::SubmitInfo{0, nullptr, nullptr, 1,
+                                                  &cmd});
+  device.getDevice().waitIdle();
+
+  auto *copies = static_cast<const Payload *>(copyAllocation.mappedData);
+  uint64_t mismatches = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    if (std::memcmp(&copies[i], &payloads[i], sizeof(Payload)) != 0 &&
+        mismatches++ < MAX_REPORTED_FAILURES) {
+      result.failures.push_back(
+          std::format("payload {} read back different data", i));
+    }
+  }
+
+  result.metrics.push_back(
+      {"payload_bytes", static_cast<double>(sizeof(Payload))});
+  result.metrics.push_back({"ns_per_push_bind", recordMs * 1e6 / count});
+  result.metrics.push_back(
+      {"dynamic_bytes_used",
+       static_cast<double>(frame.getDynamicBytesUsed())});
+  result.metrics.push_back({"mismatches", static_cast<double>(mismatches)});
+
+  device.getDevice().destroyPipelineLayout(pipelineLayout);
+  device.getDevice().destroyDescriptorSetLayout(copyLayout);
+  device.destroyBuffer(copyBuffer, copyAllocation);
+  return result;
+}
+
+struct XveBenchScenario {
+  const char *name;
+  uint64_t defaultCount;
+  XveBenchResult (*run)(XveBenchHarness &, const XveBenchOptions &,
+                        uint64_t);
+};
+
+static constexpr XveBenchScenario SCENARIOS[] = {
+    {"triangles", 1000000, benchTriangles},
+    {"draw_calls", 10000, benchDrawCalls},
+    {"instances", 100000, benchInstances},
+    {"gpu_culling", 100000, benchGpuCulling},
+    {"pipelines", 64, benchPipelines},
+    {"pipeline_threads", 200, benchPipelineThreads},
+    {"model_uploads", 1000, benchUploads},
+    {"recreate", 100, benchRecreate},
+    {"allocator", 100000, benchAllocator},
+    {"dynamic_uniforms", 1000, benchDynamicUniforms},
+    {"mesh_optimizer", 100000, benchMeshOptimizer},
+    {"logging", 100000, benchLogging},
+};
+
+static std::string toJson(const XveBenchResult &result) {
+  auto &frameTimes = result.frameTimes;
+  std::string json = std::format(
+      "    {{\n"
+      "      \"name\": \"{}\",\n"
+      "      \"count\": {},\n"
+      "      \"frames\": {},\n"
+      "      \"frame_ms\": {{\"min\": {:.4f}, \"mean\": {:.4f}, "
+      "\"p50\": {:.4f}, \"p90\": {:.4f}, \"p99\": {:.4f}, "
+      "\"max\": {:.4f}}},\n",
+      result.name, result.count, result.frames, frameTimes.min(),
+      frameTimes.mean(), frameTimes.percentile(0.5),
+      frameTimes.percentile(0.9), frameTimes.percentile(0.99),
+      frameTimes.max());
+
+  json += "      \"scopes\": [";
+  for (size_t i = 0; i < result.scopes.size(); i++) {
+    auto &scope = result.scopes[i];
+    json += std::format(
+        "{}\n        {{\"name\": \"{}\", \"gpu\": {}, \"count\": {}, "
+        "\"min_ms\": {:.4f}, \"avg_ms\": {:.4f}, \"p99_ms\": {:.4f}}}",
+        i == 0 ? "" : ",", scope.name, scope.gpu, scope.count, scope.minMs,
+        scope.avgMs, scope.p99Ms);
+  }
+  json += result.scopes.empty() ? "],\n" : "\n      ],\n";
+
+  auto &memory = result.memory;
+  json += std::format(
+      "      \"memory\": {{\"reserved_bytes\": {}, \"used_bytes\": {}, "
+      "\"blocks\": {}, \"dedicated_blocks\": {}, \"allocations\": {}}},\n",
+      memory.reservedBytes, memory.usedBytes, memory.blockCount,
+      memory.dedicatedBlockCount, memory.allocationCount);
+
+  json += "      \"metrics\": {";
+  for (size_t i = 0; i < result.metrics.size(); i++) {
+    json += std::format("{}\"{}\": {:.4f}", i == 0 ? "" : ", ",
+                        result.metrics[i].first, result.metrics[i].second);
+  }
+  json += "},\n      \"failures\": [";
+  for (size_t i = 0; i < result.failures.size(); i++) {
+    json += std::format("{}\"{}\"", i == 0 ? "" : ", ", result.failures[i]);
+  }
+  json += "]\n    }";
+  return json;
+}
+
+/// Empty, after printing what was wrong, on any malformed argument.
+static std::optional<XveBenchOptions> parseOptions(int argc, char **argv) {
+  XveBenchOptions options;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    auto argIndex = i;
+    bool hasValue = i + 1 < argc;
+    bool valid = true;
+    if (arg == "--frames" && hasValue) {
+      valid = parseNumber(argv[++i], options.frames);
+    } else if (arg == "--warmup" && hasValue) {
+      valid = parseNumber(argv[++i], options.warmupFrames);
+    } else if (arg == "--out" && hasValue) {
+      options.outPath = argv[++i];
+    } else if (arg == "--size" && hasValue) {
+      valid = parseSize(argv[++i], options.width, options.height);
+    } else if (!arg.starts_with("--")) {
+      auto equals = arg.find('=');
+      uint64_t count = 0;
+      if (equals != std::string_view::npos) {
+        valid = parseNumber(arg.substr(equals + 1), count);
+      }
+      options.scenarios.push_back({std::string{arg.substr(0, equals)}, count});
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+    }
+
+    if (!valid) {
+      std::cerr << "Invalid argument: " << arg
+                << (i != argIndex ? " " + std::string{argv[i]} : "") << "\n"
+                << "Usage: xve_bench [--frames N] [--warmup N] [--size WxH] "
+                   "[--out bench.json] [scenario[=count] ...]"
+                << std::endl;
+      return std::nullopt;
+    }
+  }
+
+  if (options.scenarios.empty()) {
+    for (auto &scenario : SCENARIOS) {
+      options.scenarios.push_back({scenario.name, 0});
+    }
+  }
+  return options;
+}
+
+int main(int argc, char **argv) {
+  auto parsed = parseOptions(argc, argv);
+  if (!parsed) {
+    return 1;
+  }
+  auto &options = *parsed;
+
+  std::ofstream logFile{"xve_bench.log"};
+  options.logWriter = [&logFile](const std::string &batch) {
+    logFile << batch;
+  };
+  Logger::setWriteFunction(options.logWriter);
+
+  int status = 0;
+  try {
+    XveBenchHarness harness{vk::Extent2D{options.width, options.height}};
+
+    std::vector<std::string> results;
+    for (auto &[name, count] : options.scenarios) {
+      auto scenario = std::find_if(
+          std::begin(SCENARIOS), std::end(SCENARIOS),
+          [&name](const XveBenchScenario &s) { return name == s.name; });
+      if (scenario == std::end(SCENARIOS)) {
+        std::cerr << "Unknown scenario: " << name << std::endl;
+        status = 1;
+        continue;
+      }
+
+      auto result = scenario->run(harness, options,
+                                  count ? count : scenario->defaultCount);
+      std::cout << std::format("{:<16} n={:<8} p50 {:.3f} ms, p99 {:.3f} ms",
+                               result.name, result.count,
+                               result.frameTimes.percentile(0.5),
+                               result.frameTimes.percentile(0.99))
+                << std::endl;
+      for (auto &failure : result.failures) {
+        std::cerr << result.name << ": " << failure << std::endl;
+        status = 1;
+      }
+      results.push_back(toJson(result));
+    }
+
+    std::ofstream out{options.outPath, std::ios::trunc};
+    if (!out.is_open()) {
+      throw std::runtime_error(
+          std::format("Failed to open {}", options.outPath));
+    }
+    out << std::format("{{\n  \"engine\": \"{} {}.{}.{}\",\n"
+                       "  \"frames\": {},\n  \"scenarios\": [\n",
+                       ENGINE_NAME, ENGINE_VMAJOR, ENGINE_VMINOR,
+                       ENGINE_VPATCH, options.frames);
+    for (size_t i = 0; i < results.size(); i++) {
+      out << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+  } catch (const std::exception &e) {
+    Logger().log(LogLevel::Error, "{}", e.what());
+    std::cerr << e.what() << std::endl;
+    status = 1;
+  }
+
+  Logger::shutdown();
+  Logger::setWriteFunction(nullptr);
+  logFile.close();
+  return status;
+}
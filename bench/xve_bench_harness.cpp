@@ -0,0 +1,194 @@
+#include "xve_bench_harness.hpp"
+#include "config.h"
+#include <array>
+#include <format>
+#include <stdexcept>
+
+XveBenchHarness::XveBenchHarness(vk::Extent2D extent,
+                                 uint32_t framesInFlight,
+                                 uint32_t recorderThreads)
+    : device(nullptr), target(device, extent, framesInFlight),
+      profiler(device, framesInFlight),
+      commandRecorder(std::make_unique<XveCommandRecorder>(
+          device, framesInFlight, recorderThreads)) {
+  target.setProfiler(&profiler);
+
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    frames.push_back(std::make_unique<XveFrameContext>(device));
+  }
+
+  auto layoutInfo = vk::PipelineLayoutCreateInfo{
+      vk::PipelineLayoutCreateFlags(), 0, nullptr, 0, nullptr,
+  };
+  pipelineLayout = device.getDevice().createPipelineLayout(layoutInfo);
+
+  pipeline = std::make_unique<XvePipeline>(device, SIMPLE_SHADER_VERT,
+                                           SIMPLE_SHADER_FRAG,
+                                           pipelineConfig());
+
+  XveModel::Instance identity{};
+  uploadManager.createDeviceLocalBuffer(
+      &identity, sizeof(identity), vk::BufferUsageFlagBits::eVertexBuffer,
+      identityInstanceBuffer, identityInstanceAllocation);
+  uploadManager.waitIdle();
+
+  log(LogLevel::Info, "Benchmarking on {} ({})",
+      device.getPhysicalDevice().getProperties().deviceName.data(),
+      target.describe());
+}
+
+XveBenchHarness::~XveBenchHarness() {
+  device.getDevice().waitIdle();
+  pipeline.reset();
+  device.destroyBuffer(identityInstanceBuffer, identityInstanceAllocation);
+  device.getDevice().destroyPipelineLayout(pipelineLayout);
+}
+
+void XveBenchHarness::setRecorderThreadCount(uint32_t threads) {
+  if (threads == commandRecorder->threadCount()) {
+    return;
+  }
+  device.getDevice().waitIdle();
+  commandRecorder.reset();
+  commandRecorder = std::make_unique<XveCommandRecorder>(
+      device, target.getFramesInFlight(), threads);
+}
+
+PipelineConfigInfo XveBenchHarness::pipelineConfig() const {
+  auto extent = target.getExtent();
+  auto config =
+      XvePipeline::defaultPipelineConfigInfo(extent.width, extent.height);
+  config.renderPass = target.getRenderPass();
+  config.pipelineLayout = pipelineLayout;
+  return config;
+}
+
+void XveBenchHarness::renderFrames(const std::vector<XveDrawCommand> &draws,
+                                   uint32_t frameCount,
+                                   uint32_t warmupFrames,
+                                   XveBenchResult &result) {
+  for (uint32_t i = 0; i < warmupFrames; i++) {
+    renderFrame(draws);
+  }
+  device.getDevice().waitIdle();
+  profiler.reset();
+
+  // Frame time is start-to-start, so with frames in flight it settles at
+  // whichever of the CPU and GPU is slower.
+  auto last = Clock::now();
+  for (uint32_t i = 0; i < frameCount; i++) {
+    renderFrame(draws);
+    auto now = Clock::now();
+    result.frameTimes.record(
+        std::chrono::duration<double, std::milli>(now - last).count());
+    last = now;
+  }
+  device.getDevice().waitIdle();
+  result.frames += frameCount;
+}
+
+void XveBenchHarness::renderFrame(const std::vector<XveDrawCommand> &draws) {
+  XVE_PROFILE_SCOPE(profiler, "frame");
+
+  uint32_t imageIndex;
+  auto result = target.acquireNextImage(&imageIndex);
+  if (result != vk::Result::eSuccess) {
+    throw std::runtime_error(std::format("Failed to acquire image: {}",
+                                         vk::to_string(result)));
+  }
+
+  auto frameIndex = target.getCurrentFrame();
+  auto &frame = *frames[frameIndex];
+  frame.begin();
+  profiler.beginFrame(frameIndex);
+  recordCommandBuffer(frameIndex, imageIndex, draws);
+
+  auto cmd = frame.getCommandBuffer();
+  result = target.submitCommandBuffers(&cmd, &imageIndex);
+  if (result != vk::Result::eSuccess) {
+    throw std::runtime_error(std::format("Failed to submit frame: {}",
+                                         vk::to_string(result)));
+  }
+}
+
+void XveBenchHarness::recordCommandBuffer(
+    uint32_t frameIndex, uint32_t imageIndex,
+    const std::vector<XveDrawCommand> &draws) {
+  XVE_PROFILE_SCOPE(profiler, "record");
+
+  std::vector<vk::CommandBuffer> secondaryBuffers;
+  if (!gpuCuller) {
+    auto inheritanceInfo = vk::CommandBufferInheritanceInfo{
+        target.getRenderPass(),
+        0,
+        target.getFramebuffer(imageIndex, frameIndex),
+    };
+
+    commandRecorder->beginFrame(frameIndex);
+    secondaryBuffers = commandRecorder->record(frameIndex, inheritanceInfo,
+                                               target.getExtent(), draws);
+  }
+
+  try {
+    auto cmd = frames[frameIndex]->getCommandBuffer();
+
+    auto beginInfo = vk::CommandBufferBeginInfo{
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+    };
+    cmd.begin(beginInfo);
+    profiler.resetQueries(cmd);
+    auto gpuFrameScope = profiler.beginGpuScope(cmd, "frame");
+    if (gpuCuller) {
+      XveProfiler::GpuScope cullScope{profiler, cmd, "cull"};
+      gpuCuller->cull(cmd, frameIndex, cullViewProjection);
+    }
+
+    // With MSAA the multisampled color is attachment 2 and is cleared too.
+    std::array<vk::ClearValue, 3> clearValues{};
+    clearValues[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue{1.0f, 0};
+    clearValues[2].color = clearValues[0].color;
+    auto clearValueCount =
+        target.getSampleCount() != vk::SampleCountFlagBits::e1 ? 3u : 2u;
+
+    auto renderPassInfo = vk::RenderPassBeginInfo{
+        target.getRenderPass(),
+        target.getFramebuffer(imageIndex, frameIndex),
+        {
+            vk::Offset2D{0, 0},
+            target.getExtent(),
+        },
+        clearValueCount,
+        clearValues.data(),
+    };
+
+    if (gpuCuller) {
+      auto extent = target.getExtent();
+      cmd.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+      cmd.setViewport(0, vk::Viewport{0.0f, 0.0f,
+                                      static_cast<float>(extent.width),
+                                      static_cast<float>(extent.height),
+                                      0.0f, 1.0f});
+      cmd.setScissor(0, vk::Rect2D{vk::Offset2D{0, 0}, extent});
+      gpuCuller->draw(cmd, frameIndex, *pipeline);
+    } else {
+      cmd.beginRenderPass(renderPassInfo,
+                          vk::SubpassContents::eSecondaryCommandBuffers);
+      if (!secondaryBuffers.empty()) {
+        cmd.executeCommands(secondaryBuffers);
+      }
+    }
+    cmd.endRenderPass();
+
+    profiler.endGpuScope(cmd, gpuFrameScope);
+    cmd.end();
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(
+        std::format("Failed to record command buffer. Error: {}", e.what()));
+  }
+}
+
+void XveBenchHarness::collect(XveBenchResult &result) {
+  result.scopes = profiler.getSummaries();
+  result.memory = device.getAllocator().getStats();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_command_recorder.hpp"
+#include "xve_device.hpp"
+#include "xve_frame_context.hpp"
+#include "xve_geometry_pool.hpp"
+#include "xve_gpu_culler.hpp"
+#include "xve_histogram.hpp"
+#include "xve_memory_allocator.hpp"
+#include "xve_offscreen_target.hpp"
+#include "xve_pipeline.hpp"
+#include "xve_profiler.hpp"
+#include "xve_upload_manager.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// What one scenario reports. Frame times cover only the measured frames;
+/// scope summaries are the profiler's rolling window over the same frames.
+struct XveBenchResult {
+  std::string name;
+  uint64_t count = 0;
+  uint32_t frames = 0;
+  // 10 us buckets up to 100 ms; headless frames are often well under 1 ms.
+  XveHistogram frameTimes{0.01, 10000};
+  std::vector<XveProfiler::ScopeSummary> scopes;
+  XveAllocatorStats memory;
+  /// Scenario-specific numbers, written in order.
+  std::vector<std::pair<std::string, double>> metrics;
+  /// Correctness checks that failed; any makes xve_bench exit non-zero.
+  std::vector<std::string> failures;
+};
+
+/// Headless device, offscreen target and the per-frame machinery XveApp
+/// uses, shared by every scenario so runs differ only in what they draw.
+class XveBenchHarness : Logger {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  XveBenchHarness(
+      vk::Extent2D extent, uint32_t framesInFlight = 2,
+      uint32_t recorderThreads = XveThreadPool::defaultThreadCount());
+  ~XveBenchHarness();
+
+  XveBenchHarness(const XveBenchHarness &) = delete;
+  XveBenchHarness &operator=(const XveBenchHarness &) = delete;
+
+  XveDevice &getDevice() { return device; }
+  XveUploadManager &getUploadManager() { return uploadManager; }
+  XveGeometryPool &getGeometryPool() { return geometryPool; }
+  XveOffscreenTarget &getTarget() { return target; }
+  XveProfiler &getProfiler() { return profiler; }
+
+  /// Rebuilds the command recorder with `threads` workers. Waits for the
+  /// GPU, since in-flight frames use the old recorder's command pools.
+  void setRecorderThreadCount(uint32_t threads);
+  uint32_t getRecorderThreadCount() const {
+    return commandRecorder->threadCount();
+  }
+
+  /// Default config for the harness's render pass and an empty layout.
+  PipelineConfigInfo pipelineConfig() const;
+  /// The simple shader pipeline every scenario draws with by default.
+  XvePipeline *getPipeline() const { return pipeline.get(); }
+
+  /// A single untransformed, white instance of `model`.
+  XveDrawCommand draw(XvePipeline *drawPipeline, XveModel *model) const {
+    return {drawPipeline, model, identityInstanceBuffer};
+  }
+
+  /// While set, frames ignore their draw list and render `culler`'s objects
+  /// with the default pipeline instead.
+  void setGpuCuller(XveGpuCuller *culler,
+                    const glm::mat4 &viewProjection = glm::mat4{1.0f}) {
+    gpuCuller = culler;
+    cullViewProjection = viewProjection;
+  }
+
+  /// Renders `warmupFrames` unmeasured frames, resets the profiler, then
+  /// renders `frameCount` frames into `result`.
+  void renderFrames(const std::vector<XveDrawCommand> &draws,
+                    uint32_t frameCount, uint32_t warmupFrames,
+                    XveBenchResult &result);
+
+  /// One frame, timed by the profiler as "frame", "record" and "submit".
+  void renderFrame(const std::vector<XveDrawCommand> &draws);
+
+  /// Fills in the profiler summaries and allocator stats. Call while the
+  /// scenario's resources are still alive.
+  void collect(XveBenchResult &result);
+
+private:
+  XveDevice device;
+  XveOffscreenTarget target;
+  XveProfiler profiler;
+  XveUploadManager uploadManager{device};
+  XveGeometryPool geometryPool{device, sizeof(XveModel::Vertex)};
+  std::unique_ptr<XveCommandRecorder> commandRecorder;
+  std::vector<std::unique_ptr<XveFrameContext>> frames;
+  vk::PipelineLayout pipelineLayout;
+  std::unique_ptr<XvePipeline> pipeline;
+  vk::Buffer identityInstanceBuffer;
+  XveAllocation identityInstanceAllocation;
+  XveGpuCuller *gpuCuller = nullptr;
+  glm::mat4 cullViewProjection{1.0f};
+
+  void recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex,
+                           const std::vector<XveDrawCommand> &draws);
+};
@@ -1,22 +0,0 @@
-#pragma once
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#define APP_NAME "Game"
-#define APP_VMAJOR 1
-#define APP_VMINOR 0
-#define APP_VPATCH 0
-
-#define ENGINE_NAME "XVEngine"
-#define ENGINE_VMAJOR 1
-#define ENGINE_VMINOR 0
-#define ENGINE_VPATCH 0
-
-#define SIMPLE_SHADER_VERT "/home/klvdmyyy/Desktop/Game/build/simple_shader.vert.spv"
-#define SIMPLE_SHADER_FRAG "/home/klvdmyyy/Desktop/Game/build/simple_shader.frag.spv"
-
-#ifdef __cplusplus
-}
-#endif
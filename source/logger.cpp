@@ -1,12 +1,361 @@
 #include "logger.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 
-static LoggerWriteFn gWriteFn = [](const std::string &msg) {
-  std::cout << msg << std::endl;
+namespace {
+
+constexpr size_t SLOT_TEXT_SIZE = 240;
+constexpr size_t RING_SLOTS = 512;
+
+/// A message occupies one or more consecutive slots; only the first carries
+/// the header, continuation slots are raw text.
+struct Slot {
+  uint64_t sequence;
+  uint32_t length;
+  uint16_t slotCount;
+  bool binary;
+  char text[SLOT_TEXT_SIZE];
+};
+
+/// Single-producer (the owning thread), single-consumer (the writer).
+struct ThreadRing {
+  std::array<Slot, RING_SLOTS> slots;
+  alignas(64) std::atomic<uint64_t> head{0};
+  alignas(64) std::atomic<uint64_t> tail{0};
+  std::atomic<bool> orphaned{false};
+};
+
+void writeToStdout(const std::string &batch) {
+  std::fwrite(batch.data(), 1, batch.size(), stdout);
+  std::fflush(stdout);
+}
+
+class LogBackend {
+public:
+  LogBackend() : writer([this]() { writerLoop(); }) {}
+  ~LogBackend() { shutdown(); }
+
+  /// Binary records go to the binary log file, text ones to writeFn.
+  void submit(std::string_view message, bool binary = false);
+  void setWriteFunction(LoggerWriteFn writeFn);
+  bool openBinaryFile(const std::string &filepath);
+  void flush();
+  void shutdown();
+
+private:
+  std::mutex registryMutex;
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+
+  std::atomic<uint64_t> nextSequence{0};
+  std::atomic<uint64_t> writtenCount{0};
+  std::atomic<bool> running{true};
+
+  std::mutex sinkMutex;
+  LoggerWriteFn writeFn = writeToStdout;
+  std::ofstream binaryFile;
+
+  // Declared last so it starts after everything above is initialized.
+  std::thread writer;
+
+  ThreadRing &threadRing();
+  void writeSynchronously(std::string_view message, bool binary);
+  void writeBinary(std::string_view frames);
+  /// Writes pending records in sequence order. With `holdBack`, stops at
+  /// the first sequence number still being published by its thread, so
+  /// order holds across batches too. Returns whether anything was written.
+  bool drain(bool holdBack = true);
+  void writerLoop();
 };
 
+struct ThreadRingHandle {
+  std::shared_ptr<ThreadRing> ring;
+  ~ThreadRingHandle() {
+    if (ring) {
+      ring->orphaned.store(true, std::memory_order_release);
+    }
+  }
+};
+
+uint64_t steadyNowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/// Maps format strings and class names to the ids stored in binary records.
+/// A new entry's definition record is queued before the id is handed out.
+struct InternTable {
+  std::mutex mutex;
+  std::unordered_map<std::string, uint32_t> ids;
+
+  uint32_t intern(XveBinaryLog::RecordKind kind, std::string_view value);
+};
+
+InternTable gFormatStrings;
+InternTable gNames;
+
+LogBackend &backend() {
+  static LogBackend instance;
+  return instance;
+}
+
+ThreadRing &LogBackend::threadRing() {
+  thread_local ThreadRingHandle handle;
+  if (!handle.ring) {
+    handle.ring = std::make_shared<ThreadRing>();
+    std::lock_guard lock{registryMutex};
+    rings.push_back(handle.ring);
+  }
+  return *handle.ring;
+}
+
+void appendFrame(std::string &frames, std::string_view record) {
+  XveBinaryLog::put(frames, static_cast<uint32_t>(record.size()));
+  frames.append(record);
+}
+
+void LogBackend::writeBinary(std::string_view frames) {
+  if (binaryFile.is_open()) {
+    binaryFile.write(frames.data(), frames.size());
+  }
+}
+
+void LogBackend::writeSynchronously(std::string_view message, bool binary) {
+  std::lock_guard lock{sinkMutex};
+  if (binary) {
+    std::string frame;
+    appendFrame(frame, message);
+    writeBinary(frame);
+    binaryFile.flush();
+    return;
+  }
+  std::string line{message};
+  line.push_back('\n');
+  writeFn(line);
+}
+
+void LogBackend::submit(std::string_view message, bool binary) {
+  if (!running.load(std::memory_order_acquire)) {
+    writeSynchronously(message, binary);
+    return;
+  }
+
+  // Half the ring is the most one message may take, so a writer that is
+  // mid-batch can never starve it.
+  message = message.substr(0, SLOT_TEXT_SIZE * (RING_SLOTS / 2));
+  auto slotCount = static_cast<uint16_t>(
+      std::max<size_t>(1, (message.size() + SLOT_TEXT_SIZE - 1) /
+                              SLOT_TEXT_SIZE));
+
+  auto &ring = threadRing();
+  auto head = ring.head.load(std::memory_order_relaxed);
+  while (head + slotCount - ring.tail.load(std::memory_order_acquire) >
+         RING_SLOTS) {
+    if (!running.load(std::memory_order_acquire)) {
+      writeSynchronously(message, binary);
+      return;
+    }
+    std::this_thread::yield();
+  }
+
+  auto &first = ring.slots[head % RING_SLOTS];
+  first.sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+  first.length = static_cast<uint32_t>(message.size());
+  first.slotCount = slotCount;
+  first.binary = binary;
+  for (uint32_t i = 0; i < slotCount; i++) {
+    auto offset = i * SLOT_TEXT_SIZE;
+    auto size = std::min(SLOT_TEXT_SIZE, message.size() - offset);
+    std::memcpy(ring.slots[(head + i) % RING_SLOTS].text,
+                message.data() + offset, size);
+  }
+  ring.head.store(head + slotCount, std::memory_order_release);
+}
+
+bool LogBackend::drain(bool holdBack) {
+  struct Pending {
+    uint64_t sequence;
+    size_t ringIndex;
+    uint64_t slot;
+  };
+
+  std::vector<std::shared_ptr<ThreadRing>> snapshot;
+  {
+    std::lock_guard lock{registryMutex};
+    snapshot = rings;
+  }
+
+  std::vector<Pending> pending;
+  std::vector<uint64_t> heads(snapshot.size());
+  for (size_t r = 0; r < snapshot.size(); r++) {
+    auto &ring = *snapshot[r];
+    heads[r] = ring.head.load(std::memory_order_acquire);
+    for (auto slot = ring.tail.load(std::memory_order_relaxed);
+         slot < heads[r];) {
+      auto &first = ring.slots[slot % RING_SLOTS];
+      pending.push_back({first.sequence, r, slot});
+      slot += first.slotCount;
+    }
+  }
+
+  if (pending.empty()) {
+    // Rings of finished threads go once they're drained.
+    std::lock_guard lock{registryMutex};
+    std::erase_if(rings, [](const std::shared_ptr<ThreadRing> &ring) {
+      return ring->orphaned.load(std::memory_order_acquire) &&
+             ring->head.load(std::memory_order_acquire) ==
+                 ring->tail.load(std::memory_order_relaxed);
+    });
+    return false;
+  }
+
+  std::sort(pending.begin(), pending.end(),
+            [](const Pending &a, const Pending &b) {
+              return a.sequence < b.sequence;
+            });
+
+  // Sequences are taken before a record is published, so a slower thread
+  // can still be filling in one below what is pending. Everything up to
+  // writtenCount is out, so the next record to write is exactly that one.
+  std::vector<uint64_t> tails = heads;
+  if (holdBack) {
+    auto expected = writtenCount.load(std::memory_order_relaxed);
+    size_t ready = 0;
+    while (ready < pending.size() &&
+           pending[ready].sequence == expected + ready) {
+      ready++;
+    }
+    // Each ring's records are in sequence order, so its held-back records
+    // are a suffix and its tail stops at the first one.
+    for (auto it = pending.rbegin(); it != pending.rend() - ready; ++it) {
+      tails[it->ringIndex] = it->slot;
+    }
+    pending.resize(ready);
+    if (pending.empty()) {
+      return false;
+    }
+  }
+
+  std::string batch;
+  std::string binaryBatch;
+  std::string record;
+  for (auto &message : pending) {
+    auto &ring = *snapshot[message.ringIndex];
+    auto &first = ring.slots[message.slot % RING_SLOTS];
+    record.clear();
+    for (uint32_t i = 0; i < first.slotCount; i++) {
+      auto offset = i * SLOT_TEXT_SIZE;
+      auto size = std::min<size_t>(SLOT_TEXT_SIZE, first.length - offset);
+      record.append(ring.slots[(message.slot + i) % RING_SLOTS].text, size);
+    }
+    if (first.binary) {
+      appendFrame(binaryBatch, record);
+    } else {
+      batch.append(record);
+      batch.push_back('\n');
+    }
+  }
+
+  {
+    std::lock_guard lock{sinkMutex};
+    if (!batch.empty()) {
+      writeFn(batch);
+    }
+    if (!binaryBatch.empty()) {
+      writeBinary(binaryBatch);
+    }
+  }
+
+  for (size_t r = 0; r < snapshot.size(); r++) {
+    snapshot[r]->tail.store(tails[r], std::memory_order_release);
+  }
+  writtenCount.fetch_add(pending.size(), std::memory_order_release);
+  return true;
+}
+
+void LogBackend::writerLoop() {
+  while (running.load(std::memory_order_acquire)) {
+    if (!drain()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  while (drain()) {
+  }
+}
+
+void LogBackend::setWriteFunction(LoggerWriteFn writeFn_) {
+  std::lock_guard lock{sinkMutex};
+  writeFn = writeFn_ ? std::move(writeFn_) : writeToStdout;
+}
+
+bool LogBackend::openBinaryFile(const std::string &filepath) {
+  std::lock_guard lock{sinkMutex};
+  binaryFile.open(filepath, std::ios::binary | std::ios::trunc);
+  if (!binaryFile.is_open()) {
+    return false;
+  }
+
+  std::string header{XveBinaryLog::MAGIC, sizeof(XveBinaryLog::MAGIC)};
+  XveBinaryLog::put(header, XveBinaryLog::VERSION);
+  XveBinaryLog::put(header, steadyNowNs());
+  binaryFile.write(header.data(), header.size());
+  return true;
+}
+
+void LogBackend::flush() {
+  auto target = nextSequence.load(std::memory_order_acquire);
+  while (running.load(std::memory_order_acquire) &&
+         writtenCount.load(std::memory_order_acquire) < target) {
+    std::this_thread::yield();
+  }
+  std::lock_guard lock{sinkMutex};
+  if (binaryFile.is_open()) {
+    binaryFile.flush();
+  }
+}
+
+void LogBackend::shutdown() {
+  if (running.exchange(false, std::memory_order_acq_rel) &&
+      writer.joinable()) {
+    writer.join();
+    // Catches messages published while the writer was on its way out; no
+    // more are coming, so nothing is held back for missing sequences.
+    drain(false);
+    std::lock_guard lock{sinkMutex};
+    if (binaryFile.is_open()) {
+      binaryFile.flush();
+    }
+  }
+}
+
+uint32_t InternTable::intern(XveBinaryLog::RecordKind kind,
+                             std::string_view value) {
+  std::lock_guard lock{mutex};
+  auto [it, inserted] =
+      ids.try_emplace(std::string{value}, static_cast<uint32_t>(ids.size()));
+  if (inserted) {
+    std::string definition;
+    XveBinaryLog::putDefinition(definition, kind, it->second, value);
+    backend().submit(definition, true);
+  }
+  return it->second;
+}
+
+} // namespace
+
 std::string Logger::name() {
   std::string typeName = typeid(*this).name();
   if (typeName.front() == 'N' && typeName.back() == 'E') {
@@ -31,12 +380,83 @@ std::string Logger::name() {
   return result;
 }
 
-std::string Logger::combineMessage(LogLevel level, const std::string &message) {
-  return std::format("[{}][{}]: {}", logLevelToString(level), name(), message);
+const std::string &Logger::cachedName() {
+  // Per thread, so lookups never lock.
+  thread_local std::unordered_map<std::type_index, std::string> names;
+  auto [it, inserted] = names.try_emplace(typeid(*this));
+  if (inserted) {
+    it->second = name();
+  }
+  return it->second;
 }
 
-void Logger::writeMessage(const std::string &logMessage) {
-  gWriteFn(logMessage);
+void Logger::logFormatted(LogLevel level, std::string_view fmt,
+                          std::format_args args) {
+  // Reused across calls so steady-state logging doesn't allocate.
+  thread_local std::string buffer;
+  buffer.clear();
+  std::format_to(std::back_inserter(buffer), "[{}][{}]: ",
+                 logLevelToString(level), cachedName());
+  std::vformat_to(std::back_inserter(buffer), fmt, args);
+  backend().submit(buffer);
+}
+
+uint32_t Logger::cachedNameId() {
+  thread_local std::unordered_map<std::type_index, uint32_t> nameIds;
+  auto it = nameIds.find(typeid(*this));
+  if (it == nameIds.end()) {
+    auto id = gNames.intern(XveBinaryLog::RecordKind::Name, cachedName());
+    it = nameIds.emplace(typeid(*this), id).first;
+  }
+  return it->second;
 }
 
-void Logger::setWriteFunction(LoggerWriteFn writeFn) { gWriteFn = writeFn; }
+std::string &Logger::beginBinaryMessage(LogLevel level, std::string_view fmt,
+                                        uint8_t argCount) {
+  struct CachedFormat {
+    std::string text;
+    uint32_t id;
+  };
+  // Call sites pass literals, so the pointer almost always identifies the
+  // format string; the content check keeps reused buffers correct.
+  thread_local std::unordered_map<const char *, CachedFormat> formatIds;
+
+  auto it = formatIds.find(fmt.data());
+  if (it == formatIds.end() || it->second.text != fmt) {
+    auto id = gFormatStrings.intern(XveBinaryLog::RecordKind::FormatString,
+                                    fmt);
+    it = formatIds.insert_or_assign(fmt.data(), CachedFormat{std::string{fmt},
+                                                             id})
+             .first;
+  }
+
+  thread_local std::string buffer;
+  buffer.clear();
+  XveBinaryLog::put(buffer, XveBinaryLog::RecordKind::Message);
+  XveBinaryLog::put(buffer, static_cast<uint8_t>(level));
+  XveBinaryLog::put(buffer, it->second.id);
+  XveBinaryLog::put(buffer, cachedNameId());
+  XveBinaryLog::put(buffer, steadyNowNs());
+  XveBinaryLog::put(buffer, argCount);
+  return buffer;
+}
+
+void Logger::submitBinary(const std::string &buffer) {
+  backend().submit(buffer, true);
+}
+
+bool Logger::openBinaryLog(const std::string &filepath) {
+  if (!backend().openBinaryFile(filepath)) {
+    return false;
+  }
+  binaryMode.store(true, std::memory_order_release);
+  return true;
+}
+
+void Logger::setWriteFunction(LoggerWriteFn writeFn) {
+  backend().setWriteFunction(std::move(writeFn));
+}
+
+void Logger::flush() { backend().flush(); }
+
+void Logger::shutdown() { backend().shutdown(); }
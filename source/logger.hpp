@@ -1,5 +1,7 @@
 #pragma once
 
+#include "xve_binary_log.hpp"
+#include <atomic>
 #include <format>
 #include <functional>
 #include <memory>
@@ -7,6 +9,13 @@
 #include <string>
 #include <string_view>
 
+/// Messages below this level are compiled out: log() returns before
+/// formatting, and with a constant level the call folds away entirely.
+/// 0 = Debug, 1 = Info, 2 = Warning, 3 = Error.
+#ifndef XVE_MIN_LOG_LEVEL
+#define XVE_MIN_LOG_LEVEL 0
+#endif
+
 enum class LogLevel {
   Debug,
   Info,
@@ -14,7 +23,10 @@ enum class LogLevel {
   Error,
 };
 
-inline std::string logLevelToString(LogLevel level) {
+inline constexpr LogLevel MIN_LOG_LEVEL =
+    static_cast<LogLevel>(XVE_MIN_LOG_LEVEL);
+
+inline constexpr std::string_view logLevelToString(LogLevel level) {
 #define ADD_LEVEL(X)                                                           \
   case LogLevel::X:                                                            \
     return #X
@@ -25,23 +37,61 @@ inline std::string logLevelToString(LogLevel level) {
     ADD_LEVEL(Error);
   }
 #undef ADD_LEVEL
+  return "Unknown";
 }
 
-using LoggerWriteFn = std::function<void(const std::string &msg)>;
+/// Receives batches of newline-terminated messages from the writer thread.
+using LoggerWriteFn = std::function<void(const std::string &batch)>;
 
+/// Messages are formatted on the calling thread into that thread's lock-free
+/// ring and written by a background thread in batches, ordered by a global
+/// sequence number across batches as well as within them. log() only blocks
+/// when its thread's ring is full.
 class Logger {
 protected:
   virtual std::string name();
 
 public:
+  /// An empty function restores the default stdout writer.
   static void setWriteFunction(LoggerWriteFn writeFn);
-  virtual std::string combineMessage(LogLevel level,
-                                     const std::string &message);
-  virtual void writeMessage(const std::string &logMessage);
+  /// Blocks until everything logged before the call has been written.
+  static void flush();
+  /// Drains and stops the writer thread. Later messages are written
+  /// synchronously, so logging stays safe during teardown.
+  static void shutdown();
+
+  /// Switches to binary mode: messages are stored as a format-string id plus
+  /// raw argument bytes (see XveBinaryLog) and rendered offline by
+  /// xve_log_decode. Nothing is formatted on the calling thread except
+  /// argument types without a binary encoding.
+  static bool openBinaryLog(const std::string &filepath);
 
   template <class... Args>
   void log(LogLevel level, std::string_view fmt, Args &&...args) {
-    writeMessage(combineMessage(
-        level, std::vformat(fmt, std::make_format_args(args...))));
+    if (level < MIN_LOG_LEVEL) {
+      return;
+    }
+    if (binaryMode.load(std::memory_order_relaxed)) {
+      static_assert(sizeof...(Args) < 256);
+      auto &buffer = beginBinaryMessage(level, fmt, sizeof...(Args));
+      (XveBinaryLog::putArg(buffer, args), ...);
+      submitBinary(buffer);
+      return;
+    }
+    logFormatted(level, fmt, std::make_format_args(args...));
   }
+
+private:
+  static inline std::atomic<bool> binaryMode{false};
+
+  void logFormatted(LogLevel level, std::string_view fmt,
+                    std::format_args args);
+  /// Returns the thread's scratch buffer holding the message header.
+  std::string &beginBinaryMessage(LogLevel level, std::string_view fmt,
+                                  uint8_t argCount);
+  static void submitBinary(const std::string &buffer);
+
+  /// name() demangles on every call; this caches it per dynamic type.
+  const std::string &cachedName();
+  uint32_t cachedNameId();
 };
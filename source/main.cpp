@@ -1,23 +1,118 @@
 #include <SDL3/SDL.h>
 
+#include <algorithm>
+#include <bit>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <string_view>
 
 #include "xve_app.hpp"
+#include "xve_args.hpp"
 
-int main() {
+// Usage: game [--headless] [--frames N] [--readback out.ppm] [--size WxH]
+//             [--frames-in-flight N]
+//             [--instances N] [--gpu-culling] [--dynamic-rendering]
+//             [--msaa N] [--depth-format d16|d24|d32]
+//             [--sync fence|timeline]
+//             [--present-mode fifo|fifo-relaxed|mailbox|immediate]
+//             [--image-count N] [--fps-cap N] [--[no-]low-latency]
+static XveAppOptions parseOptions(int argc, char **argv) {
+  XveAppOptions options;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "--frames" && hasValue) {
+      options.frameCount = std::stoul(argv[++i]);
+    } else if (arg == "--readback" && hasValue) {
+      options.readbackPath = argv[++i];
+    } else if (arg == "--gpu-culling") {
+      options.gpuCulling = true;
+    } else if (arg == "--dynamic-rendering") {
+      options.dynamicRendering = true;
+    } else if (arg == "--msaa" && hasValue) {
+      // Sample counts are powers of two; round down to one.
+      auto samples = std::bit_floor(
+          std::max<uint32_t>(static_cast<uint32_t>(std::stoul(argv[++i])), 1));
+      options.attachments.samples =
+          static_cast<vk::SampleCountFlagBits>(samples);
+    } else if (arg == "--depth-format" && hasValue) {
+      std::string_view format = argv[++i];
+      options.attachments.depthFormat =
+          format == "d16"   ? vk::Format::eD16Unorm
+          : format == "d24" ? vk::Format::eX8D24UnormPack32
+                            : vk::Format::eD32Sfloat;
+    } else if (arg == "--sync" && hasValue) {
+      std::string_view mode = argv[++i];
+      if (mode == "fence") {
+        options.syncMode = XveSyncMode::Fences;
+      } else if (mode == "timeline") {
+        options.syncMode = XveSyncMode::TimelineSemaphore;
+      } else {
+        std::cerr << "Invalid --sync " << mode << ", expected fence or "
+                  << "timeline" << std::endl;
+      }
+    } else if (arg == "--present-mode" && hasValue) {
+      std::string_view mode = argv[++i];
+      if (mode == "fifo") {
+        options.presentMode = vk::PresentModeKHR::eFifo;
+      } else if (mode == "fifo-relaxed") {
+        options.presentMode = vk::PresentModeKHR::eFifoRelaxed;
+      } else if (mode == "mailbox") {
+        options.presentMode = vk::PresentModeKHR::eMailbox;
+      } else if (mode == "immediate") {
+        options.presentMode = vk::PresentModeKHR::eImmediate;
+      } else {
+        std::cerr << "Invalid --present-mode " << mode << std::endl;
+      }
+    } else if (arg == "--frames-in-flight" && hasValue) {
+      options.framesInFlight = std::max<uint32_t>(
+          static_cast<uint32_t>(std::stoul(argv[++i])), 1);
+    } else if (arg == "--image-count" && hasValue) {
+      options.imageCount = std::stoul(argv[++i]);
+    } else if (arg == "--fps-cap" && hasValue) {
+      options.fpsCap = std::max(std::stod(argv[++i]), 0.0);
+    } else if (arg == "--low-latency") {
+      options.lowLatency = true;
+    } else if (arg == "--no-low-latency") {
+      options.lowLatency = false;
+    } else if (arg == "--instances" && hasValue) {
+      options.instanceCount = std::stoul(argv[++i]);
+    } else if (arg == "--size" && hasValue) {
+      std::string_view size = argv[++i];
+      if (!parseSize(size, options.width, options.height)) {
+        std::cerr << "Invalid --size " << size << ", expected WxH"
+                  << std::endl;
+      }
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+    }
+  }
+  return options;
+}
+
+int main(int argc, char **argv) {
+#ifdef XVE_BINARY_LOG
+  if (!Logger::openBinaryLog("log.bin")) {
+    std::cerr << "Failed to open log.bin" << std::endl;
+  }
+#endif
   std::ofstream logFile{"log.txt"};
-  Logger::setWriteFunction([&logFile](const std::string &msg) {
-    logFile << msg << std::endl << std::endl;
-  });
+  Logger::setWriteFunction(
+      [&logFile](const std::string &batch) { logFile << batch; });
 
   try {
-    XveApp app{};
+    XveApp app{parseOptions(argc, argv)};
     app.run();
   } catch (const std::exception &e) {
     Logger().log(LogLevel::Error, "{}", e.what());
   }
+  // The writer thread must be done with logFile before it closes, and
+  // anything logged during static teardown must not reach it.
+  Logger::shutdown();
+  Logger::setWriteFunction(nullptr);
   logFile.close();
   return 0;
 }
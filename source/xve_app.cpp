@@ -1,121 +1,473 @@
 #include "xve_app.hpp"
 #include "config.h"
 #include "xve_pipeline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <memory>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
-XveApp::XveApp() {
+XveApp::XveApp(const XveAppOptions &options_)
+    : options(options_),
+      window(options.headless ? nullptr
+                              : std::make_unique<XveWindow>(
+                                    "Game", options.width, options.height)),
+      device(window.get()),
+      renderTarget(createRenderTarget(device, window.get(), options)),
+      profiler(device, renderTarget->getFramesInFlight()),
+      framePacer({.targetFps = options.fpsCap,
+                  .lowLatency = options.lowLatency && !options.headless}),
+      commandRecorder(device, renderTarget->getFramesInFlight()),
+      renderGraph(device, renderTarget->getFramesInFlight()) {
+  renderTarget->setProfiler(&profiler);
+  renderGraph.setProfiler(&profiler);
+  // Nothing is streamed yet, so there is nothing to evict; the breakdown at
+  // least shows what to trim.
+  memoryBudget.setOverBudgetCallback(
+      [this](const XveMemorySnapshot &snapshot, uint32_t) {
+        memoryBudget.logSnapshot(snapshot);
+      });
   loadModels();
   createPipelineLayout();
   createPipeline();
-  createCommandBuffers();
+  createFrameContexts();
+  createGpuCuller();
 }
 
 XveApp::~XveApp() { device.getDevice().destroyPipelineLayout(pipelineLayout); }
 
+std::unique_ptr<XveRenderTarget>
+XveApp::createRenderTarget(XveDevice &device, XveWindow *window,
+                           const XveAppOptions &options) {
+  if (!window) {
+    return std::make_unique<XveOffscreenTarget>(
+        device, vk::Extent2D{options.width, options.height},
+        options.framesInFlight, options.dynamicRendering, options.attachments);
+  }
+  return std::make_unique<XveSwapChain>(
+      device, window->getPixelExtent2D(),
+      XveSwapChainConfig{
+          .framesInFlight = options.framesInFlight,
+          .syncMode = options.syncMode,
+          .presentMode = options.presentMode,
+          .desiredImageCount = options.imageCount,
+          .dynamicRendering = options.dynamicRendering,
+          .attachments = options.attachments,
+      });
+}
+
 void XveApp::loadModels() {
-  std::vector<XveModel::Vertex> vertices = {
-      {{0.0f, -0.5f}},
-      {{0.5f, 0.5f}},
-      {{-0.5f, 0.5f}},
+  XveModel::Builder builder{};
+  builder.vertices = {
+      {{0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+      {{0.5f, 0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+      {{-0.5f, 0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
   };
-  model = std::make_unique<XveModel>(device, vertices);
+  builder.optimize();
+  model = std::make_unique<XveModel>(geometryPool, uploadManager, builder);
+
+  // All model data goes out in one batch; draws must not start before it
+  // has landed.
+  uploadManager.waitIdle();
 }
 
 void XveApp::run() {
-  bool quit = false;
-  while (!quit) {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_EVENT_QUIT) {
+  while (!quit &&
+         (options.frameCount == 0 || framesRendered < options.frameCount)) {
+    framePacer.beginFrame();
+    // Pumped on every iteration, even ones that end without a frame (e.g.
+    // acquire keeps returning out-of-date), so quit and resize are never
+    // starved.
+    pollEvents();
+    if (!framePacer.isLowLatency()) {
+      framePacer.markInputSampled();
+    }
+
+    // A minimized window has a zero-sized surface; sleep until something
+    // happens instead of spinning on acquire.
+    if (window && window->isMinimized()) {
+      SDL_Event event;
+      if (SDL_WaitEvent(&event) && event.type == SDL_EVENT_QUIT) {
         quit = true;
       }
+      framebufferResized = true;
+      continue;
     }
 
     drawFrame();
   }
 
   device.getDevice().waitIdle();
+  if (auto *offscreen = dynamic_cast<XveOffscreenTarget *>(renderTarget.get());
+      offscreen && !options.readbackPath.empty() && framesRendered > 0) {
+    offscreen->readback(offscreen->getLastImage(), options.readbackPath);
+  }
+  logFrameStats();
+  profiler.logSummaries();
+  profiler.writeChromeTrace(PROFILE_TRACE_FILE);
+}
+
+void XveApp::pollEvents() {
+  if (!window) {
+    return;
+  }
+
+  SDL_Event event;
+  while (SDL_PollEvent(&event)) {
+    if (event.type == SDL_EVENT_QUIT) {
+      quit = true;
+    } else if (event.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
+      framebufferResized = true;
+    }
+  }
+}
+
+void XveApp::logFrameStats() {
+  auto &syncStats = renderTarget->getSyncStats();
+  if (syncStats.frameCount == 0) {
+    return;
+  }
+
+  log(LogLevel::Info,
+      "{} frames ({}): CPU wait avg {:.3f} ms, worst {:.3f} ms",
+      syncStats.frameCount, renderTarget->describe(),
+      syncStats.totalWaitMs / syncStats.frameCount, syncStats.maxWaitMs);
+
+  auto memory = renderTarget->getMemoryUsage();
+  if (renderTarget->usesDynamicRendering()) {
+    auto &graphStats = renderGraph.getStats();
+    memory.attachmentBytes = graphStats.transientBytes;
+    memory.perImageAttachmentBytes = graphStats.unaliasedBytes;
+  }
+  log(LogLevel::Info,
+      "Render target memory: color {} KiB, attachments {} KiB ({} KiB "
+      "without sharing)",
+      memory.colorBytes / 1024, memory.attachmentBytes / 1024,
+      memory.perImageAttachmentBytes / 1024);
+  memoryBudget.logSnapshot(memoryBudget.snapshot());
+  framePacer.logStats();
 }
 
 void XveApp::createPipelineLayout() {
+  std::vector<vk::DescriptorSetLayout> setLayouts;
+  if (XveBindlessDescriptors::isSupported(device)) {
+    bindless = std::make_unique<XveBindlessDescriptors>(device);
+    setLayouts.push_back(bindless->getLayout());
+  } else {
+    log(LogLevel::Warning,
+        "Descriptor indexing unsupported, running without bindless "
+        "descriptors");
+  }
+
   auto createInfo = vk::PipelineLayoutCreateInfo{
-      vk::PipelineLayoutCreateFlags(), 0, nullptr, 0, nullptr,
+      vk::PipelineLayoutCreateFlags(),
+      static_cast<uint32_t>(setLayouts.size()),
+      setLayouts.data(),
+      0,
+      nullptr,
   };
 
   pipelineLayout = device.getDevice().createPipelineLayout(createInfo);
+  if (bindless) {
+    commandRecorder.setBindlessDescriptors(bindless.get(), pipelineLayout);
+  }
 }
 
 void XveApp::createPipeline() {
-  auto extent = swapChain.getSwapChainExtent();
+  auto extent = renderTarget->getExtent();
   auto pipelineConfig =
       XvePipeline::defaultPipelineConfigInfo(extent.width, extent.height);
-  pipelineConfig.renderPass = swapChain.getRenderPass();
+  pipelineConfig.renderPass = renderTarget->getRenderPass();
+  pipelineConfig.colorAttachmentFormat = renderTarget->getColorFormat();
+  pipelineConfig.depthAttachmentFormat = renderTarget->getDepthFormat();
+  pipelineConfig.multisampleInfo.rasterizationSamples =
+      renderTarget->getSampleCount();
   pipelineConfig.pipelineLayout = pipelineLayout;
 
-  pipeline = std::make_unique<XvePipeline>(device, SIMPLE_SHADER_VERT,
-                                           SIMPLE_SHADER_FRAG, pipelineConfig);
+  pipeline = pipelineManager.request(SIMPLE_SHADER_VERT, SIMPLE_SHADER_FRAG,
+                                     pipelineConfig);
+  pipelineManager.setFallback(pipeline);
+
+  // Later pipelines may draw with the fallback while they compile, but the
+  // fallback itself has to exist before the first frame.
+  pipeline.wait();
+  if (pipeline.hasFailed()) {
+    throw std::runtime_error("Failed to create graphics pipeline");
+  }
+
+  // Instances fill a square grid in clip space, each shrunk to half its
+  // cell. A single instance is the untransformed triangle.
+  auto columns = static_cast<uint32_t>(
+      std::ceil(std::sqrt(static_cast<double>(options.instanceCount))));
+  auto cellSize = 2.0f / columns;
+  renderObjects.reserve(options.instanceCount);
+  for (uint32_t i = 0; i < options.instanceCount; i++) {
+    auto column = i % columns;
+    auto row = i / columns;
+
+    XveRenderObject object{model.get(), pipeline};
+    object.transform[0][0] = cellSize / 2.0f;
+    object.transform[1][1] = cellSize / 2.0f;
+    object.transform[2][2] = cellSize / 2.0f;
+    object.transform[3] =
+        glm::vec4{-1.0f + cellSize * (column + 0.5f),
+                  -1.0f + cellSize * (row + 0.5f), 0.0f, 1.0f};
+    object.color = glm::vec4{1.0f, static_cast<float>(column) / columns,
+                             static_cast<float>(row) / columns, 1.0f};
+    renderObjects.push_back(std::move(object));
+  }
 }
 
-void XveApp::createCommandBuffers() {
-  commandBuffers.resize(swapChain.imageCount());
+void XveApp::createFrameContexts() {
+  // Instance data is rewritten every frame, so the dynamic buffer has to
+  // hold the whole scene's worth on top of the usual headroom.
+  auto dynamicBufferSize =
+      XveFrameContext::DEFAULT_DYNAMIC_BUFFER_SIZE +
+      sizeof(XveModel::Instance) * renderObjects.size();
+  for (uint32_t i = 0; i < renderTarget->getFramesInFlight(); i++) {
+    frames.push_back(
+        std::make_unique<XveFrameContext>(device, dynamicBufferSize));
+  }
+}
 
-  auto allocInfo = vk::CommandBufferAllocateInfo{
-      device.getCommandPool(),
-      vk::CommandBufferLevel::ePrimary,
-      static_cast<uint32_t>(commandBuffers.size()),
-  };
+void XveApp::createGpuCuller() {
+  if (!options.gpuCulling) {
+    return;
+  }
+  if (!XveGpuCuller::isSupported(device)) {
+    log(LogLevel::Warning,
+        "GPU culling unsupported on this device, drawing instanced batches");
+    return;
+  }
 
-  try {
-    commandBuffers = device.getDevice().allocateCommandBuffers(allocInfo);
-  } catch (const vk::SystemError &e) {
-    throw std::runtime_error(
-        std::format("Failed to allocate command buffers. Error: {}", e.what()));
+  std::vector<XveGpuCuller::Object> objects;
+  objects.reserve(renderObjects.size());
+  for (auto &object : renderObjects) {
+    objects.push_back({object.model, object.transform, object.color});
   }
-  for (size_t i = 0; i < commandBuffers.size(); i++) {
-    try {
-      auto cmd = commandBuffers[i];
+  gpuCuller = std::make_unique<XveGpuCuller>(
+      device, uploadManager, renderTarget->getFramesInFlight(), objects);
+  uploadManager.waitIdle();
+}
+
+void XveApp::recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex) {
+  XVE_PROFILE_SCOPE(profiler, "record");
+
+  // With GPU culling the whole scene is a few inline commands; otherwise
+  // objects are batched and recorded into secondary buffers. Objects whose
+  // pipeline (and the fallback) is still compiling are skipped this frame.
+  std::vector<vk::CommandBuffer> secondaryBuffers;
+  if (!gpuCuller) {
+    drawCommands.clear();
+    drawBatcher.build(*frames[frameIndex], pipelineManager, renderObjects,
+                      drawCommands);
+
+    auto dynamicRendering = renderTarget->usesDynamicRendering();
+    auto inheritanceInfo = vk::CommandBufferInheritanceInfo{
+        renderTarget->getRenderPass(),
+        0,
+        dynamicRendering ? vk::Framebuffer{}
+                         : renderTarget->getFramebuffer(imageIndex, frameIndex),
+    };
+    auto colorFormat = renderTarget->getColorFormat();
+    auto renderingInfo = vk::CommandBufferInheritanceRenderingInfo{
+        vk::RenderingFlags(),
+        0,
+        1,
+        &colorFormat,
+        renderTarget->getDepthFormat(),
+        vk::Format::eUndefined,
+        renderTarget->getSampleCount(),
+    };
+    if (dynamicRendering) {
+      inheritanceInfo.pNext = &renderingInfo;
+    }
+
+    commandRecorder.beginFrame(frameIndex);
+    secondaryBuffers =
+        commandRecorder.record(frameIndex, inheritanceInfo,
+                               renderTarget->getExtent(), drawCommands);
+  }
+
+  try {
+    auto cmd = frames[frameIndex]->getCommandBuffer();
 
-      auto beginInfo = vk::CommandBufferBeginInfo{};
-      cmd.begin(beginInfo);
+    auto beginInfo = vk::CommandBufferBeginInfo{
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+    };
+    cmd.begin(beginInfo);
+    profiler.resetQueries(cmd);
+    auto gpuFrameScope = profiler.beginGpuScope(cmd, "frame");
 
-      std::array<vk::ClearValue, 2> clearValues{};
-      clearValues[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
-      clearValues[1].depthStencil = vk::ClearDepthStencilValue{1.0f, 0};
+    auto cull = [&](vk::CommandBuffer commandBuffer) {
+      gpuCuller->cull(commandBuffer, frameIndex, glm::mat4{1.0f});
+    };
+    auto drawScene = [&](vk::CommandBuffer commandBuffer) {
+      if (gpuCuller) {
+        auto extent = renderTarget->getExtent();
+        commandBuffer.setViewport(
+            0, vk::Viewport{0.0f, 0.0f, static_cast<float>(extent.width),
+                            static_cast<float>(extent.height), 0.0f, 1.0f});
+        commandBuffer.setScissor(0, vk::Rect2D{vk::Offset2D{0, 0}, extent});
+        if (bindless) {
+          bindless->bind(commandBuffer, pipelineLayout);
+        }
+        gpuCuller->draw(commandBuffer, frameIndex,
+                        *pipelineManager.resolve(pipeline));
+      } else if (!secondaryBuffers.empty()) {
+        commandBuffer.executeCommands(secondaryBuffers);
+      }
+    };
+
+    auto clearColor = vk::ClearColorValue{0.1f, 0.1f, 0.1f, 1.0f};
+    auto clearDepth = vk::ClearDepthStencilValue{1.0f, 0};
 
+    if (renderTarget->usesDynamicRendering()) {
+      // The graph places the barriers around both passes and owns the depth
+      // buffer as a transient, aliased or lazily allocated where it can be.
+      renderGraph.beginFrame(framesRendered);
+      auto extent = renderTarget->getExtent();
+      auto samples = renderTarget->getSampleCount();
+      auto color = renderGraph.importImage(
+          "color", renderTarget->getColorImage(imageIndex),
+          renderTarget->getColorImageView(imageIndex),
+          renderTarget->getColorFormat(), extent, vk::ImageLayout::eUndefined,
+          renderTarget->getFinalColorLayout(),
+          vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+      auto depth = renderGraph.createImage(
+          "depth", renderTarget->getDepthFormat(), extent, samples);
+      // With MSAA the pass draws into a transient and resolves into color.
+      std::optional<XveRenderGraph::ResourceId> multisampledColor;
+      if (samples != vk::SampleCountFlagBits::e1) {
+        multisampledColor = renderGraph.createImage(
+            "multisampled color", renderTarget->getColorFormat(), extent,
+            samples);
+      }
+      if (gpuCuller) {
+        renderGraph.addPass(
+            "cull",
+            [](XveRenderGraph::PassBuilder &pass) { pass.setSideEffects(); },
+            cull);
+      }
+      renderGraph.addPass(
+          "main pass",
+          [&](XveRenderGraph::PassBuilder &pass) {
+            if (multisampledColor) {
+              pass.setColorAttachment(*multisampledColor, clearColor, color);
+            } else {
+              pass.setColorAttachment(color, clearColor);
+            }
+            pass.setDepthAttachment(depth, clearDepth);
+            if (!gpuCuller) {
+              pass.useSecondaryCommandBuffers();
+            }
+          },
+          drawScene);
+      renderGraph.compile();
+      renderGraph.execute(cmd);
+    } else {
+      if (gpuCuller) {
+        XveProfiler::GpuScope cullScope{profiler, cmd, "cull"};
+        cull(cmd);
+      }
+
+      XveProfiler::GpuScope mainPassScope{profiler, cmd, "main pass"};
+      // With MSAA the multisampled color is attachment 2 and is cleared too.
+      std::array<vk::ClearValue, 3> clearValues{};
+      clearValues[0].color = clearColor;
+      clearValues[1].depthStencil = clearDepth;
+      clearValues[2].color = clearColor;
+      auto clearValueCount =
+          renderTarget->getSampleCount() != vk::SampleCountFlagBits::e1 ? 3u
+                                                                        : 2u;
       auto renderPassInfo = vk::RenderPassBeginInfo{
-          swapChain.getRenderPass(),
-          swapChain.getFramebuffer(i),
+          renderTarget->getRenderPass(),
+          renderTarget->getFramebuffer(imageIndex, frameIndex),
           {
               vk::Offset2D{0, 0},
-              swapChain.getSwapChainExtent(),
+              renderTarget->getExtent(),
           },
-          static_cast<uint32_t>(clearValues.size()),
+          clearValueCount,
           clearValues.data(),
       };
-
-      cmd.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-
-      pipeline->bind(cmd);
-      model->bind(cmd);
-      model->draw(cmd);
-
+      auto contents = gpuCuller ? vk::SubpassContents::eInline
+                                : vk::SubpassContents::eSecondaryCommandBuffers;
+      cmd.beginRenderPass(renderPassInfo, contents);
+      drawScene(cmd);
       cmd.endRenderPass();
-
-      cmd.end();
-    } catch (const vk::SystemError &e) {
-      throw std::runtime_error(
-          std::format("Failed to create command buffers. Error: {}", e.what()));
     }
+
+    profiler.endGpuScope(cmd, gpuFrameScope);
+    cmd.end();
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(
+        std::format("Failed to record command buffer. Error: {}", e.what()));
   }
 }
 
 void XveApp::drawFrame() {
+  XVE_PROFILE_SCOPE(profiler, "frame");
+
   uint32_t imageIndex;
-  swapChain.acquireNextImage(&imageIndex);
+  auto result = renderTarget->acquireNextImage(&imageIndex);
+  if (result == vk::Result::eErrorOutOfDateKHR) {
+    recreateSwapChain();
+    return;
+  }
+  if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
+    throw std::runtime_error(std::format(
+        "Failed to acquire swapchain image: {}", vk::to_string(result)));
+  }
 
-  auto commandBuffers_ = std::vector<vk::CommandBuffer>{};
+  // The frame-slot wait inside acquire is the longest CPU stall of the frame;
+  // sampling input after it keeps that stall out of input latency.
+  if (framePacer.isLowLatency()) {
+    pollEvents();
+    framePacer.markInputSampled();
+  }
+
+  // acquireNextImage waited for this frame slot's previous submission, so its
+  // context is free to reuse.
+  auto frameIndex = renderTarget->getCurrentFrame();
+  auto &frame = *frames[frameIndex];
+  frame.begin();
+  profiler.beginFrame(frameIndex);
+  // Frame numbers are framesRendered values; the slot wait above means
+  // everything up to framesInFlight frames back has finished.
+  auto framesInFlight = renderTarget->getFramesInFlight();
+  if (bindless && framesRendered >= framesInFlight) {
+    bindless->reclaim(framesRendered - framesInFlight);
+  }
+  recordCommandBuffer(frameIndex, imageIndex);
+
+  auto cmd = frame.getCommandBuffer();
+  result = renderTarget->submitCommandBuffers(&cmd, &imageIndex);
+  framePacer.markPresented();
+  framesRendered++;
+  memoryBudget.update();
+  if (result == vk::Result::eErrorOutOfDateKHR ||
+      result == vk::Result::eSuboptimalKHR || framebufferResized) {
+    recreateSwapChain();
+  } else if (result != vk::Result::eSuccess) {
+    throw std::runtime_error(std::format(
+        "Failed to present swapchain image: {}", vk::to_string(result)));
+  }
+}
+
+void XveApp::recreateSwapChain() {
+  if (!window) {
+    return;
+  }
+  auto extent = window->getPixelExtent2D();
+  if (extent.width == 0 || extent.height == 0) {
+    return;
+  }
+  framebufferResized = false;
 
-  swapChain.submitCommandBuffers(&commandBuffers[imageIndex], &imageIndex);
+  // Pipelines use dynamic viewport/scissor and the render pass (or the
+  // attachment formats) are unchanged, so only the swapchain and its
+  // attachments are rebuilt. In-flight frames keep running; the old
+  // resources are freed once they finish.
+  renderTarget->recreate(extent);
 }
@@ -1,15 +1,66 @@
 #pragma once
 
+#include "xve_bindless_descriptors.hpp"
+#include "xve_command_recorder.hpp"
 #include "xve_device.hpp"
+#include "xve_draw_batcher.hpp"
+#include "xve_frame_attachments.hpp"
+#include "xve_frame_context.hpp"
+#include "xve_frame_pacer.hpp"
+#include "xve_geometry_pool.hpp"
+#include "xve_gpu_culler.hpp"
+#include "xve_memory_budget.hpp"
 #include "xve_model.hpp"
+#include "xve_offscreen_target.hpp"
 #include "xve_pipeline.hpp"
+#include "xve_pipeline_manager.hpp"
+#include "xve_profiler.hpp"
+#include "xve_render_graph.hpp"
+#include "xve_render_object.hpp"
+#include "xve_render_target.hpp"
 #include "xve_swap_chain.hpp"
+#include "xve_upload_manager.hpp"
 #include "xve_window.hpp"
 #include <memory>
+#include <string>
 
-class XveApp {
+struct XveAppOptions {
+  /// Render offscreen without a window or surface.
+  bool headless = false;
+  /// Exit after this many frames; 0 runs until the window is closed.
+  uint32_t frameCount = 0;
+  /// Headless only: write the last frame here as a PPM image.
+  std::string readbackPath;
+  uint32_t width = 800;
+  uint32_t height = 600;
+  /// Frames the CPU may record ahead of the GPU, windowed or headless.
+  uint32_t framesInFlight = 2;
+  /// Copies of the triangle, laid out in a grid and drawn instanced.
+  uint32_t instanceCount = 1;
+  /// Cull and draw the scene on the GPU with indirect draws, when the
+  /// device supports drawIndirectCount.
+  bool gpuCulling = false;
+  /// Render without render pass and framebuffer objects, when the device
+  /// supports dynamic rendering.
+  bool dynamicRendering = false;
+  /// Depth format and MSAA sample count.
+  XveAttachmentConfig attachments;
+  /// Windowed only: how frame slots are waited on. The CPU wait per mode is
+  /// logged on exit.
+  XveSyncMode syncMode = XveSyncMode::TimelineSemaphore;
+  /// Windowed only. Falls back to FIFO when the surface lacks the mode.
+  vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+  /// Windowed only: minimum swapchain images; 0 keeps the driver default.
+  uint32_t imageCount = 2;
+  /// Frame-rate cap; 0 leaves pacing to the present mode.
+  double fpsCap = 0.0;
+  /// Windowed only: sample input after the frame-slot wait.
+  bool lowLatency = true;
+};
+
+class XveApp : Logger {
 public:
-  XveApp();
+  explicit XveApp(const XveAppOptions &options = {});
   ~XveApp();
 
   void run();
@@ -19,18 +70,44 @@ private:
 
   void createPipelineLayout();
   void createPipeline();
-  void createCommandBuffers();
+  void createFrameContexts();
+  void createGpuCuller();
+  void recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex);
   void drawFrame();
+  void recreateSwapChain();
+  void pollEvents();
+  void logFrameStats();
 
-  static constexpr int WIDTH = 800;
-  static constexpr int HEIGHT = 600;
+  static std::unique_ptr<XveRenderTarget>
+  createRenderTarget(XveDevice &device, XveWindow *window,
+                     const XveAppOptions &options);
 
-  XveWindow window{"Game", WIDTH, HEIGHT};
-  XveDevice device{window};
-  XveSwapChain swapChain{device, window.getExtent2D()};
-  std::unique_ptr<XvePipeline> pipeline;
+  XveAppOptions options;
+  std::unique_ptr<XveWindow> window;
+  XveDevice device;
+  std::unique_ptr<XveRenderTarget> renderTarget;
+  XveProfiler profiler;
+  XveFramePacer framePacer;
+  XveMemoryBudget memoryBudget{device};
+  XveUploadManager uploadManager{device};
+  XveGeometryPool geometryPool{device, sizeof(XveModel::Vertex)};
+  XvePipelineManager pipelineManager{device};
+  XvePipelineHandle pipeline;
+  // Set 0 of pipelineLayout when the device supports descriptor indexing.
+  std::unique_ptr<XveBindlessDescriptors> bindless;
   vk::PipelineLayout pipelineLayout;
-  std::vector<vk::CommandBuffer> commandBuffers;
+  XveCommandRecorder commandRecorder;
+  // Records the frame when the target uses dynamic rendering.
+  XveRenderGraph renderGraph;
+  XveDrawBatcher drawBatcher;
+  std::vector<std::unique_ptr<XveFrameContext>> frames;
 
   std::unique_ptr<XveModel> model;
+  std::vector<XveRenderObject> renderObjects;
+  std::vector<XveDrawCommand> drawCommands;
+  std::unique_ptr<XveGpuCuller> gpuCuller;
+
+  bool framebufferResized = false;
+  bool quit = false;
+  uint64_t framesRendered = 0;
 };
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+/// Command-line value parsing shared by the game and the benchmarks. Both
+/// reject the whole value on any stray character rather than throwing.
+
+/// Parses a whole unsigned decimal number.
+template <typename T> bool parseNumber(std::string_view text, T &out) {
+  auto end = text.data() + text.size();
+  auto [ptr, error] = std::from_chars(text.data(), end, out);
+  return error == std::errc{} && ptr == end;
+}
+
+/// Parses "WxH" with both sides positive; anything else is rejected.
+inline bool parseSize(std::string_view value, uint32_t &width,
+                      uint32_t &height) {
+  auto x = value.find('x');
+  if (x == std::string_view::npos) {
+    return false;
+  }
+  uint32_t w, h;
+  if (!parseNumber(value.substr(0, x), w) ||
+      !parseNumber(value.substr(x + 1), h) || w == 0 || h == 0) {
+    return false;
+  }
+  width = w;
+  height = h;
+  return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// On-disk format shared by Logger's binary mode and tools/xve_log_decode.
+///
+/// File: MAGIC, u32 VERSION, u64 start time (steady clock ns), then records
+/// framed as u32 length + payload. Payloads start with a RecordKind byte:
+///   FormatString / Name: u32 id, u32 length, bytes
+///   Message: u8 level, u32 format id, u32 name id, u64 time ns, u8 argc,
+///            then per argument an ArgType byte and its value.
+/// Definitions may appear after the messages using them (they travel through
+/// different threads' rings), so decoders read the whole file first.
+/// Integers are host byte order.
+struct XveBinaryLog {
+  static constexpr char MAGIC[8] = {'X', 'V', 'E', 'L', 'O', 'G', '\0', '\0'};
+  static constexpr uint32_t VERSION = 1;
+
+  enum class RecordKind : uint8_t {
+    FormatString = 0,
+    Name = 1,
+    Message = 2,
+  };
+
+  enum class ArgType : uint8_t {
+    Bool = 0,
+    Char = 1,
+    Int = 2,
+    Uint = 3,
+    Float = 4,
+    String = 5,
+    Pointer = 6,
+  };
+
+  template <class T> static void put(std::string &buffer, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.append(bytes, sizeof(T));
+  }
+
+  static void putString(std::string &buffer, std::string_view value) {
+    put(buffer, static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+  }
+
+  static void putDefinition(std::string &buffer, RecordKind kind, uint32_t id,
+                            std::string_view value) {
+    put(buffer, kind);
+    put(buffer, id);
+    putString(buffer, value);
+  }
+
+  /// Arithmetic values and strings are stored raw; anything else is
+  /// formatted with "{}" on the spot so the decoder never needs its type.
+  template <class T> static void putArg(std::string &buffer, const T &value) {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::same_as<U, bool>) {
+      put(buffer, ArgType::Bool);
+      put(buffer, static_cast<uint8_t>(value));
+    } else if constexpr (std::same_as<U, char>) {
+      put(buffer, ArgType::Char);
+      put(buffer, value);
+    } else if constexpr (std::signed_integral<U>) {
+      put(buffer, ArgType::Int);
+      put(buffer, static_cast<int64_t>(value));
+    } else if constexpr (std::unsigned_integral<U>) {
+      put(buffer, ArgType::Uint);
+      put(buffer, static_cast<uint64_t>(value));
+    } else if constexpr (std::floating_point<U>) {
+      put(buffer, ArgType::Float);
+      put(buffer, static_cast<double>(value));
+    } else if constexpr (std::is_convertible_v<const U &, std::string_view>) {
+      put(buffer, ArgType::String);
+      putString(buffer, std::string_view(value));
+    } else if constexpr (std::is_pointer_v<U>) {
+      put(buffer, ArgType::Pointer);
+      put(buffer,
+          static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+    } else {
+      put(buffer, ArgType::String);
+      putString(buffer, std::format("{}", value));
+    }
+  }
+};
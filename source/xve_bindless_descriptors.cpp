@@ -0,0 +1,156 @@
+#include "xve_bindless_descriptors.hpp"
+
+#include <algorithm>
+#include <array>
+
+XveBindlessDescriptors::Handle XveBindlessDescriptors::SlotList::acquire() {
+  Handle handle;
+  if (!freeSlots.empty()) {
+    handle = freeSlots.back();
+    freeSlots.pop_back();
+  } else if (nextSlot < capacity) {
+    handle = nextSlot++;
+  } else {
+    return INVALID_HANDLE;
+  }
+  liveCount++;
+  return handle;
+}
+
+void XveBindlessDescriptors::SlotList::release(Handle handle) {
+  freeSlots.push_back(handle);
+  liveCount--;
+}
+
+XveBindlessDescriptors::XveBindlessDescriptors(XveDevice &deviceRef)
+    : device(deviceRef) {
+  auto propertiesChain =
+      device.getPhysicalDevice()
+          .getProperties2<vk::PhysicalDeviceProperties2,
+                          vk::PhysicalDeviceVulkan12Properties>();
+  auto &limits = propertiesChain.get<vk::PhysicalDeviceVulkan12Properties>();
+
+  // Both arrays live in every stage, so they split the per-stage budget.
+  auto perStageShare = limits.maxPerStageUpdateAfterBindResources / 2;
+  textures.capacity = std::min(
+      {MAX_TEXTURES, perStageShare,
+       limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+       limits.maxDescriptorSetUpdateAfterBindSampledImages,
+       limits.maxDescriptorSetUpdateAfterBindSamplers});
+  buffers.capacity = std::min(
+      {MAX_BUFFERS, perStageShare,
+       limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+       limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+  auto bindings = std::array<vk::DescriptorSetLayoutBinding, 2>{
+      vk::DescriptorSetLayoutBinding{
+          TEXTURE_BINDING, vk::DescriptorType::eCombinedImageSampler,
+          textures.capacity, vk::ShaderStageFlagBits::eAll},
+      vk::DescriptorSetLayoutBinding{
+          BUFFER_BINDING, vk::DescriptorType::eStorageBuffer,
+          buffers.capacity, vk::ShaderStageFlagBits::eAll},
+  };
+  auto bindingFlag = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                     vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                     vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+  auto bindingFlags =
+      std::array<vk::DescriptorBindingFlags, 2>{bindingFlag, bindingFlag};
+  auto bindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo{
+      static_cast<uint32_t>(bindingFlags.size()), bindingFlags.data()};
+
+  auto poolSizes = std::array<vk::DescriptorPoolSize, 2>{
+      vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler,
+                             textures.capacity},
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer,
+                             buffers.capacity},
+  };
+
+  try {
+    descriptorSetLayout = device.getDevice().createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo{
+            vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+            static_cast<uint32_t>(bindings.size()),
+            bindings.data(),
+            &bindingFlagsInfo,
+        });
+    descriptorPool = device.getDevice().createDescriptorPool(
+        vk::DescriptorPoolCreateInfo{
+            vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+            1,
+            static_cast<uint32_t>(poolSizes.size()),
+            poolSizes.data(),
+        });
+    descriptorSet = device.getDevice()
+                        .allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+                            descriptorPool, 1, &descriptorSetLayout})
+                        .front();
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create bindless descriptor set. Error: {}", e.what()));
+  }
+
+  log(LogLevel::Info, "Bindless descriptors: {} textures, {} buffers",
+      textures.capacity, buffers.capacity);
+}
+
+XveBindlessDescriptors::~XveBindlessDescriptors() {
+  device.getDevice().destroyDescriptorPool(descriptorPool);
+  device.getDevice().destroyDescriptorSetLayout(descriptorSetLayout);
+}
+
+XveBindlessDescriptors::Handle
+XveBindlessDescriptors::registerTexture(vk::ImageView imageView,
+                                        vk::Sampler sampler,
+                                        vk::ImageLayout layout) {
+  auto handle = textures.acquire();
+  if (handle == INVALID_HANDLE) {
+    throw std::runtime_error(std::format(
+        "Bindless texture array is full ({} slots)", textures.capacity));
+  }
+
+  auto imageInfo = vk::DescriptorImageInfo{sampler, imageView, layout};
+  auto write = vk::WriteDescriptorSet{
+      descriptorSet, TEXTURE_BINDING, handle, 1,
+      vk::DescriptorType::eCombinedImageSampler, &imageInfo,
+  };
+  device.getDevice().updateDescriptorSets(write, {});
+  return handle;
+}
+
+XveBindlessDescriptors::Handle
+XveBindlessDescriptors::registerBuffer(vk::Buffer buffer,
+                                       vk::DeviceSize offset,
+                                       vk::DeviceSize range) {
+  auto handle = buffers.acquire();
+  if (handle == INVALID_HANDLE) {
+    throw std::runtime_error(std::format(
+        "Bindless buffer array is full ({} slots)", buffers.capacity));
+  }
+
+  auto bufferInfo = vk::DescriptorBufferInfo{buffer, offset, range};
+  auto write = vk::WriteDescriptorSet{
+      descriptorSet, BUFFER_BINDING, handle, 1,
+      vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfo,
+  };
+  device.getDevice().updateDescriptorSets(write, {});
+  return handle;
+}
+
+void XveBindlessDescriptors::releaseTexture(Handle handle,
+                                            uint64_t retireValue) {
+  pendingFrees.push(retireValue,
+                    [this, handle]() { textures.release(handle); });
+}
+
+void XveBindlessDescriptors::releaseBuffer(Handle handle,
+                                           uint64_t retireValue) {
+  pendingFrees.push(retireValue,
+                    [this, handle]() { buffers.release(handle); });
+}
+
+void XveBindlessDescriptors::bind(vk::CommandBuffer commandBuffer,
+                                  vk::PipelineLayout layout,
+                                  vk::PipelineBindPoint bindPoint) const {
+  commandBuffer.bindDescriptorSets(bindPoint, layout, 0, descriptorSet, {});
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_deletion_queue.hpp"
+#include "xve_device.hpp"
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// A single descriptor set holding every texture and storage buffer the
+/// renderer knows about. Resources are registered once and referenced from
+/// shaders by the returned handle (e.g. through a push constant), so the set
+/// is bound once per command buffer rather than once per draw:
+///
+///   layout(set = 0, binding = 0) uniform sampler2D textures[];
+///   layout(set = 0, binding = 1) readonly buffer Buffers { ... } buffers[];
+///
+/// Both arrays are update-after-bind and partially bound, so registering a
+/// resource never waits on frames that have the set bound.
+class XveBindlessDescriptors : Logger {
+public:
+  using Handle = uint32_t;
+
+  static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+  static constexpr uint32_t TEXTURE_BINDING = 0;
+  static constexpr uint32_t BUFFER_BINDING = 1;
+  /// Upper bounds; the actual capacities are clamped to device limits.
+  static constexpr uint32_t MAX_TEXTURES = 16384;
+  static constexpr uint32_t MAX_BUFFERS = 16384;
+
+  static bool isSupported(const XveDevice &device) {
+    return device.getFeatures().descriptorIndexing;
+  }
+
+  explicit XveBindlessDescriptors(XveDevice &deviceRef);
+  ~XveBindlessDescriptors();
+
+  XveBindlessDescriptors(const XveBindlessDescriptors &) = delete;
+  XveBindlessDescriptors &operator=(const XveBindlessDescriptors &) = delete;
+
+  /// Not thread-safe; register from the thread that records frames.
+  Handle registerTexture(
+      vk::ImageView imageView, vk::Sampler sampler,
+      vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+  Handle registerBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0,
+                        vk::DeviceSize range = vk::WholeSize);
+
+  /// Frees the slot once reclaim() reports `retireValue` as completed, so
+  /// frames still in flight never see it rewritten. `retireValue` is the
+  /// caller's frame counter for the last frame that may use the handle.
+  void releaseTexture(Handle handle, uint64_t retireValue);
+  void releaseBuffer(Handle handle, uint64_t retireValue);
+  /// Returns released slots whose frames have finished to the free lists.
+  void reclaim(uint64_t completedValue) { pendingFrees.flush(completedValue); }
+
+  /// Binds the set at index 0 of `layout`.
+  void bind(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout,
+            vk::PipelineBindPoint bindPoint =
+                vk::PipelineBindPoint::eGraphics) const;
+
+  vk::DescriptorSetLayout getLayout() const { return descriptorSetLayout; }
+  vk::DescriptorSet getDescriptorSet() const { return descriptorSet; }
+  uint32_t getTextureCapacity() const { return textures.capacity; }
+  uint32_t getBufferCapacity() const { return buffers.capacity; }
+  uint32_t getTextureCount() const { return textures.liveCount; }
+  uint32_t getBufferCount() const { return buffers.liveCount; }
+
+private:
+  /// Hands out array slots, reusing freed ones before growing.
+  struct SlotList {
+    uint32_t capacity = 0;
+    uint32_t nextSlot = 0;
+    uint32_t liveCount = 0;
+    std::vector<Handle> freeSlots;
+
+    Handle acquire();
+    void release(Handle handle);
+  };
+
+  XveDevice &device;
+  vk::DescriptorSetLayout descriptorSetLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::DescriptorSet descriptorSet;
+
+  SlotList textures;
+  SlotList buffers;
+  XveDeletionQueue pendingFrees;
+};
@@ -0,0 +1,153 @@
+#include "xve_command_recorder.hpp"
+
+#include <algorithm>
+#include <future>
+
+XveCommandRecorder::XveCommandRecorder(XveDevice &deviceRef,
+                                       uint32_t framesInFlight,
+                                       uint32_t threadCount)
+    : device(deviceRef), workers(threadCount) {
+  auto commandPoolCreateInfo = vk::CommandPoolCreateInfo{
+      vk::CommandPoolCreateFlagBits::eTransient,
+      device.getGraphicsQueueFamily(),
+  };
+
+  contexts.resize(framesInFlight);
+  for (auto &frameContexts : contexts) {
+    frameContexts.resize(workers.size());
+    for (auto &context : frameContexts) {
+      try {
+        context.commandPool =
+            device.getDevice().createCommandPool(commandPoolCreateInfo);
+      } catch (const vk::SystemError &e) {
+        throw std::runtime_error(std::format(
+            "Failed to create recording command pool. Error: {}", e.what()));
+      }
+    }
+  }
+
+  log(LogLevel::Info, "Recording draws on {} worker threads", workers.size());
+}
+
+XveCommandRecorder::~XveCommandRecorder() {
+  for (auto &frameContexts : contexts) {
+    for (auto &context : frameContexts) {
+      device.getDevice().destroyCommandPool(context.commandPool);
+    }
+  }
+}
+
+void XveCommandRecorder::beginFrame(uint32_t frameIndex) {
+  for (auto &context : contexts[frameIndex]) {
+    device.getDevice().resetCommandPool(context.commandPool);
+    context.usedCount = 0;
+  }
+}
+
+vk::CommandBuffer
+XveCommandRecorder::nextCommandBuffer(RecordingContext &context) {
+  if (context.usedCount == context.commandBuffers.size()) {
+    auto allocInfo = vk::CommandBufferAllocateInfo{
+        context.commandPool,
+        vk::CommandBufferLevel::eSecondary,
+        1,
+    };
+    context.commandBuffers.push_back(
+        device.getDevice().allocateCommandBuffers(allocInfo).front());
+  }
+  return context.commandBuffers[context.usedCount++];
+}
+
+std::vector<vk::CommandBuffer> XveCommandRecorder::record(
+    uint32_t frameIndex,
+    const vk::CommandBufferInheritanceInfo &inheritanceInfo,
+    vk::Extent2D extent, const std::vector<XveDrawCommand> &draws) {
+  if (draws.empty()) {
+    return {};
+  }
+
+  auto drawCount = static_cast<uint32_t>(draws.size());
+  auto chunkCount = std::clamp(drawCount / MIN_DRAWS_PER_THREAD, 1u,
+                               workers.size());
+  auto chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+
+  auto viewport = vk::Viewport{
+      0.0f,
+      0.0f,
+      static_cast<float>(extent.width),
+      static_cast<float>(extent.height),
+      0.0f,
+      1.0f,
+  };
+  auto scissor = vk::Rect2D{vk::Offset2D{0, 0}, extent};
+
+  auto recordChunk = [&](uint32_t chunk) {
+    auto commandBuffer = nextCommandBuffer(contexts[frameIndex][chunk]);
+
+    auto beginInfo = vk::CommandBufferBeginInfo{
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+            vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        &inheritanceInfo,
+    };
+    commandBuffer.begin(beginInfo);
+    commandBuffer.setViewport(0, viewport);
+    commandBuffer.setScissor(0, scissor);
+    if (bindless) {
+      bindless->bind(commandBuffer, bindlessLayout);
+    }
+
+    XvePipeline *boundPipeline = nullptr;
+    XveGeometryPool *boundPool = nullptr;
+    vk::Buffer boundInstanceBuffer;
+    vk::DeviceSize boundInstanceOffset = 0;
+    auto end = std::min(drawCount, (chunk + 1) * chunkSize);
+    for (auto i = chunk * chunkSize; i < end; i++) {
+      auto &draw = draws[i];
+      if (draw.pipeline != boundPipeline) {
+        draw.pipeline->bind(commandBuffer);
+        boundPipeline = draw.pipeline;
+      }
+      if (&draw.model->getPool() != boundPool) {
+        draw.model->bind(commandBuffer);
+        boundPool = &draw.model->getPool();
+      }
+      if (draw.instanceBuffer != boundInstanceBuffer ||
+          draw.instanceOffset != boundInstanceOffset) {
+        XveModel::bindInstances(commandBuffer, draw.instanceBuffer,
+                                draw.instanceOffset);
+        boundInstanceBuffer = draw.instanceBuffer;
+        boundInstanceOffset = draw.instanceOffset;
+      }
+      draw.model->draw(commandBuffer, draw.instanceCount,
+                       draw.firstInstance);
+    }
+
+    commandBuffer.end();
+    return commandBuffer;
+  };
+
+  if (chunkCount == 1) {
+    return {recordChunk(0)};
+  }
+
+  std::vector<std::future<vk::CommandBuffer>> jobs;
+  jobs.reserve(chunkCount);
+  for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+    jobs.push_back(workers.submit([&recordChunk, chunk]() {
+      return recordChunk(chunk);
+    }));
+  }
+
+  // Every job references this stack frame, so all of them must finish before
+  // an exception from any one is allowed to propagate.
+  for (auto &job : jobs) {
+    job.wait();
+  }
+
+  std::vector<vk::CommandBuffer> commandBuffers;
+  commandBuffers.reserve(chunkCount);
+  for (auto &job : jobs) {
+    commandBuffers.push_back(job.get());
+  }
+  return commandBuffers;
+}
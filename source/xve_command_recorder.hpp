@@ -0,0 +1,79 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_bindless_descriptors.hpp"
+#include "xve_device.hpp"
+#include "xve_model.hpp"
+#include "xve_pipeline.hpp"
+#include "xve_thread_pool.hpp"
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// Draws `instanceCount` instances of `model`, reading XveModel::Instance
+/// data from `instanceBuffer` at `instanceOffset`, starting at element
+/// `firstInstance`.
+struct XveDrawCommand {
+  XvePipeline *pipeline;
+  XveModel *model;
+  vk::Buffer instanceBuffer;
+  vk::DeviceSize instanceOffset = 0;
+  uint32_t firstInstance = 0;
+  uint32_t instanceCount = 1;
+};
+
+/// Records a frame's draw list into secondary command buffers in parallel.
+/// Every worker slot owns one command pool per frame in flight, so pools are
+/// never shared between threads and are reset wholesale once per frame.
+class XveCommandRecorder : Logger {
+public:
+  /// Below this many draws per worker the split costs more than it saves.
+  static constexpr uint32_t MIN_DRAWS_PER_THREAD = 256;
+
+  XveCommandRecorder(
+      XveDevice &deviceRef, uint32_t framesInFlight,
+      uint32_t threadCount = XveThreadPool::defaultThreadCount());
+  ~XveCommandRecorder();
+
+  XveCommandRecorder(const XveCommandRecorder &) = delete;
+  XveCommandRecorder &operator=(const XveCommandRecorder &) = delete;
+
+  /// Resets the frame's pools. The GPU must be done with that frame.
+  void beginFrame(uint32_t frameIndex);
+
+  /// Returns secondary command buffers, in draw order, to be executed by the
+  /// primary buffer described by `inheritanceInfo`. Each one sets the
+  /// dynamic viewport and scissor to cover `extent`.
+  std::vector<vk::CommandBuffer>
+  record(uint32_t frameIndex,
+         const vk::CommandBufferInheritanceInfo &inheritanceInfo,
+         vk::Extent2D extent, const std::vector<XveDrawCommand> &draws);
+
+  /// Binds `descriptors` through `layout` once at the start of every
+  /// secondary buffer, so draws never bind descriptor sets themselves.
+  /// Pipelines drawn must be layout-compatible with `layout` for set 0.
+  void setBindlessDescriptors(const XveBindlessDescriptors *descriptors,
+                              vk::PipelineLayout layout) {
+    bindless = descriptors;
+    bindlessLayout = layout;
+  }
+
+  uint32_t threadCount() const { return workers.size(); }
+
+private:
+  struct RecordingContext {
+    vk::CommandPool commandPool;
+    std::vector<vk::CommandBuffer> commandBuffers;
+    size_t usedCount = 0;
+  };
+
+  XveDevice &device;
+  // Indexed [frameIndex][worker slot].
+  std::vector<std::vector<RecordingContext>> contexts;
+
+  XveThreadPool workers;
+
+  const XveBindlessDescriptors *bindless = nullptr;
+  vk::PipelineLayout bindlessLayout;
+
+  vk::CommandBuffer nextCommandBuffer(RecordingContext &context);
+};
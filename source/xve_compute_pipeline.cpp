@@ -0,0 +1,59 @@
+#include "xve_compute_pipeline.hpp"
+#include "xve_pipeline.hpp"
+
+#include <chrono>
+
+XveComputePipeline::XveComputePipeline(XveDevice &deviceRef,
+                                       const std::string &compFilepath,
+                                       vk::PipelineLayout pipelineLayout)
+    : device(deviceRef) {
+  auto code = XvePipeline::readFile(compFilepath);
+  log(LogLevel::Info, "Compute Shader Code Size: {}", code.size());
+
+  try {
+    compShaderModule = device.getDevice().createShaderModule(
+        vk::ShaderModuleCreateInfo{
+            vk::ShaderModuleCreateFlags(),
+            static_cast<uint32_t>(code.size()),
+            reinterpret_cast<const uint32_t *>(code.data()),
+        });
+
+    auto createInfo = vk::ComputePipelineCreateInfo{
+        vk::PipelineCreateFlags(),
+        vk::PipelineShaderStageCreateInfo{
+            vk::PipelineShaderStageCreateFlags(),
+            vk::ShaderStageFlagBits::eCompute,
+            compShaderModule,
+            "main",
+        },
+        pipelineLayout,
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    computePipeline =
+        device.getDevice()
+            .createComputePipeline(device.getPipelineCache().get(),
+                                   createInfo)
+            .value;
+
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    log(LogLevel::Debug, "Compute pipeline created in {:.3f} ms",
+        elapsed.count());
+  } catch (const vk::SystemError &e) {
+    device.getDevice().destroyShaderModule(compShaderModule);
+    throw std::runtime_error(std::format(
+        "Failed to create compute pipeline {}. Error: {}", compFilepath,
+        e.what()));
+  }
+}
+
+XveComputePipeline::~XveComputePipeline() {
+  device.getDevice().destroyPipeline(computePipeline);
+  device.getDevice().destroyShaderModule(compShaderModule);
+}
+
+void XveComputePipeline::bind(vk::CommandBuffer commandBuffer) {
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                             computePipeline);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+/// A compute shader and its pipeline, built through the device-wide
+/// pipeline cache. The layout is owned by the caller.
+class XveComputePipeline : Logger {
+public:
+  XveComputePipeline(XveDevice &deviceRef, const std::string &compFilepath,
+                     vk::PipelineLayout pipelineLayout);
+  ~XveComputePipeline();
+
+  XveComputePipeline(const XveComputePipeline &) = delete;
+  XveComputePipeline &operator=(const XveComputePipeline &) = delete;
+
+  void bind(vk::CommandBuffer commandBuffer);
+
+private:
+  XveDevice &device;
+
+  vk::ShaderModule compShaderModule;
+  vk::Pipeline computePipeline;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+/// Defers destruction of GPU objects until the frames that may still
+/// reference them are known to be finished. Entries are tagged with a
+/// monotonically increasing value (e.g. a frame counter) and run in order
+/// once the caller reports that value as completed.
+class XveDeletionQueue {
+private:
+  struct Entry {
+    uint64_t retireValue;
+    std::function<void()> deleter;
+  };
+
+  std::deque<Entry> entries;
+
+public:
+  ~XveDeletionQueue() { flushAll(); }
+
+  void push(uint64_t retireValue, std::function<void()> deleter) {
+    entries.push_back({retireValue, std::move(deleter)});
+  }
+
+  void flush(uint64_t completedValue) {
+    while (!entries.empty() && entries.front().retireValue <= completedValue) {
+      auto deleter = std::move(entries.front().deleter);
+      entries.pop_front();
+      deleter();
+    }
+  }
+
+  void flushAll() {
+    while (!entries.empty()) {
+      auto deleter = std::move(entries.front().deleter);
+      entries.pop_front();
+      deleter();
+    }
+  }
+
+  bool empty() const { return entries.empty(); }
+};
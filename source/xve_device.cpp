@@ -35,17 +35,33 @@ debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
   return VK_SUCCESS;
 }
 
-XveDevice::XveDevice(XveWindow &windowRef) : window(windowRef) {
+XveDevice::XveDevice(XveWindow *windowPtr) : window(windowPtr) {
+  // 1.2 is the minimum; 1.3 is requested when the loader has it so that
+  // optional 1.3 features can be enabled on devices that support them.
+  instanceApiVersion = vk::enumerateInstanceVersion() >= VK_API_VERSION_1_3
+                           ? VK_API_VERSION_1_3
+                           : VK_API_VERSION_1_2;
+
   vkb::InstanceBuilder builder;
+  if (window) {
+    builder.enable_extensions(window->getVkInstanceExtensions());
+  } else {
+    builder.set_headless(true);
+  }
   vkb::Instance bInstance =
       builder.set_app_name(APP_NAME)
           .set_app_version(VK_MAKE_VERSION(APP_VMAJOR, APP_VMINOR, APP_VPATCH))
           .set_engine_name(ENGINE_NAME)
           .set_engine_version(
               VK_MAKE_VERSION(ENGINE_VMAJOR, ENGINE_VMINOR, ENGINE_VPATCH))
+          .require_api_version(instanceApiVersion)
           .request_validation_layers()
+          // Verbose validation output is only requested when Debug
+          // messages aren't compiled out anyway.
           .add_debug_messenger_severity(
-              VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+              (MIN_LOG_LEVEL <= LogLevel::Debug
+                   ? VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
+                   : 0) |
               VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
               VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
           .add_debug_messenger_type(
@@ -54,7 +70,6 @@ XveDevice::XveDevice(XveWindow &windowRef) : window(windowRef) {
               VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
               VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)
           .set_debug_callback(debugCallback)
-          .enable_extensions(window.getVkInstanceExtensions())
           .build()
           .value();
 
@@ -65,37 +80,184 @@ XveDevice::XveDevice(XveWindow &windowRef) : window(windowRef) {
   instance = bInstance.instance;
   debugMessenger = bInstance.debug_messenger;
 
-  VkSurfaceKHR cSurface;
-
-  window.createSurface(instance, &cSurface);
-  surface = cSurface;
-
   vkb::PhysicalDeviceSelector physicalDeviceSelector{bInstance};
-  vkb::PhysicalDevice bPhysicalDevice =
-      physicalDeviceSelector.set_surface(surface).select().value();
+  if (window) {
+    VkSurfaceKHR cSurface;
+    window->createSurface(instance, &cSurface);
+    surface = cSurface;
+    physicalDeviceSelector.set_surface(surface);
+  }
+
+  // Headless runs (e.g. lavapipe in CI) accept CPU devices as well.
+  auto bSelectedDevice = physicalDeviceSelector.set_minimum_version(1, 2)
+                             .allow_any_gpu_device_type(true)
+                             .select();
+  if (!bSelectedDevice) {
+    throw std::runtime_error(std::format("Failed to select GPU: {}",
+                                         bSelectedDevice.error().message()));
+  }
+  vkb::PhysicalDevice bPhysicalDevice = bSelectedDevice.value();
+  log(LogLevel::Info, "Using {}{}", bPhysicalDevice.name,
+      window ? "" : " (headless)");
 
   physicalDevice = bPhysicalDevice.physical_device;
 
+  enableOptionalFeatures(bPhysicalDevice);
   vkb::DeviceBuilder deviceBuilder{bPhysicalDevice};
+  deviceBuilder.add_pNext(&enabledFeatures12);
+  if (features.dynamicRendering) {
+    deviceBuilder.add_pNext(&enabledFeatures13);
+  }
   bDevice = deviceBuilder.build().value();
 
   device = bDevice.device;
 
   graphicsQueue = bDevice.get_queue(vkb::QueueType::graphics).value();
-  presentQueue = bDevice.get_queue(vkb::QueueType::present).value();
+  presentQueue = window ? bDevice.get_queue(vkb::QueueType::present).value()
+                        : graphicsQueue;
+  graphicsQueueFamily =
+      bDevice.get_queue_index(vkb::QueueType::graphics).value();
 
+  // Prefer separate transfer and compute families so uploads and async
+  // compute don't serialize with rendering; fall back to the graphics queue
+  // when there is none.
+  auto [transfer, transferFamily] = selectQueue(vkb::QueueType::transfer);
+  transferQueue = transfer;
+  transferQueueFamily = transferFamily;
+  auto [compute, computeFamily] = selectQueue(vkb::QueueType::compute);
+  computeQueue = compute;
+  computeQueueFamily = computeFamily;
+  log(LogLevel::Info, "Queue families: graphics {}, transfer {}, compute {}",
+      graphicsQueueFamily, transferQueueFamily, computeQueueFamily);
+
+  commandPool = createCommandPool(graphicsQueueFamily);
+  transferCommandPool = hasTransferQueue()
+                            ? createCommandPool(transferQueueFamily)
+                            : commandPool;
+  if (computeQueueFamily == transferQueueFamily) {
+    computeCommandPool = transferCommandPool;
+  } else {
+    computeCommandPool = hasComputeQueue()
+                             ? createCommandPool(computeQueueFamily)
+                             : commandPool;
+  }
+
+  allocator = std::make_unique<XveMemoryAllocator>(physicalDevice, device);
+  pipelineCache = std::make_unique<XvePipelineCache>(
+      physicalDevice, device, PIPELINE_CACHE_FILE);
+}
+
+void XveDevice::enableOptionalFeatures(vkb::PhysicalDevice &bPhysicalDevice) {
+  auto supportedChain =
+      physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                  vk::PhysicalDeviceVulkan12Features>();
+  auto &supported = supportedChain.get<vk::PhysicalDeviceFeatures2>().features;
+  auto &supported12 = supportedChain.get<vk::PhysicalDeviceVulkan12Features>();
+
+  enabledFeatures12 = vk::PhysicalDeviceVulkan12Features{};
+  enabledFeatures12.timelineSemaphore = supported12.timelineSemaphore;
+  features.timelineSemaphore = supported12.timelineSemaphore;
+
+  features.drawIndirectCount =
+      supported12.drawIndirectCount && supported.multiDrawIndirect;
+  if (features.drawIndirectCount) {
+    enabledFeatures12.drawIndirectCount = VK_TRUE;
+    VkPhysicalDeviceFeatures coreFeatures{};
+    coreFeatures.multiDrawIndirect = VK_TRUE;
+    bPhysicalDevice.enable_features_if_present(coreFeatures);
+  }
+
+  features.descriptorIndexing =
+      supported12.runtimeDescriptorArray &&
+      supported12.descriptorBindingPartiallyBound &&
+      supported12.descriptorBindingUpdateUnusedWhilePending &&
+      supported12.descriptorBindingSampledImageUpdateAfterBind &&
+      supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+      supported12.shaderSampledImageArrayNonUniformIndexing &&
+      supported12.shaderStorageBufferArrayNonUniformIndexing;
+  if (features.descriptorIndexing) {
+    enabledFeatures12.runtimeDescriptorArray = VK_TRUE;
+    enabledFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+    enabledFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enabledFeatures12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    enabledFeatures12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  }
+
+  enabledFeatures13 = vk::PhysicalDeviceVulkan13Features{};
+  if (instanceApiVersion >= VK_API_VERSION_1_3 &&
+      physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_3) {
+    auto supportedChain13 =
+        physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                    vk::PhysicalDeviceVulkan13Features>();
+    auto &supported13 =
+        supportedChain13.get<vk::PhysicalDeviceVulkan13Features>();
+    features.dynamicRendering =
+        supported13.dynamicRendering && supported13.synchronization2;
+    if (features.dynamicRendering) {
+      enabledFeatures13.dynamicRendering = VK_TRUE;
+      enabledFeatures13.synchronization2 = VK_TRUE;
+    }
+  }
+
+  features.memoryBudget = bPhysicalDevice.enable_extension_if_present(
+      VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+  log(LogLevel::Info,
+      "Optional features: timelineSemaphore={}, drawIndirectCount={}, "
+      "descriptorIndexing={}, dynamicRendering={}, memoryBudget={}",
+      features.timelineSemaphore, features.drawIndirectCount,
+      features.descriptorIndexing, features.dynamicRendering,
+      features.memoryBudget);
+}
+
+std::pair<vk::Queue, uint32_t> XveDevice::selectQueue(vkb::QueueType type) {
+  // A dedicated family (no graphics, and for transfer no compute either)
+  // usually maps to its own hardware engine; any other separate family is
+  // the next best thing.
+  auto dedicatedIndex = bDevice.get_dedicated_queue_index(type);
+  if (dedicatedIndex.has_value()) {
+    return {bDevice.get_dedicated_queue(type).value(),
+            dedicatedIndex.value()};
+  }
+  auto index = bDevice.get_queue_index(type);
+  if (index.has_value()) {
+    return {bDevice.get_queue(type).value(), index.value()};
+  }
+  return {graphicsQueue, graphicsQueueFamily};
+}
+
+vk::CommandPool XveDevice::createCommandPool(uint32_t queueFamily) {
   auto commandPoolCreateInfo = vk::CommandPoolCreateInfo{
       vk::CommandPoolCreateFlagBits::eTransient |
           vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-      bDevice.get_queue_index(vkb::QueueType::graphics).value()};
+      queueFamily};
 
-  commandPool = device.createCommandPool(commandPoolCreateInfo);
+  try {
+    return device.createCommandPool(commandPoolCreateInfo);
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create command pool for queue family {}. Error: {}",
+        queueFamily, e.what()));
+  }
 }
 
 XveDevice::~XveDevice() {
+  pipelineCache.reset();
+  allocator.reset();
+  if (computeCommandPool != commandPool &&
+      computeCommandPool != transferCommandPool) {
+    device.destroyCommandPool(computeCommandPool);
+  }
+  if (transferCommandPool != commandPool) {
+    device.destroyCommandPool(transferCommandPool);
+  }
   device.destroyCommandPool(commandPool);
   device.destroy();
-  instance.destroySurfaceKHR(surface);
+  if (surface) {
+    instance.destroySurfaceKHR(surface);
+  }
   vkb::destroy_debug_utils_messenger(instance, debugMessenger);
   instance.destroy();
 }
@@ -124,7 +286,8 @@ uint32_t XveDevice::findMemoryType(uint32_t typeFilter,
   auto memProperties = physicalDevice.getMemoryProperties();
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
     if ((typeFilter & (1 << i)) &&
-        (memProperties.memoryTypes[i].propertyFlags & properties)) {
+        (memProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
       return i;
     }
   }
@@ -135,24 +298,62 @@ uint32_t XveDevice::findMemoryType(uint32_t typeFilter,
 void XveDevice::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
                              vk::MemoryPropertyFlags properties,
                              vk::Buffer &buffer,
-                             vk::DeviceMemory &bufferMemory) {
+                             XveAllocation &bufferAllocation,
+                             XveMemoryCategory category,
+                             const std::vector<uint32_t> &queueFamilies) {
   auto bufferInfo = vk::BufferCreateInfo{
       {},
       size,
       usage,
       vk::SharingMode::eExclusive,
   };
+  if (queueFamilies.size() > 1) {
+    bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+    bufferInfo.queueFamilyIndexCount =
+        static_cast<uint32_t>(queueFamilies.size());
+    bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+  }
 
   buffer = device.createBuffer(bufferInfo);
 
   auto memRequirements = device.getBufferMemoryRequirements(buffer);
 
-  auto allocInfo = vk::MemoryAllocateInfo{
-      memRequirements.size,
+  bufferAllocation = allocator->allocate(
+      memRequirements,
       findMemoryType(memRequirements.memoryTypeBits, properties),
-  };
+      XveMemoryAllocator::ResourceKind::Linear, category);
 
-  bufferMemory = device.allocateMemory(allocInfo);
+  device.bindBufferMemory(buffer, bufferAllocation.memory,
+                          bufferAllocation.offset);
+}
+
+void XveDevice::destroyBuffer(vk::Buffer buffer,
+                              XveAllocation &bufferAllocation) {
+  device.destroyBuffer(buffer);
+  allocator->free(bufferAllocation);
+}
+
+void XveDevice::createImage(const vk::ImageCreateInfo &imageInfo,
+                            vk::MemoryPropertyFlags properties,
+                            vk::Image &image, XveAllocation &imageAllocation,
+                            XveMemoryCategory category) {
+  image = device.createImage(imageInfo);
+
+  auto memRequirements = device.getImageMemoryRequirements(image);
+
+  auto kind = imageInfo.tiling == vk::ImageTiling::eLinear
+                  ? XveMemoryAllocator::ResourceKind::Linear
+                  : XveMemoryAllocator::ResourceKind::Optimal;
+  imageAllocation = allocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties), kind,
+      category);
+
+  device.bindImageMemory(image, imageAllocation.memory,
+                         imageAllocation.offset);
+}
 
-  device.bindBufferMemory(buffer, bufferMemory, 0);
+void XveDevice::destroyImage(vk::Image image, XveAllocation &imageAllocation) {
+  device.destroyImage(image);
+  allocator->free(imageAllocation);
 }
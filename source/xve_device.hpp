@@ -1,12 +1,33 @@
 #pragma once
 
+#include "xve_memory_allocator.hpp"
+#include "xve_pipeline_cache.hpp"
 #include "xve_window.hpp"
 #include <VkBootstrap.h>
+#include <memory>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 
-class XveDevice {
+class XveDevice : Logger {
+public:
+  /// Optional capabilities, enabled when the physical device supports them.
+  struct Features {
+    bool timelineSemaphore = false;
+    /// vkCmdDrawIndexedIndirectCount with more than one draw; needs both the
+    /// 1.2 drawIndirectCount and the core multiDrawIndirect feature.
+    bool drawIndirectCount = false;
+    /// The descriptor indexing subset bindless sets rely on: partially bound,
+    /// update-after-bind runtime arrays indexed non-uniformly.
+    bool descriptorIndexing = false;
+    /// Vulkan 1.3 dynamic rendering together with synchronization2, for
+    /// rendering without render pass and framebuffer objects.
+    bool dynamicRendering = false;
+    /// VK_EXT_memory_budget, for the driver's per-heap budget and usage.
+    bool memoryBudget = false;
+  };
+
 private:
   vk::Instance instance;
   vk::DebugUtilsMessengerEXT debugMessenger;
@@ -15,24 +36,80 @@ private:
   vk::Device device;
   vk::Queue graphicsQueue;
   vk::Queue presentQueue;
+  vk::Queue transferQueue;
+  vk::Queue computeQueue;
+  uint32_t graphicsQueueFamily;
+  uint32_t transferQueueFamily;
+  uint32_t computeQueueFamily;
   vk::CommandPool commandPool;
+  vk::CommandPool transferCommandPool;
+  vk::CommandPool computeCommandPool;
 
   vkb::Device bDevice;
 
-  XveWindow &window;
+  Features features;
+  // Must outlive device creation; vk-bootstrap only stores the pointer.
+  vk::PhysicalDeviceVulkan12Features enabledFeatures12;
+  vk::PhysicalDeviceVulkan13Features enabledFeatures13;
+  uint32_t instanceApiVersion;
+
+  std::unique_ptr<XveMemoryAllocator> allocator;
+  std::unique_ptr<XvePipelineCache> pipelineCache;
+
+  // Null when headless: no surface, no present queue, no swapchain.
+  XveWindow *window;
+
+  /// Must run before the DeviceBuilder copies `bPhysicalDevice`.
+  void enableOptionalFeatures(vkb::PhysicalDevice &bPhysicalDevice);
+  /// The most independent queue of `type`, or the graphics queue.
+  std::pair<vk::Queue, uint32_t> selectQueue(vkb::QueueType type);
+  vk::CommandPool createCommandPool(uint32_t queueFamily);
 
 public:
-  XveDevice(XveWindow &windowRef);
+  /// Pass nullptr for a headless device that can only render offscreen.
+  explicit XveDevice(XveWindow *windowPtr);
   ~XveDevice();
 
+  bool isHeadless() const { return window == nullptr; }
+
   vk::Instance getInstance() const { return instance; }
   vk::PhysicalDevice getPhysicalDevice() const { return physicalDevice; }
   vk::Device getDevice() const { return device; }
   vk::Queue getGraphicsQueue() const { return graphicsQueue; }
   vk::Queue getPresentQueue() const { return presentQueue; }
+  vk::Queue getTransferQueue() const { return transferQueue; }
+  /// The same VkQueue as getTransferQueue() when compute and transfer share
+  /// a family. Submits to it from several threads then need external
+  /// synchronization, as vkQueueSubmit requires.
+  vk::Queue getComputeQueue() const { return computeQueue; }
+  uint32_t getGraphicsQueueFamily() const { return graphicsQueueFamily; }
+  uint32_t getTransferQueueFamily() const { return transferQueueFamily; }
+  uint32_t getComputeQueueFamily() const { return computeQueueFamily; }
+  /// Whether transfers and async compute run on a family other than the
+  /// graphics one. Resources they share with rendering then need concurrent
+  /// sharing or a queue family ownership transfer, and the graphics queue
+  /// must wait on a semaphore for their results.
+  bool hasTransferQueue() const {
+    return transferQueueFamily != graphicsQueueFamily;
+  }
+  bool hasComputeQueue() const {
+    return computeQueueFamily != graphicsQueueFamily;
+  }
+  /// For one-off work on the graphics queue. Not thread-safe.
   vk::CommandPool getCommandPool() const { return commandPool; }
+  /// For work on the transfer and compute queues, such as the upload
+  /// manager's copies; the graphics pool when the device has no separate
+  /// family. The compute pool is the transfer one when those families match.
+  /// Not thread-safe.
+  vk::CommandPool getTransferCommandPool() const {
+    return transferCommandPool;
+  }
+  vk::CommandPool getComputeCommandPool() const { return computeCommandPool; }
 
   vkb::Device getBDevice() const { return bDevice; }
+  const Features &getFeatures() const { return features; }
+  XveMemoryAllocator &getAllocator() const { return *allocator; }
+  XvePipelineCache &getPipelineCache() const { return *pipelineCache; }
 
   vk::Format findSupportedFormat(const std::vector<vk::Format> &candidates,
                                  vk::ImageTiling tiling,
@@ -42,5 +119,14 @@ public:
 
   void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
                     vk::MemoryPropertyFlags properties, vk::Buffer &buffer,
-                    vk::DeviceMemory &bufferMemory);
+                    XveAllocation &bufferAllocation,
+                    XveMemoryCategory category = XveMemoryCategory::Other,
+                    const std::vector<uint32_t> &queueFamilies = {});
+  void destroyBuffer(vk::Buffer buffer, XveAllocation &bufferAllocation);
+
+  void createImage(const vk::ImageCreateInfo &imageInfo,
+                   vk::MemoryPropertyFlags properties, vk::Image &image,
+                   XveAllocation &imageAllocation,
+                   XveMemoryCategory category = XveMemoryCategory::Other);
+  void destroyImage(vk::Image image, XveAllocation &imageAllocation);
 };
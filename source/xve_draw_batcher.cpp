@@ -0,0 +1,64 @@
+#include "xve_draw_batcher.hpp"
+
+void XveDrawBatcher::build(XveFrameContext &frame,
+                           const XvePipelineManager &pipelineManager,
+                           const std::vector<XveRenderObject> &objects,
+                           std::vector<XveDrawCommand> &draws) {
+  batchIndices.clear();
+  batches.clear();
+  objectBatches.resize(objects.size());
+  lastInstanceCount = 0;
+
+  // Pass 1: assign each object to a batch and count instances. Scenes tend
+  // to list copies of a mesh together, so the previous batch is checked
+  // before the map.
+  uint32_t lastBatch = SKIPPED;
+  for (size_t i = 0; i < objects.size(); i++) {
+    auto *pipeline = pipelineManager.resolve(objects[i].pipeline);
+    if (!pipeline) {
+      objectBatches[i] = SKIPPED;
+      continue;
+    }
+
+    auto key = BatchKey{pipeline, objects[i].model};
+    if (lastBatch == SKIPPED || !(batches[lastBatch].key == key)) {
+      auto [it, inserted] = batchIndices.try_emplace(
+          key, static_cast<uint32_t>(batches.size()));
+      if (inserted) {
+        batches.push_back({key, 0, 0});
+      }
+      lastBatch = it->second;
+    }
+    batches[lastBatch].count++;
+    objectBatches[i] = lastBatch;
+    lastInstanceCount++;
+  }
+  if (lastInstanceCount == 0) {
+    return;
+  }
+
+  uint32_t first = 0;
+  for (auto &batch : batches) {
+    batch.first = first;
+    first += batch.count;
+    batch.count = 0;
+  }
+
+  // Pass 2: scatter instance data so each batch is contiguous.
+  auto allocation =
+      frame.allocateDynamic(sizeof(XveModel::Instance) * lastInstanceCount);
+  auto *instances = static_cast<XveModel::Instance *>(allocation.data);
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (objectBatches[i] == SKIPPED) {
+      continue;
+    }
+    auto &batch = batches[objectBatches[i]];
+    instances[batch.first + batch.count++] = {objects[i].transform,
+                                              objects[i].color};
+  }
+
+  for (auto &batch : batches) {
+    draws.push_back({batch.key.pipeline, batch.key.model, allocation.buffer,
+                     allocation.offset, batch.first, batch.count});
+  }
+}
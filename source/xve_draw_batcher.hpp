@@ -0,0 +1,55 @@
+#pragma once
+
+#include "xve_command_recorder.hpp"
+#include "xve_frame_context.hpp"
+#include "xve_pipeline_manager.hpp"
+#include "xve_render_object.hpp"
+#include <unordered_map>
+#include <vector>
+
+/// Turns render objects into instanced draws: every object sharing a
+/// pipeline and model becomes one instance of a single draw. Instance data
+/// goes into the frame's dynamic buffer. Grouping is two linear passes, so
+/// the cost per object is a hash lookup and an 80-byte copy.
+class XveDrawBatcher {
+public:
+  /// Appends one draw per (pipeline, model) group to `draws`, in order of
+  /// each group's first object. Objects whose pipeline isn't ready (nor the
+  /// fallback) are skipped.
+  void build(XveFrameContext &frame, const XvePipelineManager &pipelineManager,
+             const std::vector<XveRenderObject> &objects,
+             std::vector<XveDrawCommand> &draws);
+
+  uint32_t getLastInstanceCount() const { return lastInstanceCount; }
+
+private:
+  struct BatchKey {
+    XvePipeline *pipeline;
+    XveModel *model;
+
+    bool operator==(const BatchKey &) const = default;
+  };
+
+  struct BatchKeyHash {
+    size_t operator()(const BatchKey &key) const {
+      auto hash = std::hash<const void *>{}(key.pipeline);
+      return hash ^ (std::hash<const void *>{}(key.model) + 0x9e3779b9 +
+                     (hash << 6) + (hash >> 2));
+    }
+  };
+
+  struct Batch {
+    BatchKey key;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  static constexpr uint32_t SKIPPED = ~0u;
+
+  // Scratch storage reused across frames.
+  std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchIndices;
+  std::vector<Batch> batches;
+  std::vector<uint32_t> objectBatches;
+
+  uint32_t lastInstanceCount = 0;
+};
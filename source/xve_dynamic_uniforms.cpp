@@ -0,0 +1,65 @@
+#include "xve_dynamic_uniforms.hpp"
+
+XveDynamicUniforms::XveDynamicUniforms(
+    XveDevice &deviceRef,
+    const std::vector<std::unique_ptr<XveFrameContext>> &frames,
+    vk::DeviceSize payloadSize_, vk::ShaderStageFlags stages)
+    : device(deviceRef), payloadSize(payloadSize_) {
+  auto maxRange =
+      device.getPhysicalDevice().getProperties().limits.maxUniformBufferRange;
+  if (payloadSize > maxRange) {
+    throw std::runtime_error(
+        std::format("Uniform payload of {} bytes exceeds the device's {} "
+                    "byte maxUniformBufferRange",
+                    payloadSize, maxRange));
+  }
+
+  auto frameCount = static_cast<uint32_t>(frames.size());
+  auto binding = vk::DescriptorSetLayoutBinding{
+      0, vk::DescriptorType::eUniformBufferDynamic, 1, stages};
+  auto poolSize = vk::DescriptorPoolSize{
+      vk::DescriptorType::eUniformBufferDynamic, frameCount};
+
+  try {
+    descriptorSetLayout = device.getDevice().createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo{
+            vk::DescriptorSetLayoutCreateFlags(), 1, &binding});
+    descriptorPool = device.getDevice().createDescriptorPool(
+        vk::DescriptorPoolCreateInfo{
+            vk::DescriptorPoolCreateFlags(), frameCount, 1, &poolSize});
+
+    std::vector<vk::DescriptorSetLayout> layouts(frameCount,
+                                                 descriptorSetLayout);
+    descriptorSets = device.getDevice().allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo{descriptorPool, frameCount,
+                                      layouts.data()});
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create dynamic uniform descriptors. Error: {}", e.what()));
+  }
+
+  std::vector<vk::DescriptorBufferInfo> bufferInfos;
+  bufferInfos.reserve(frameCount);
+  std::vector<vk::WriteDescriptorSet> writes;
+  for (uint32_t i = 0; i < frameCount; i++) {
+    bufferInfos.push_back(vk::DescriptorBufferInfo{
+        frames[i]->getDynamicBuffer(), 0, payloadSize});
+    writes.push_back(vk::WriteDescriptorSet{
+        descriptorSets[i], 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic,
+        nullptr, &bufferInfos.back()});
+  }
+  device.getDevice().updateDescriptorSets(writes, {});
+}
+
+XveDynamicUniforms::~XveDynamicUniforms() {
+  device.getDevice().destroyDescriptorPool(descriptorPool);
+  device.getDevice().destroyDescriptorSetLayout(descriptorSetLayout);
+}
+
+void XveDynamicUniforms::bind(vk::CommandBuffer commandBuffer,
+                              uint32_t frameIndex, vk::PipelineLayout layout,
+                              uint32_t setIndex, uint32_t offset,
+                              vk::PipelineBindPoint bindPoint) const {
+  commandBuffer.bindDescriptorSets(bindPoint, layout, setIndex,
+                                   descriptorSets[frameIndex], offset);
+}
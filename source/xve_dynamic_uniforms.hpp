@@ -0,0 +1,62 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include "xve_frame_context.hpp"
+#include "xve_pipeline.hpp"
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// Per-draw data too large for push constants. Payloads are bump-allocated
+/// from each frame's dynamic buffer and reached through one descriptor set
+/// per frame with a dynamic uniform buffer binding, so a draw costs a copy
+/// and a bindDescriptorSets with a new offset; nothing is created per draw.
+class XveDynamicUniforms : Logger {
+public:
+  /// Binding 0 of the set is a uniform block of `payloadSize` bytes.
+  XveDynamicUniforms(
+      XveDevice &deviceRef,
+      const std::vector<std::unique_ptr<XveFrameContext>> &frames,
+      vk::DeviceSize payloadSize,
+      vk::ShaderStageFlags stages = XvePipeline::DEFAULT_PUSH_CONSTANT_STAGES);
+  ~XveDynamicUniforms();
+
+  XveDynamicUniforms(const XveDynamicUniforms &) = delete;
+  XveDynamicUniforms &operator=(const XveDynamicUniforms &) = delete;
+
+  /// Copies `data` into `frame` and returns the dynamic offset to bind().
+  template <class T> uint32_t push(XveFrameContext &frame, const T &data) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Uniform data is copied as raw bytes");
+    if (sizeof(T) > payloadSize) {
+      throw std::runtime_error(
+          std::format("Uniform payload of {} bytes exceeds the {} reserved",
+                      sizeof(T), payloadSize));
+    }
+    // The whole block is reserved so the descriptor's fixed range never
+    // reads past the end of the buffer.
+    auto allocation = frame.allocateDynamic(payloadSize);
+    std::memcpy(allocation.data, &data, sizeof(T));
+    return static_cast<uint32_t>(allocation.offset);
+  }
+
+  void bind(vk::CommandBuffer commandBuffer, uint32_t frameIndex,
+            vk::PipelineLayout layout, uint32_t setIndex, uint32_t offset,
+            vk::PipelineBindPoint bindPoint =
+                vk::PipelineBindPoint::eGraphics) const;
+
+  vk::DescriptorSetLayout getLayout() const { return descriptorSetLayout; }
+  vk::DeviceSize getPayloadSize() const { return payloadSize; }
+
+private:
+  XveDevice &device;
+  vk::DeviceSize payloadSize;
+
+  vk::DescriptorSetLayout descriptorSetLayout;
+  vk::DescriptorPool descriptorPool;
+  // Indexed by frame index, each pointing at that frame's dynamic buffer.
+  std::vector<vk::DescriptorSet> descriptorSets;
+};
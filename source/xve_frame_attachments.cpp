@@ -0,0 +1,139 @@
+#include "xve_frame_attachments.hpp"
+
+static vk::ImageAspectFlags depthAspect(vk::Format format) {
+  switch (format) {
+  case vk::Format::eD16UnormS8Uint:
+  case vk::Format::eD24UnormS8Uint:
+  case vk::Format::eD32SfloatS8Uint:
+    return vk::ImageAspectFlagBits::eDepth |
+           vk::ImageAspectFlagBits::eStencil;
+  default:
+    return vk::ImageAspectFlagBits::eDepth;
+  }
+}
+
+XveFrameAttachments::XveFrameAttachments(XveDevice &deviceRef,
+                                         const XveAttachmentConfig &config)
+    : device(deviceRef), samples(config.samples) {
+  std::vector<vk::Format> candidates = {vk::Format::eD32Sfloat,
+                                        vk::Format::eD32SfloatS8Uint,
+                                        vk::Format::eD24UnormS8Uint};
+  if (config.depthFormat != vk::Format::eUndefined) {
+    candidates.insert(candidates.begin(), config.depthFormat);
+  }
+  depthFormat = device.findSupportedFormat(
+      candidates, vk::ImageTiling::eOptimal,
+      vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+  if (config.depthFormat != vk::Format::eUndefined &&
+      depthFormat != config.depthFormat) {
+    log(LogLevel::Warning, "Depth format {} unsupported, using {}",
+        vk::to_string(config.depthFormat), vk::to_string(depthFormat));
+  }
+
+  auto limits = device.getPhysicalDevice().getProperties().limits;
+  auto supported = limits.framebufferColorSampleCounts &
+                   limits.framebufferDepthSampleCounts;
+  while (samples != vk::SampleCountFlagBits::e1 && !(supported & samples)) {
+    samples = static_cast<vk::SampleCountFlagBits>(
+        static_cast<uint32_t>(samples) >> 1);
+  }
+  if (samples != config.samples) {
+    log(LogLevel::Warning, "{} MSAA unsupported, using {}",
+        vk::to_string(config.samples), vk::to_string(samples));
+  }
+}
+
+XveFrameAttachments::Image
+XveFrameAttachments::createImage(vk::Extent2D extent, vk::Format format,
+                                 vk::ImageUsageFlags usage,
+                                 vk::ImageAspectFlags aspect) {
+  Image result;
+  auto imageInfo = vk::ImageCreateInfo{
+      vk::ImageCreateFlags(),
+      vk::ImageType::e2D,
+      format,
+      vk::Extent3D{extent.width, extent.height, 1},
+      1,
+      1,
+      samples,
+      vk::ImageTiling::eOptimal,
+      usage,
+      vk::SharingMode::eExclusive,
+      {},
+      {},
+      vk::ImageLayout::eUndefined,
+  };
+
+  try {
+    device.createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                       result.image, result.allocation,
+                       XveMemoryCategory::Attachments);
+    result.view = device.getDevice().createImageView(vk::ImageViewCreateInfo{
+        vk::ImageViewCreateFlags(),
+        result.image,
+        vk::ImageViewType::e2D,
+        format,
+        {},
+        {aspect, 0, 1, 0, 1},
+    });
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create frame attachment. Error: {}", e.what()));
+  }
+  return result;
+}
+
+void XveFrameAttachments::create(vk::Extent2D extent, vk::Format colorFormat,
+                                 uint32_t frameCount) {
+  // Neither survives the render pass (depth isn't stored, MSAA color is
+  // resolved), which lets tilers keep them on chip.
+  for (uint32_t i = 0; i < frameCount; i++) {
+    depthImages.push_back(
+        createImage(extent, depthFormat,
+                    vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                        vk::ImageUsageFlagBits::eTransientAttachment,
+                    depthAspect(depthFormat)));
+    if (isMultisampled()) {
+      colorImages.push_back(
+          createImage(extent, colorFormat,
+                      vk::ImageUsageFlagBits::eColorAttachment |
+                          vk::ImageUsageFlagBits::eTransientAttachment,
+                      vk::ImageAspectFlagBits::eColor));
+    }
+  }
+}
+
+void XveFrameAttachments::destroy() {
+  for (auto *images : {&depthImages, &colorImages}) {
+    for (auto &image : *images) {
+      device.getDevice().destroyImageView(image.view);
+      device.destroyImage(image.image, image.allocation);
+    }
+  }
+  release();
+}
+
+void XveFrameAttachments::release() {
+  depthImages.clear();
+  colorImages.clear();
+}
+
+vk::DeviceSize XveFrameAttachments::getMemoryBytes() const {
+  vk::DeviceSize bytes = 0;
+  for (auto *images : {&depthImages, &colorImages}) {
+    for (auto &image : *images) {
+      bytes += image.allocation.size;
+    }
+  }
+  return bytes;
+}
+
+vk::DeviceSize XveFrameAttachments::getSetMemoryBytes() const {
+  vk::DeviceSize bytes = 0;
+  for (auto *images : {&depthImages, &colorImages}) {
+    if (!images->empty()) {
+      bytes += images->front().allocation.size;
+    }
+  }
+  return bytes;
+}
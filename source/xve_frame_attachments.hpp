@@ -0,0 +1,69 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct XveAttachmentConfig {
+  /// eUndefined picks the most precise supported format. D16 or X8_D24
+  /// save depth memory and bandwidth; an unsupported choice falls back to
+  /// the default with a warning.
+  vk::Format depthFormat = vk::Format::eUndefined;
+  /// Above e1, draws go to multisampled color and depth that are resolved
+  /// into the target's image. Lowered to what the device supports.
+  vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+};
+
+/// The depth buffer and, with MSAA, the multisampled color a target draws
+/// into before resolving, one set per frame in flight. A frame slot is only
+/// reused once its previous submission has finished, so sets beyond that
+/// (e.g. one per swapchain image) would never be in use at the same time.
+///
+/// Holds handles only: copies refer to the same images and exactly one of
+/// them destroy()s them. release() forgets the images without destroying
+/// them, once a copy has been handed to a deletion queue.
+class XveFrameAttachments : Logger {
+public:
+  XveFrameAttachments(XveDevice &deviceRef, const XveAttachmentConfig &config);
+
+  void create(vk::Extent2D extent, vk::Format colorFormat,
+              uint32_t frameCount);
+  void destroy();
+  void release();
+
+  vk::Format getDepthFormat() const { return depthFormat; }
+  vk::SampleCountFlagBits getSampleCount() const { return samples; }
+  bool isMultisampled() const {
+    return samples != vk::SampleCountFlagBits::e1;
+  }
+  size_t getFrameCount() const { return depthImages.size(); }
+  vk::ImageView getDepthView(size_t frame) const {
+    return depthImages[frame].view;
+  }
+  /// The multisampled color image; only when isMultisampled().
+  vk::ImageView getColorView(size_t frame) const {
+    return colorImages[frame].view;
+  }
+  /// Memory of every set, as allocated.
+  vk::DeviceSize getMemoryBytes() const;
+  /// Memory of one set; all sets are alike.
+  vk::DeviceSize getSetMemoryBytes() const;
+
+private:
+  struct Image {
+    vk::Image image;
+    XveAllocation allocation;
+    vk::ImageView view;
+  };
+
+  XveDevice &device;
+  vk::Format depthFormat;
+  vk::SampleCountFlagBits samples;
+
+  std::vector<Image> depthImages;
+  std::vector<Image> colorImages;
+
+  Image createImage(vk::Extent2D extent, vk::Format format,
+                    vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect);
+};
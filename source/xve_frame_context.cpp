@@ -0,0 +1,104 @@
+#include "xve_frame_context.hpp"
+
+#include <algorithm>
+#include <array>
+
+XveFrameContext::XveFrameContext(XveDevice &deviceRef,
+                                 vk::DeviceSize dynamicBufferSize_)
+    : device(deviceRef), dynamicBufferSize(dynamicBufferSize_) {
+  auto commandPoolCreateInfo = vk::CommandPoolCreateInfo{
+      vk::CommandPoolCreateFlagBits::eTransient,
+      device.getGraphicsQueueFamily(),
+  };
+
+  try {
+    commandPool = device.getDevice().createCommandPool(commandPoolCreateInfo);
+
+    auto allocInfo = vk::CommandBufferAllocateInfo{
+        commandPool,
+        vk::CommandBufferLevel::ePrimary,
+        1,
+    };
+    commandBuffer =
+        device.getDevice().allocateCommandBuffers(allocInfo).front();
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create frame command pool. Error: {}", e.what()));
+  }
+
+  auto limits = device.getPhysicalDevice().getProperties().limits;
+  dynamicAlignment = std::max(limits.minUniformBufferOffsetAlignment,
+                              limits.minStorageBufferOffsetAlignment);
+
+  device.createBuffer(dynamicBufferSize,
+                      vk::BufferUsageFlagBits::eUniformBuffer |
+                          vk::BufferUsageFlagBits::eStorageBuffer |
+                          vk::BufferUsageFlagBits::eVertexBuffer,
+                      vk::MemoryPropertyFlagBits::eHostVisible |
+                          vk::MemoryPropertyFlagBits::eHostCoherent,
+                      dynamicBuffer, dynamicAllocation,
+                      XveMemoryCategory::FrameData);
+
+  std::array<vk::DescriptorPoolSize, 4> poolSizes = {
+      vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer, 256},
+      vk::DescriptorPoolSize{vk::DescriptorType::eUniformBufferDynamic, 64},
+      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 256},
+      vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler, 256},
+  };
+
+  auto descriptorPoolInfo = vk::DescriptorPoolCreateInfo{
+      vk::DescriptorPoolCreateFlags(),
+      DESCRIPTOR_POOL_MAX_SETS,
+      static_cast<uint32_t>(poolSizes.size()),
+      poolSizes.data(),
+  };
+
+  try {
+    descriptorPool =
+        device.getDevice().createDescriptorPool(descriptorPoolInfo);
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create frame descriptor pool. Error: {}", e.what()));
+  }
+}
+
+XveFrameContext::~XveFrameContext() {
+  device.getDevice().destroyDescriptorPool(descriptorPool);
+  device.destroyBuffer(dynamicBuffer, dynamicAllocation);
+  device.getDevice().destroyCommandPool(commandPool);
+}
+
+void XveFrameContext::begin() {
+  device.getDevice().resetCommandPool(commandPool);
+  device.getDevice().resetDescriptorPool(descriptorPool);
+  dynamicHead = 0;
+}
+
+XveFrameContext::DynamicAllocation
+XveFrameContext::allocateDynamic(vk::DeviceSize size) {
+  auto offset = (dynamicHead + dynamicAlignment - 1) & ~(dynamicAlignment - 1);
+  if (offset + size > dynamicBufferSize) {
+    throw std::runtime_error(
+        std::format("Frame dynamic buffer exhausted: {} of {} bytes requested",
+                    offset + size, dynamicBufferSize));
+  }
+  dynamicHead = offset + size;
+
+  return DynamicAllocation{
+      dynamicBuffer,
+      offset,
+      size,
+      static_cast<char *>(dynamicAllocation.mappedData) + offset,
+  };
+}
+
+vk::DescriptorSet
+XveFrameContext::allocateDescriptorSet(vk::DescriptorSetLayout layout) {
+  auto allocInfo = vk::DescriptorSetAllocateInfo{descriptorPool, 1, &layout};
+  try {
+    return device.getDevice().allocateDescriptorSets(allocInfo).front();
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to allocate frame descriptor set. Error: {}", e.what()));
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "xve_device.hpp"
+#include <cstring>
+#include <vulkan/vulkan.hpp>
+
+/// Everything the CPU needs to build one frame while the GPU may still be
+/// executing the previous ones: a command pool, a host-visible buffer for
+/// per-frame uniform/storage/instance data and a descriptor pool. All three
+/// are reset wholesale in begin(), so steady-state frames allocate nothing.
+class XveFrameContext {
+public:
+  static constexpr vk::DeviceSize DEFAULT_DYNAMIC_BUFFER_SIZE =
+      4ull * 1024 * 1024;
+  static constexpr uint32_t DESCRIPTOR_POOL_MAX_SETS = 256;
+
+  struct DynamicAllocation {
+    vk::Buffer buffer;
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+    void *data;
+  };
+
+  XveFrameContext(
+      XveDevice &deviceRef,
+      vk::DeviceSize dynamicBufferSize = DEFAULT_DYNAMIC_BUFFER_SIZE);
+  ~XveFrameContext();
+
+  XveFrameContext(const XveFrameContext &) = delete;
+  XveFrameContext &operator=(const XveFrameContext &) = delete;
+
+  /// Must only be called once the GPU has finished the frame that last used
+  /// this context.
+  void begin();
+
+  vk::CommandBuffer getCommandBuffer() const { return commandBuffer; }
+  vk::Buffer getDynamicBuffer() const { return dynamicBuffer; }
+
+  /// Bump-allocates from the frame's dynamic buffer. Offsets satisfy both the
+  /// uniform and storage buffer alignment limits.
+  DynamicAllocation allocateDynamic(vk::DeviceSize size);
+
+  template <class T> DynamicAllocation pushDynamic(const T &value) {
+    auto allocation = allocateDynamic(sizeof(T));
+    std::memcpy(allocation.data, &value, sizeof(T));
+    return allocation;
+  }
+
+  vk::DescriptorSet allocateDescriptorSet(vk::DescriptorSetLayout layout);
+
+  vk::DeviceSize getDynamicBytesUsed() const { return dynamicHead; }
+
+private:
+  XveDevice &device;
+
+  vk::CommandPool commandPool;
+  vk::CommandBuffer commandBuffer;
+
+  vk::Buffer dynamicBuffer;
+  XveAllocation dynamicAllocation;
+  vk::DeviceSize dynamicBufferSize;
+  vk::DeviceSize dynamicAlignment;
+  vk::DeviceSize dynamicHead = 0;
+
+  vk::DescriptorPool descriptorPool;
+};
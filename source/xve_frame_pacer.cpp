@@ -0,0 +1,76 @@
+#include "xve_frame_pacer.hpp"
+
+#include <thread>
+
+XveFramePacer::XveFramePacer(const XveFramePacerConfig &config)
+    : targetFps(config.targetFps), lowLatency(config.lowLatency) {
+  if (targetFps > 0.0) {
+    framePeriod = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / targetFps));
+  }
+}
+
+void XveFramePacer::waitUntil(Clock::time_point deadline) {
+  auto now = Clock::now();
+  if (deadline - now > SPIN_MARGIN) {
+    std::this_thread::sleep_until(deadline - SPIN_MARGIN);
+  }
+  while (Clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
+
+void XveFramePacer::beginFrame() {
+  if (framePeriod != Clock::duration::zero() && started) {
+    waitUntil(nextDeadline);
+  }
+
+  auto now = Clock::now();
+  if (started) {
+    std::chrono::duration<double, std::milli> frameTime = now - lastFrameStart;
+    frameTimes.record(frameTime.count());
+  }
+  lastFrameStart = now;
+
+  // Deadlines advance by whole periods so small oversleeps don't drift the
+  // rate; after a long hitch (e.g. a resize) the schedule restarts from now.
+  if (!started || now - nextDeadline > framePeriod) {
+    nextDeadline = now;
+  }
+  nextDeadline += framePeriod;
+  started = true;
+}
+
+void XveFramePacer::markInputSampled() {
+  inputSampled = Clock::now();
+  inputPending = true;
+}
+
+void XveFramePacer::markPresented() {
+  if (!inputPending) {
+    return;
+  }
+  std::chrono::duration<double, std::milli> latency =
+      Clock::now() - inputSampled;
+  latencies.record(latency.count());
+  inputPending = false;
+}
+
+void XveFramePacer::logStats() {
+  if (frameTimes.count() == 0) {
+    return;
+  }
+
+  log(LogLevel::Info,
+      "Frame time ms: min {:.2f} avg {:.2f} p50 {:.2f} p99 {:.2f} max {:.2f}"
+      " ({} frames, cap {} fps)",
+      frameTimes.min(), frameTimes.mean(), frameTimes.percentile(0.5),
+      frameTimes.percentile(0.99), frameTimes.max(), frameTimes.count(),
+      targetFps);
+  log(LogLevel::Info,
+      "Input-to-present ms ({}): min {:.2f} avg {:.2f} p50 {:.2f} p99 {:.2f}"
+      " max {:.2f}",
+      lowLatency ? "low-latency" : "standard", latencies.min(),
+      latencies.mean(), latencies.percentile(0.5), latencies.percentile(0.99),
+      latencies.max());
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_histogram.hpp"
+#include <chrono>
+
+struct XveFramePacerConfig {
+  /// Frame-rate cap; 0 leaves pacing to the present mode.
+  double targetFps = 0.0;
+  /// Sample input after the frame-slot wait, right before recording,
+  /// instead of at the top of the loop.
+  bool lowLatency = false;
+};
+
+/// Caps the frame rate and measures frame times and input-to-present latency.
+/// Latency is CPU-side: from the input sample to vkQueuePresentKHR returning.
+class XveFramePacer : Logger {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit XveFramePacer(const XveFramePacerConfig &config = {});
+
+  /// Sleeps until the next frame is due, then records the frame time.
+  void beginFrame();
+  void markInputSampled();
+  void markPresented();
+
+  bool isLowLatency() const { return lowLatency; }
+  double getTargetFps() const { return targetFps; }
+
+  const XveHistogram &getFrameTimes() const { return frameTimes; }
+  const XveHistogram &getLatencies() const { return latencies; }
+
+  void logStats();
+
+private:
+  // The OS sleep is only trusted up to this margin; the rest is spun.
+  static constexpr auto SPIN_MARGIN = std::chrono::microseconds(1000);
+
+  double targetFps;
+  bool lowLatency;
+  Clock::duration framePeriod{};
+
+  Clock::time_point nextDeadline;
+  Clock::time_point lastFrameStart;
+  Clock::time_point inputSampled;
+  bool started = false;
+  bool inputPending = false;
+
+  // 0.1 ms buckets up to 100 ms.
+  XveHistogram frameTimes{0.1, 1000};
+  XveHistogram latencies{0.1, 1000};
+
+  void waitUntil(Clock::time_point deadline);
+};
@@ -0,0 +1,243 @@
+#include "xve_geometry_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+XveGeometryPool::XveGeometryPool(XveDevice &deviceRef, uint32_t vertexStride,
+                                 uint32_t vertexCapacity,
+                                 uint32_t indexCapacity)
+    : device(deviceRef), vertexStride(vertexStride),
+      vertexRanges(vertexCapacity), indexRanges(indexCapacity) {
+  createBuffers(vertexCapacity, indexCapacity, vertexBuffer, vertexAllocation,
+                indexBuffer, indexAllocation);
+}
+
+XveGeometryPool::~XveGeometryPool() {
+  device.destroyBuffer(vertexBuffer, vertexAllocation);
+  device.destroyBuffer(indexBuffer, indexAllocation);
+}
+
+void XveGeometryPool::createBuffers(uint32_t vertexCapacity,
+                                    uint32_t indexCapacity,
+                                    vk::Buffer &vertices,
+                                    XveAllocation &verticesAllocation,
+                                    vk::Buffer &indices,
+                                    XveAllocation &indicesAllocation) {
+  // Uploads may land from the transfer queue while the graphics queue draws
+  // other ranges, so the buffers are shared rather than handed over.
+  std::vector<uint32_t> queueFamilies;
+  if (device.hasTransferQueue()) {
+    queueFamilies = {device.getGraphicsQueueFamily(),
+                     device.getTransferQueueFamily()};
+  }
+
+  auto transfer = vk::BufferUsageFlagBits::eTransferSrc |
+                  vk::BufferUsageFlagBits::eTransferDst;
+  device.createBuffer(
+      static_cast<vk::DeviceSize>(vertexStride) * vertexCapacity,
+      vk::BufferUsageFlagBits::eVertexBuffer | transfer,
+      vk::MemoryPropertyFlagBits::eDeviceLocal, vertices, verticesAllocation,
+      XveMemoryCategory::Geometry, queueFamilies);
+  device.createBuffer(sizeof(uint32_t) * static_cast<uint64_t>(indexCapacity),
+                      vk::BufferUsageFlagBits::eIndexBuffer | transfer,
+                      vk::MemoryPropertyFlagBits::eDeviceLocal, indices,
+                      indicesAllocation, XveMemoryCategory::Geometry,
+                      queueFamilies);
+}
+
+XveGeometryPool::Handle
+XveGeometryPool::allocate(XveUploadManager &uploadManager,
+                          const void *vertexData, uint32_t vertexCount,
+                          const std::vector<uint32_t> &indices) {
+  auto indexCount = static_cast<uint32_t>(indices.size());
+
+  auto firstVertex = vertexRanges.allocate(vertexCount);
+  auto firstIndex =
+      indexCount > 0 ? indexRanges.allocate(indexCount) : uint64_t{0};
+  if (!firstVertex || !firstIndex) {
+    if (firstVertex) {
+      vertexRanges.free(*firstVertex, vertexCount);
+    }
+    if (firstIndex && indexCount > 0) {
+      indexRanges.free(*firstIndex, indexCount);
+    }
+
+    // Doubling keeps the number of stalls logarithmic in the final size.
+    auto vertexCapacity = static_cast<uint32_t>(std::max<uint64_t>(
+        vertexRanges.getCapacity() * 2,
+        vertexRanges.getUsedBytes() + vertexCount));
+    auto indexCapacity = static_cast<uint32_t>(std::max<uint64_t>(
+        indexRanges.getCapacity() * 2,
+        indexRanges.getUsedBytes() + indexCount));
+    log(LogLevel::Warning,
+        "Geometry pool full, growing to {} vertices and {} indices",
+        vertexCapacity, indexCapacity);
+    compact(uploadManager, vertexCapacity, indexCapacity);
+
+    firstVertex = vertexRanges.allocate(vertexCount);
+    firstIndex =
+        indexCount > 0 ? indexRanges.allocate(indexCount) : uint64_t{0};
+    if (!firstVertex || !firstIndex) {
+      throw std::runtime_error(std::format(
+          "Geometry pool can't fit a mesh of {} vertices and {} indices",
+          vertexCount, indexCount));
+    }
+  }
+
+  Handle handle;
+  if (!freeHandles.empty()) {
+    handle = freeHandles.back();
+    freeHandles.pop_back();
+  } else {
+    handle = static_cast<Handle>(meshes.size());
+    meshes.emplace_back();
+  }
+
+  auto &mesh = meshes[handle];
+  mesh.range = Range{static_cast<uint32_t>(*firstVertex), vertexCount,
+                     static_cast<uint32_t>(*firstIndex), indexCount};
+  mesh.live = true;
+  meshCount++;
+
+  uploadManager.enqueue(
+      vertexBuffer, static_cast<vk::DeviceSize>(vertexStride) * *firstVertex,
+      vertexData, static_cast<vk::DeviceSize>(vertexStride) * vertexCount);
+  if (indexCount > 0) {
+    uploadManager.enqueue(indexBuffer, sizeof(uint32_t) * *firstIndex,
+                          indices.data(), sizeof(uint32_t) * indexCount);
+  }
+  return handle;
+}
+
+void XveGeometryPool::free(Handle handle) {
+  auto &mesh = meshes[handle];
+  vertexRanges.free(mesh.range.firstVertex, mesh.range.vertexCount);
+  if (mesh.range.indexCount > 0) {
+    indexRanges.free(mesh.range.firstIndex, mesh.range.indexCount);
+  }
+  mesh.live = false;
+  meshCount--;
+  freeHandles.push_back(handle);
+}
+
+void XveGeometryPool::bind(vk::CommandBuffer commandBuffer) {
+  vk::DeviceSize offset = 0;
+  commandBuffer.bindVertexBuffers(0, 1, &vertexBuffer, &offset);
+  commandBuffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+}
+
+vk::DeviceSize XveGeometryPool::compact(XveUploadManager &uploadManager,
+                                        uint32_t newVertexCapacity,
+                                        uint32_t newIndexCapacity) {
+  auto start = std::chrono::steady_clock::now();
+
+  // Pending uploads target the old buffers and frames in flight read them.
+  uploadManager.waitIdle();
+  device.getDevice().waitIdle();
+
+  newVertexCapacity = std::max(
+      newVertexCapacity, static_cast<uint32_t>(vertexRanges.getCapacity()));
+  newIndexCapacity = std::max(
+      newIndexCapacity, static_cast<uint32_t>(indexRanges.getCapacity()));
+
+  vk::Buffer newVertexBuffer;
+  XveAllocation newVertexAllocation;
+  vk::Buffer newIndexBuffer;
+  XveAllocation newIndexAllocation;
+  createBuffers(newVertexCapacity, newIndexCapacity, newVertexBuffer,
+                newVertexAllocation, newIndexBuffer, newIndexAllocation);
+
+  // Meshes are repacked in address order, which keeps related meshes
+  // (usually allocated together) adjacent.
+  std::vector<Handle> order;
+  for (Handle handle = 0; handle < meshes.size(); handle++) {
+    if (meshes[handle].live) {
+      order.push_back(handle);
+    }
+  }
+  std::sort(order.begin(), order.end(), [this](Handle a, Handle b) {
+    return meshes[a].range.firstVertex < meshes[b].range.firstVertex;
+  });
+
+  vertexRanges = XveRangeAllocator{newVertexCapacity};
+  indexRanges = XveRangeAllocator{newIndexCapacity};
+  std::vector<vk::BufferCopy> vertexCopies;
+  std::vector<vk::BufferCopy> indexCopies;
+  vk::DeviceSize bytesCopied = 0;
+  for (auto handle : order) {
+    auto &range = meshes[handle].range;
+    auto firstVertex = static_cast<uint32_t>(
+        *vertexRanges.allocate(range.vertexCount));
+    vertexCopies.push_back({
+        static_cast<vk::DeviceSize>(vertexStride) * range.firstVertex,
+        static_cast<vk::DeviceSize>(vertexStride) * firstVertex,
+        static_cast<vk::DeviceSize>(vertexStride) * range.vertexCount,
+    });
+    bytesCopied += vertexCopies.back().size;
+    range.firstVertex = firstVertex;
+
+    if (range.indexCount > 0) {
+      auto firstIndex =
+          static_cast<uint32_t>(*indexRanges.allocate(range.indexCount));
+      indexCopies.push_back({
+          sizeof(uint32_t) * static_cast<vk::DeviceSize>(range.firstIndex),
+          sizeof(uint32_t) * static_cast<vk::DeviceSize>(firstIndex),
+          sizeof(uint32_t) * static_cast<vk::DeviceSize>(range.indexCount),
+      });
+      bytesCopied += indexCopies.back().size;
+      range.firstIndex = firstIndex;
+    }
+  }
+
+  try {
+    auto commandBuffer =
+        device.getDevice()
+            .allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+                device.getCommandPool(), vk::CommandBufferLevel::ePrimary, 1})
+            .front();
+    commandBuffer.begin(vk::CommandBufferBeginInfo{
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    if (!vertexCopies.empty()) {
+      commandBuffer.copyBuffer(vertexBuffer, newVertexBuffer, vertexCopies);
+    }
+    if (!indexCopies.empty()) {
+      commandBuffer.copyBuffer(indexBuffer, newIndexBuffer, indexCopies);
+    }
+    commandBuffer.end();
+
+    auto submitInfo = vk::SubmitInfo{0, nullptr, nullptr, 1, &commandBuffer};
+    device.getGraphicsQueue().submit(submitInfo);
+    device.getGraphicsQueue().waitIdle();
+    device.getDevice().freeCommandBuffers(device.getCommandPool(),
+                                          commandBuffer);
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to compact geometry pool. Error: {}", e.what()));
+  }
+
+  device.destroyBuffer(vertexBuffer, vertexAllocation);
+  device.destroyBuffer(indexBuffer, indexAllocation);
+  vertexBuffer = newVertexBuffer;
+  vertexAllocation = newVertexAllocation;
+  indexBuffer = newIndexBuffer;
+  indexAllocation = newIndexAllocation;
+  generation++;
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  log(LogLevel::Info, "Compacted {} meshes ({} bytes) in {:.3f} ms",
+      order.size(), bytesCopied, elapsed.count());
+  return bytesCopied;
+}
+
+XveGeometryPoolStats XveGeometryPool::getStats() const {
+  auto region = [](const XveRangeAllocator &ranges) {
+    return XveGeometryPoolStats::Region{
+        ranges.getCapacity(),
+        ranges.getUsedBytes(),
+        ranges.getFreeRangeCount(),
+        ranges.getLargestFreeRange(),
+    };
+  };
+  return {region(vertexRanges), region(indexRanges), meshCount};
+}
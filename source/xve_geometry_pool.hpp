@@ -0,0 +1,106 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include "xve_range_allocator.hpp"
+#include "xve_upload_manager.hpp"
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct XveGeometryPoolStats {
+  struct Region {
+    uint64_t capacity = 0;
+    uint64_t used = 0;
+    uint32_t freeRangeCount = 0;
+    uint64_t largestFreeRange = 0;
+
+    /// Same measure as XveAllocatorStats::fragmentation().
+    float fragmentation() const {
+      auto freeCount = capacity - used;
+      return freeCount == 0 ? 0.0f
+                            : 1.0f - static_cast<float>(largestFreeRange) /
+                                         static_cast<float>(freeCount);
+    }
+  };
+
+  /// In vertices and indices, not bytes.
+  Region vertices;
+  Region indices;
+  uint32_t meshCount = 0;
+};
+
+/// One vertex buffer and one 32-bit index buffer shared by every model, so
+/// a frame binds geometry once and indirect draws can span all models.
+/// Meshes are ranges handed out by XveRangeAllocator and addressed through
+/// stable handles, which compact() keeps valid while it moves the data.
+class XveGeometryPool : Logger {
+public:
+  using Handle = uint32_t;
+
+  struct Range {
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+  };
+
+  static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1u << 20;
+  static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 4u << 20;
+
+  XveGeometryPool(XveDevice &deviceRef, uint32_t vertexStride,
+                  uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+                  uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY);
+  ~XveGeometryPool();
+
+  XveGeometryPool(const XveGeometryPool &) = delete;
+  XveGeometryPool &operator=(const XveGeometryPool &) = delete;
+
+  /// Reserves ranges for the mesh and queues its upload. When the pool is
+  /// full it waits for the GPU and grows (see compact()).
+  Handle allocate(XveUploadManager &uploadManager, const void *vertexData,
+                  uint32_t vertexCount, const std::vector<uint32_t> &indices);
+  /// The GPU must be done with the mesh.
+  void free(Handle handle);
+
+  const Range &getRange(Handle handle) const { return meshes[handle].range; }
+
+  /// Binds the vertex buffer to binding 0 and the index buffer.
+  void bind(vk::CommandBuffer commandBuffer);
+
+  /// Moves every mesh to the front of freshly allocated buffers, closing
+  /// all holes, optionally growing them. Waits for `uploadManager` and the
+  /// device first, so call it between frames, not every frame. Returns the
+  /// bytes copied.
+  vk::DeviceSize compact(XveUploadManager &uploadManager,
+                         uint32_t newVertexCapacity = 0,
+                         uint32_t newIndexCapacity = 0);
+
+  XveGeometryPoolStats getStats() const;
+  /// Changes whenever compact() moves meshes, for caches of getRange().
+  uint64_t getGeneration() const { return generation; }
+
+private:
+  struct Mesh {
+    Range range;
+    bool live = false;
+  };
+
+  XveDevice &device;
+  uint32_t vertexStride;
+
+  vk::Buffer vertexBuffer;
+  XveAllocation vertexAllocation;
+  vk::Buffer indexBuffer;
+  XveAllocation indexAllocation;
+  XveRangeAllocator vertexRanges;
+  XveRangeAllocator indexRanges;
+
+  std::vector<Mesh> meshes;
+  std::vector<Handle> freeHandles;
+  uint32_t meshCount = 0;
+  uint64_t generation = 0;
+
+  void createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity,
+                     vk::Buffer &vertices, XveAllocation &verticesAllocation,
+                     vk::Buffer &indices, XveAllocation &indicesAllocation);
+};
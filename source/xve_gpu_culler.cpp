@@ -0,0 +1,250 @@
+#include "xve_gpu_culler.hpp"
+#include "config.h"
+
+#include <array>
+#include <unordered_map>
+
+XveGpuCuller::XveGpuCuller(XveDevice &deviceRef,
+                           XveUploadManager &uploadManager,
+                           uint32_t framesInFlight,
+                           const std::vector<Object> &objects)
+    : device(deviceRef) {
+  if (!isSupported(device)) {
+    throw std::runtime_error(
+        "GPU culling needs drawIndirectCount and multiDrawIndirect");
+  }
+
+  uploadObjects(uploadManager, objects);
+  createPipeline();
+  createFrameResources(framesInFlight);
+
+  log(LogLevel::Info, "GPU culling {} objects of {} models", objectCount,
+      batchModels.size());
+}
+
+XveGpuCuller::~XveGpuCuller() {
+  pipeline.reset();
+  device.getDevice().destroyPipelineLayout(pipelineLayout);
+  device.getDevice().destroyDescriptorPool(descriptorPool);
+  device.getDevice().destroyDescriptorSetLayout(descriptorSetLayout);
+
+  for (auto &frame : frames) {
+    device.destroyBuffer(frame.drawBuffer, frame.drawAllocation);
+    device.destroyBuffer(frame.countBuffer, frame.countAllocation);
+  }
+  device.destroyBuffer(instanceBuffer, instanceAllocation);
+  device.destroyBuffer(boundsBuffer, boundsAllocation);
+  device.destroyBuffer(batchBuffer, batchAllocation);
+}
+
+void XveGpuCuller::uploadObjects(XveUploadManager &uploadManager,
+                                 const std::vector<Object> &objects) {
+  objectCount = static_cast<uint32_t>(objects.size());
+  if (objectCount == 0) {
+    throw std::logic_error("Can't create GPU culler without objects");
+  }
+
+  pool = &objects.front().model->getPool();
+  poolGeneration = pool->getGeneration();
+
+  std::unordered_map<XveModel *, uint32_t> batchIndices;
+  std::vector<XveModel::Instance> instances;
+  std::vector<Bounds> bounds;
+  instances.reserve(objectCount);
+  bounds.reserve(objectCount);
+  for (auto &object : objects) {
+    if (!object.model->isIndexed()) {
+      throw std::logic_error("GPU culling needs indexed models");
+    }
+    if (&object.model->getPool() != pool) {
+      throw std::logic_error("GPU culled models must share a geometry pool");
+    }
+
+    auto [it, inserted] = batchIndices.try_emplace(
+        object.model, static_cast<uint32_t>(batchModels.size()));
+    if (inserted) {
+      batchModels.push_back(object.model);
+    }
+    instances.push_back({object.transform, object.color});
+    bounds.push_back({object.model->getBoundingSphere(), it->second});
+  }
+  auto batchInfos = buildBatchInfos();
+
+  uploadManager.createDeviceLocalBuffer(
+      instances.data(), sizeof(instances[0]) * instances.size(),
+      vk::BufferUsageFlagBits::eVertexBuffer |
+          vk::BufferUsageFlagBits::eStorageBuffer,
+      instanceBuffer, instanceAllocation);
+  uploadManager.createDeviceLocalBuffer(
+      bounds.data(), sizeof(bounds[0]) * bounds.size(),
+      vk::BufferUsageFlagBits::eStorageBuffer, boundsBuffer,
+      boundsAllocation, XveMemoryCategory::Culling);
+  uploadManager.createDeviceLocalBuffer(
+      batchInfos.data(), sizeof(batchInfos[0]) * batchInfos.size(),
+      vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eTransferDst,
+      batchBuffer, batchAllocation, XveMemoryCategory::Culling);
+}
+
+std::vector<XveGpuCuller::BatchInfo> XveGpuCuller::buildBatchInfos() const {
+  std::vector<BatchInfo> batchInfos;
+  batchInfos.reserve(batchModels.size());
+  for (auto *model : batchModels) {
+    auto &range = model->getRange();
+    batchInfos.push_back({range.indexCount, range.firstIndex,
+                          static_cast<int32_t>(range.firstVertex)});
+  }
+  return batchInfos;
+}
+
+void XveGpuCuller::createPipeline() {
+  std::array<vk::DescriptorSetLayoutBinding, 5> bindings;
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i] = vk::DescriptorSetLayoutBinding{
+        i, vk::DescriptorType::eStorageBuffer, 1,
+        vk::ShaderStageFlagBits::eCompute};
+  }
+
+  auto pushConstantRange = XvePipeline::pushConstantRange<PushConstants>(
+      vk::ShaderStageFlagBits::eCompute);
+
+  try {
+    descriptorSetLayout = device.getDevice().createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo{
+            vk::DescriptorSetLayoutCreateFlags(),
+            static_cast<uint32_t>(bindings.size()),
+            bindings.data(),
+        });
+    pipelineLayout = device.getDevice().createPipelineLayout(
+        vk::PipelineLayoutCreateInfo{
+            vk::PipelineLayoutCreateFlags(),
+            1,
+            &descriptorSetLayout,
+            1,
+            &pushConstantRange,
+        });
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create culling pipeline layout. Error: {}", e.what()));
+  }
+
+  pipeline = std::make_unique<XveComputePipeline>(device, CULL_SHADER_COMP,
+                                                  pipelineLayout);
+}
+
+void XveGpuCuller::createFrameResources(uint32_t framesInFlight) {
+  auto poolSize = vk::DescriptorPoolSize{
+      vk::DescriptorType::eStorageBuffer, 5 * framesInFlight};
+  descriptorPool = device.getDevice().createDescriptorPool(
+      vk::DescriptorPoolCreateInfo{
+          vk::DescriptorPoolCreateFlags(), framesInFlight, 1, &poolSize});
+
+  frames.resize(framesInFlight);
+  for (auto &frame : frames) {
+    // Written by the cull pass and read by the same frame's draws only, so
+    // every frame in flight has its own copies.
+    device.createBuffer(
+        sizeof(vk::DrawIndexedIndirectCommand) * objectCount,
+        vk::BufferUsageFlagBits::eStorageBuffer |
+            vk::BufferUsageFlagBits::eIndirectBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, frame.drawBuffer,
+        frame.drawAllocation, XveMemoryCategory::Culling);
+    device.createBuffer(sizeof(uint32_t),
+                        vk::BufferUsageFlagBits::eStorageBuffer |
+                            vk::BufferUsageFlagBits::eIndirectBuffer |
+                            vk::BufferUsageFlagBits::eTransferDst,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal,
+                        frame.countBuffer, frame.countAllocation,
+                        XveMemoryCategory::Culling);
+
+    frame.descriptorSet =
+        device.getDevice()
+            .allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+                descriptorPool, 1, &descriptorSetLayout})
+            .front();
+
+    std::array<vk::DescriptorBufferInfo, 5> bufferInfos = {
+        vk::DescriptorBufferInfo{instanceBuffer, 0, vk::WholeSize},
+        vk::DescriptorBufferInfo{boundsBuffer, 0, vk::WholeSize},
+        vk::DescriptorBufferInfo{batchBuffer, 0, vk::WholeSize},
+        vk::DescriptorBufferInfo{frame.drawBuffer, 0, vk::WholeSize},
+        vk::DescriptorBufferInfo{frame.countBuffer, 0, vk::WholeSize},
+    };
+    std::array<vk::WriteDescriptorSet, 5> writes;
+    for (uint32_t i = 0; i < writes.size(); i++) {
+      writes[i] = vk::WriteDescriptorSet{
+          frame.descriptorSet, i, 0, 1, vk::DescriptorType::eStorageBuffer,
+          nullptr, &bufferInfos[i]};
+    }
+    device.getDevice().updateDescriptorSets(writes, {});
+  }
+}
+
+void XveGpuCuller::cull(vk::CommandBuffer commandBuffer, uint32_t frameIndex,
+                        const glm::mat4 &viewProjection) {
+  auto &frame = frames[frameIndex];
+
+  // Gribb-Hartmann plane extraction for a [0, 1] depth range. glm is column
+  // major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+  auto row = [&viewProjection](int i) {
+    return glm::vec4{viewProjection[0][i], viewProjection[1][i],
+                     viewProjection[2][i], viewProjection[3][i]};
+  };
+  PushConstants pushConstants{
+      {row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1),
+       row(2), row(3) - row(2)},
+      objectCount,
+  };
+  for (auto &plane : pushConstants.planes) {
+    plane /= glm::length(glm::vec3{plane});
+  }
+
+  // Compaction moved meshes: earlier frames' cull passes may still be
+  // reading the batch table, so they're waited on before it's rewritten.
+  if (pool->getGeneration() != poolGeneration) {
+    poolGeneration = pool->getGeneration();
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlags(), {}, {}, {});
+    auto batchInfos = buildBatchInfos();
+    commandBuffer.updateBuffer(batchBuffer, 0,
+                               sizeof(batchInfos[0]) * batchInfos.size(),
+                               batchInfos.data());
+  }
+
+  commandBuffer.fillBuffer(frame.countBuffer, 0, vk::WholeSize, 0);
+  auto clearBarrier = vk::MemoryBarrier{
+      vk::AccessFlagBits::eTransferWrite,
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                vk::PipelineStageFlagBits::eComputeShader,
+                                vk::DependencyFlags(), clearBarrier, {}, {});
+
+  pipeline->bind(commandBuffer);
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   pipelineLayout, 0, frame.descriptorSet,
+                                   {});
+  XvePipeline::pushConstants(commandBuffer, pipelineLayout,
+                             vk::ShaderStageFlagBits::eCompute, pushConstants);
+  commandBuffer.dispatch((objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                         1, 1);
+
+  auto cullBarrier = vk::MemoryBarrier{
+      vk::AccessFlagBits::eShaderWrite,
+      vk::AccessFlagBits::eIndirectCommandRead};
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                vk::PipelineStageFlagBits::eDrawIndirect,
+                                vk::DependencyFlags(), cullBarrier, {}, {});
+}
+
+void XveGpuCuller::draw(vk::CommandBuffer commandBuffer, uint32_t frameIndex,
+                        XvePipeline &drawPipeline) {
+  auto &frame = frames[frameIndex];
+
+  drawPipeline.bind(commandBuffer);
+  pool->bind(commandBuffer);
+  XveModel::bindInstances(commandBuffer, instanceBuffer, 0);
+  commandBuffer.drawIndexedIndirectCount(
+      frame.drawBuffer, 0, frame.countBuffer, 0, objectCount,
+      sizeof(vk::DrawIndexedIndirectCommand));
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_compute_pipeline.hpp"
+#include "xve_device.hpp"
+#include "xve_model.hpp"
+#include "xve_pipeline.hpp"
+#include "xve_upload_manager.hpp"
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// GPU-driven rendering of a static object set. A compute pass tests every
+/// object's bounding sphere against the frustum and appends one
+/// VkDrawIndexedIndirectCommand per visible object; since all models share a
+/// geometry pool, rendering is then a single drawIndexedIndirectCount. The
+/// CPU records the same handful of commands every frame however many objects
+/// there are.
+class XveGpuCuller : Logger {
+public:
+  static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+  struct Object {
+    XveModel *model;
+    glm::mat4 transform{1.0f};
+    glm::vec4 color{1.0f};
+  };
+
+  static bool isSupported(const XveDevice &device) {
+    return device.getFeatures().drawIndirectCount;
+  }
+
+  /// Objects are uploaded once through `uploadManager`, which must be
+  /// waited on before the first cull(). Models must be indexed and share
+  /// one geometry pool.
+  XveGpuCuller(XveDevice &deviceRef, XveUploadManager &uploadManager,
+               uint32_t framesInFlight, const std::vector<Object> &objects);
+  ~XveGpuCuller();
+
+  XveGpuCuller(const XveGpuCuller &) = delete;
+  XveGpuCuller &operator=(const XveGpuCuller &) = delete;
+
+  /// Records the cull dispatch and its barriers. Must be outside a render
+  /// pass and before draw() in the same frame. `viewProjection` is whatever
+  /// the vertex stage applies after the instance transform.
+  void cull(vk::CommandBuffer commandBuffer, uint32_t frameIndex,
+            const glm::mat4 &viewProjection);
+
+  /// Draws the frame's surviving objects with `pipeline`, which must use
+  /// XveModel's vertex layout.
+  void draw(vk::CommandBuffer commandBuffer, uint32_t frameIndex,
+            XvePipeline &pipeline);
+
+  uint32_t getObjectCount() const { return objectCount; }
+
+private:
+  // Layouts match shaders/cull.comp (std430).
+  struct Bounds {
+    glm::vec4 sphere;
+    uint32_t batch;
+    uint32_t padding[3];
+  };
+
+  // Three scalars, so a 12-byte array stride in std430.
+  struct BatchInfo {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+  };
+  static_assert(sizeof(BatchInfo) == 12);
+
+  struct PushConstants {
+    glm::vec4 planes[6];
+    uint32_t objectCount;
+  };
+
+  struct FrameResources {
+    vk::Buffer drawBuffer;
+    XveAllocation drawAllocation;
+    vk::Buffer countBuffer;
+    XveAllocation countAllocation;
+    vk::DescriptorSet descriptorSet;
+  };
+
+  XveDevice &device;
+  uint32_t objectCount = 0;
+  // One per model; refreshed when the pool compacts.
+  std::vector<XveModel *> batchModels;
+  XveGeometryPool *pool = nullptr;
+  uint64_t poolGeneration = 0;
+
+  vk::Buffer instanceBuffer;
+  XveAllocation instanceAllocation;
+  vk::Buffer boundsBuffer;
+  XveAllocation boundsAllocation;
+  vk::Buffer batchBuffer;
+  XveAllocation batchAllocation;
+  std::vector<FrameResources> frames;
+
+  vk::DescriptorSetLayout descriptorSetLayout;
+  vk::DescriptorPool descriptorPool;
+  vk::PipelineLayout pipelineLayout;
+  std::unique_ptr<XveComputePipeline> pipeline;
+
+  void uploadObjects(XveUploadManager &uploadManager,
+                     const std::vector<Object> &objects);
+  void createFrameResources(uint32_t framesInFlight);
+  void createPipeline();
+  std::vector<BatchInfo> buildBatchInfos() const;
+};
@@ -0,0 +1,51 @@
+#include "xve_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+XveHistogram::XveHistogram(double bucketWidth_, uint32_t bucketCount)
+    : bucketWidth(bucketWidth_), buckets(bucketCount + 1, 0) {}
+
+void XveHistogram::record(double value) {
+  auto bucket = static_cast<size_t>(std::max(value, 0.0) / bucketWidth);
+  buckets[std::min(bucket, buckets.size() - 1)]++;
+
+  if (sampleCount == 0) {
+    minValue = value;
+    maxValue = value;
+  } else {
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+  }
+  sum += value;
+  sampleCount++;
+}
+
+void XveHistogram::reset() {
+  std::fill(buckets.begin(), buckets.end(), 0);
+  sampleCount = 0;
+  sum = 0.0;
+  minValue = 0.0;
+  maxValue = 0.0;
+}
+
+double XveHistogram::percentile(double p) const {
+  if (sampleCount == 0) {
+    return 0.0;
+  }
+
+  auto target = static_cast<uint64_t>(
+      std::ceil(std::clamp(p, 0.0, 1.0) * static_cast<double>(sampleCount)));
+  target = std::max<uint64_t>(target, 1);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= target) {
+      // Bucket edges overshoot the real extremes; the overflow bucket has no
+      // upper edge at all.
+      return std::clamp((i + 1) * bucketWidth, minValue, maxValue);
+    }
+  }
+  return maxValue;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// Fixed-width bucket histogram for timings. Recording is O(1) and never
+/// allocates; values past the last bucket land in an overflow bucket and are
+/// still reflected in min/max/mean.
+class XveHistogram {
+public:
+  XveHistogram(double bucketWidth, uint32_t bucketCount);
+
+  void record(double value);
+  void reset();
+
+  uint64_t count() const { return sampleCount; }
+  double min() const { return sampleCount ? minValue : 0.0; }
+  double max() const { return sampleCount ? maxValue : 0.0; }
+  double mean() const { return sampleCount ? sum / sampleCount : 0.0; }
+
+  /// Upper edge of the bucket holding the p-th percentile, p in [0, 1].
+  double percentile(double p) const;
+
+  double getBucketWidth() const { return bucketWidth; }
+  const std::vector<uint64_t> &getBuckets() const { return buckets; }
+
+private:
+  double bucketWidth;
+  // The last entry is the overflow bucket.
+  std::vector<uint64_t> buckets;
+
+  uint64_t sampleCount = 0;
+  double sum = 0.0;
+  double minValue = 0.0;
+  double maxValue = 0.0;
+};
@@ -0,0 +1,228 @@
+#include "xve_memory_allocator.hpp"
+#include "xve_range_allocator.hpp"
+
+#include <algorithm>
+
+struct XveMemoryBlock {
+  vk::DeviceMemory memory;
+  vk::DeviceSize size;
+  uint32_t memoryTypeIndex;
+  uint32_t poolIndex;
+  bool dedicated;
+  void *mappedData = nullptr;
+  XveRangeAllocator ranges;
+
+  XveMemoryBlock(vk::DeviceSize size_, uint32_t memoryTypeIndex_,
+                 uint32_t poolIndex_, bool dedicated_)
+      : size(size_), memoryTypeIndex(memoryTypeIndex_), poolIndex(poolIndex_),
+        dedicated(dedicated_), ranges(size_) {}
+};
+
+XveMemoryAllocator::XveMemoryAllocator(vk::PhysicalDevice physicalDevice,
+                                       vk::Device device_,
+                                       vk::DeviceSize preferredBlockSize_)
+    : device(device_), preferredBlockSize(preferredBlockSize_) {
+  memoryProperties = physicalDevice.getMemoryProperties();
+  maxAllocationCount =
+      physicalDevice.getProperties().limits.maxMemoryAllocationCount;
+  pools.resize(memoryProperties.memoryTypeCount * 2);
+}
+
+XveMemoryAllocator::~XveMemoryAllocator() {
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      if (!block->ranges.empty()) {
+        log(LogLevel::Warning,
+            "Destroying memory block of type {} with {} live allocations",
+            block->memoryTypeIndex, block->ranges.getAllocationCount());
+      }
+      destroyBlock(*block);
+    }
+  }
+}
+
+vk::DeviceSize
+XveMemoryAllocator::blockSizeFor(uint32_t memoryTypeIndex) const {
+  auto heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  auto heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+
+  // Small heaps (e.g. the 256 MiB BAR window) get proportionally smaller
+  // blocks so a couple of half-empty blocks can't exhaust them.
+  if (heapSize <= 1024ull * 1024 * 1024) {
+    return std::min(preferredBlockSize, heapSize / 8);
+  }
+  return preferredBlockSize;
+}
+
+std::unique_ptr<XveMemoryBlock>
+XveMemoryAllocator::createBlock(vk::DeviceSize size, uint32_t memoryTypeIndex,
+                                uint32_t poolIndex, bool dedicated) {
+  if (deviceAllocationCount >= maxAllocationCount) {
+    log(LogLevel::Warning,
+        "Device memory allocation count {} reached maxMemoryAllocationCount",
+        deviceAllocationCount);
+  }
+
+  auto block = std::make_unique<XveMemoryBlock>(size, memoryTypeIndex,
+                                                poolIndex, dedicated);
+
+  auto allocInfo = vk::MemoryAllocateInfo{size, memoryTypeIndex};
+  try {
+    block->memory = device.allocateMemory(allocInfo);
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to allocate {} bytes of memory type {}. Error: {}", size,
+        memoryTypeIndex, e.what()));
+  }
+
+  auto flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+  if (flags & vk::MemoryPropertyFlagBits::eHostVisible) {
+    try {
+      block->mappedData = device.mapMemory(block->memory, 0, vk::WholeSize);
+    } catch (const vk::SystemError &e) {
+      device.freeMemory(block->memory);
+      throw std::runtime_error(std::format(
+          "Failed to map {} bytes of memory type {}. Error: {}", size,
+          memoryTypeIndex, e.what()));
+    }
+  }
+  deviceAllocationCount++;
+
+  return block;
+}
+
+void XveMemoryAllocator::destroyBlock(XveMemoryBlock &block) {
+  if (block.mappedData != nullptr) {
+    device.unmapMemory(block.memory);
+  }
+  device.freeMemory(block.memory);
+  deviceAllocationCount--;
+}
+
+XveAllocation
+XveMemoryAllocator::allocate(const vk::MemoryRequirements &requirements,
+                             uint32_t memoryTypeIndex, ResourceKind kind,
+                             XveMemoryCategory category) {
+  std::lock_guard lock{mutex};
+
+  auto poolIndex = memoryTypeIndex * 2 + static_cast<uint32_t>(kind);
+  auto &pool = pools[poolIndex];
+  auto blockSize = blockSizeFor(memoryTypeIndex);
+
+  auto makeAllocation = [&](XveMemoryBlock &block, vk::DeviceSize offset) {
+    XveAllocation allocation{};
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.category = category;
+    allocation.block = &block;
+    categoryBytes[static_cast<size_t>(category)] += requirements.size;
+    if (block.mappedData != nullptr) {
+      allocation.mappedData = static_cast<char *>(block.mappedData) + offset;
+    }
+    return allocation;
+  };
+
+  // Large resources get their own block instead of wasting most of a shared
+  // one.
+  bool dedicated = requirements.size > blockSize / 2;
+  if (!dedicated) {
+    for (auto &block : pool.blocks) {
+      if (block->dedicated) {
+        continue;
+      }
+      auto offset =
+          block->ranges.allocate(requirements.size, requirements.alignment);
+      if (offset) {
+        return makeAllocation(*block, *offset);
+      }
+    }
+  }
+
+  auto block = createBlock(dedicated ? requirements.size : blockSize,
+                           memoryTypeIndex, poolIndex, dedicated);
+  auto offset =
+      block->ranges.allocate(requirements.size, requirements.alignment);
+  auto allocation = makeAllocation(*block, offset.value());
+  pool.blocks.push_back(std::move(block));
+  return allocation;
+}
+
+void XveMemoryAllocator::free(XveAllocation &allocation) {
+  if (!allocation) {
+    return;
+  }
+
+  std::lock_guard lock{mutex};
+
+  auto *block = allocation.block;
+  block->ranges.free(allocation.offset, allocation.size);
+  categoryBytes[static_cast<size_t>(allocation.category)] -= allocation.size;
+  allocation = XveAllocation{};
+
+  if (!block->ranges.empty()) {
+    return;
+  }
+
+  // Keep a single empty shared block around per pool so alternating
+  // allocate/free patterns don't hit vkAllocateMemory every time.
+  auto &blocks = pools[block->poolIndex].blocks;
+  if (!block->dedicated) {
+    auto emptyBlocks = std::count_if(blocks.begin(), blocks.end(),
+                                     [](const auto &other) {
+                                       return !other->dedicated &&
+                                              other->ranges.empty();
+                                     });
+    if (emptyBlocks <= 1) {
+      return;
+    }
+  }
+
+  auto it = std::find_if(blocks.begin(), blocks.end(),
+                         [block](const auto &other) {
+                           return other.get() == block;
+                         });
+  destroyBlock(*block);
+  blocks.erase(it);
+}
+
+void XveMemoryAllocator::trim() {
+  std::lock_guard lock{mutex};
+
+  for (auto &pool : pools) {
+    std::erase_if(pool.blocks, [this](const auto &block) {
+      if (!block->ranges.empty()) {
+        return false;
+      }
+      destroyBlock(*block);
+      return true;
+    });
+  }
+}
+
+XveAllocatorStats XveMemoryAllocator::getStats() {
+  std::lock_guard lock{mutex};
+
+  XveAllocatorStats stats{};
+  stats.categoryBytes = categoryBytes;
+  stats.heapBytes.resize(memoryProperties.memoryHeapCount);
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      auto heapIndex =
+          memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex;
+      stats.heapBytes[heapIndex] += block->size;
+      stats.blockCount++;
+      if (block->dedicated) {
+        stats.dedicatedBlockCount++;
+      }
+      stats.allocationCount += block->ranges.getAllocationCount();
+      stats.freeRangeCount += block->ranges.getFreeRangeCount();
+      stats.reservedBytes += block->size;
+      stats.usedBytes += block->ranges.getUsedBytes();
+      stats.largestFreeRange = std::max(stats.largestFreeRange,
+                                        block->ranges.getLargestFreeRange());
+    }
+  }
+  return stats;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "logger.hpp"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct XveMemoryBlock;
+
+/// What an allocation holds, so memory use can be broken down by purpose.
+enum class XveMemoryCategory {
+  Other,
+  /// Vertex, index and instance data.
+  Geometry,
+  /// Depth, multisampled color and other render targets.
+  Attachments,
+  /// Host-visible memory that uploads and readbacks go through.
+  Staging,
+  /// Per-frame uniform data.
+  FrameData,
+  /// Indirect draws and counts written by GPU culling.
+  Culling,
+};
+
+inline constexpr size_t XVE_MEMORY_CATEGORY_COUNT = 6;
+
+inline const char *memoryCategoryName(XveMemoryCategory category) {
+  switch (category) {
+  case XveMemoryCategory::Geometry:
+    return "geometry";
+  case XveMemoryCategory::Attachments:
+    return "attachments";
+  case XveMemoryCategory::Staging:
+    return "staging";
+  case XveMemoryCategory::FrameData:
+    return "frame data";
+  case XveMemoryCategory::Culling:
+    return "culling";
+  default:
+    return "other";
+  }
+}
+
+/// Handle to a sub-allocated range of device memory. Owned by whoever created
+/// the buffer or image bound to it and returned to the allocator on destroy.
+struct XveAllocation {
+  vk::DeviceMemory memory;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size = 0;
+  void *mappedData = nullptr;
+  uint32_t memoryTypeIndex = 0;
+  XveMemoryCategory category = XveMemoryCategory::Other;
+
+  XveMemoryBlock *block = nullptr;
+
+  explicit operator bool() const { return block != nullptr; }
+};
+
+struct XveAllocatorStats {
+  uint32_t blockCount = 0;
+  uint32_t dedicatedBlockCount = 0;
+  uint32_t allocationCount = 0;
+  uint32_t freeRangeCount = 0;
+  vk::DeviceSize reservedBytes = 0;
+  vk::DeviceSize usedBytes = 0;
+  vk::DeviceSize largestFreeRange = 0;
+  /// Bytes handed out per XveMemoryCategory.
+  std::array<vk::DeviceSize, XVE_MEMORY_CATEGORY_COUNT> categoryBytes{};
+  /// Bytes reserved in blocks per memory heap.
+  std::vector<vk::DeviceSize> heapBytes;
+
+  /// 0 when all free space is one contiguous range, approaching 1 as free
+  /// space gets split into many small holes.
+  float fragmentation() const {
+    auto freeBytes = reservedBytes - usedBytes;
+    return freeBytes == 0 ? 0.0f
+                          : 1.0f - static_cast<float>(largestFreeRange) /
+                                       static_cast<float>(freeBytes);
+  }
+};
+
+/// Block-based device memory allocator. Memory is reserved in large blocks
+/// per memory type and handed out as aligned ranges, so the number of
+/// vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+class XveMemoryAllocator : Logger {
+public:
+  /// Linear (buffers) and optimal-tiling (images) resources are kept in
+  /// separate blocks so bufferImageGranularity never has to be considered.
+  enum class ResourceKind {
+    Linear,
+    Optimal,
+  };
+
+  static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+  XveMemoryAllocator(vk::PhysicalDevice physicalDevice, vk::Device device,
+                     vk::DeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE);
+  ~XveMemoryAllocator();
+
+  XveMemoryAllocator(const XveMemoryAllocator &) = delete;
+  XveMemoryAllocator &operator=(const XveMemoryAllocator &) = delete;
+
+  XveAllocation
+  allocate(const vk::MemoryRequirements &requirements, uint32_t memoryTypeIndex,
+           ResourceKind kind,
+           XveMemoryCategory category = XveMemoryCategory::Other);
+  void free(XveAllocation &allocation);
+  /// Releases the empty blocks kept around to absorb allocation churn.
+  void trim();
+
+  XveAllocatorStats getStats();
+
+  const vk::PhysicalDeviceMemoryProperties &getMemoryProperties() const {
+    return memoryProperties;
+  }
+
+private:
+  struct Pool {
+    std::vector<std::unique_ptr<XveMemoryBlock>> blocks;
+  };
+
+  vk::Device device;
+  vk::PhysicalDeviceMemoryProperties memoryProperties;
+  uint32_t maxAllocationCount;
+  vk::DeviceSize preferredBlockSize;
+
+  std::mutex mutex;
+  // Indexed by memoryTypeIndex * 2 + ResourceKind.
+  std::vector<Pool> pools;
+  uint32_t deviceAllocationCount = 0;
+  std::array<vk::DeviceSize, XVE_MEMORY_CATEGORY_COUNT> categoryBytes{};
+
+  vk::DeviceSize blockSizeFor(uint32_t memoryTypeIndex) const;
+  std::unique_ptr<XveMemoryBlock> createBlock(vk::DeviceSize size,
+                                              uint32_t memoryTypeIndex,
+                                              uint32_t poolIndex,
+                                              bool dedicated);
+  void destroyBlock(XveMemoryBlock &block);
+};
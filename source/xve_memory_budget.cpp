@@ -0,0 +1,103 @@
+#include "xve_memory_budget.hpp"
+
+XveMemoryBudget::XveMemoryBudget(XveDevice &deviceRef,
+                                 const XveMemoryBudgetConfig &config_)
+    : device(deviceRef), config(config_) {
+  if (!device.getFeatures().memoryBudget) {
+    log(LogLevel::Warning,
+        "VK_EXT_memory_budget unavailable, assuming budgets of {:.0f}% of "
+        "heap size",
+        FALLBACK_BUDGET_FRACTION * 100.0);
+  }
+}
+
+XveMemorySnapshot XveMemoryBudget::snapshot() const {
+  auto &allocator = device.getAllocator();
+  auto &properties = allocator.getMemoryProperties();
+  auto stats = allocator.getStats();
+
+  XveMemorySnapshot result;
+  result.categoryBytes = stats.categoryBytes;
+  result.driverBudget = device.getFeatures().memoryBudget;
+  result.heaps.resize(properties.memoryHeapCount);
+  for (uint32_t i = 0; i < properties.memoryHeapCount; i++) {
+    auto &heap = result.heaps[i];
+    heap.size = properties.memoryHeaps[i].size;
+    heap.deviceLocal = static_cast<bool>(properties.memoryHeaps[i].flags &
+                                         vk::MemoryHeapFlagBits::eDeviceLocal);
+    heap.allocated = stats.heapBytes[i];
+    heap.budget = static_cast<vk::DeviceSize>(
+        static_cast<double>(heap.size) * FALLBACK_BUDGET_FRACTION);
+    heap.usage = heap.allocated;
+  }
+
+  if (result.driverBudget) {
+    auto chain = device.getPhysicalDevice().getMemoryProperties2<
+        vk::PhysicalDeviceMemoryProperties2,
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    auto &budget = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    for (uint32_t i = 0; i < properties.memoryHeapCount; i++) {
+      result.heaps[i].budget = budget.heapBudget[i];
+      result.heaps[i].usage = budget.heapUsage[i];
+    }
+  }
+  return result;
+}
+
+void XveMemoryBudget::update() {
+  auto count = updateCount++;
+  bool check = config.checkInterval != 0 && count % config.checkInterval == 0;
+  bool logNow = config.logInterval != 0 && count % config.logInterval == 0;
+  if (!check && !logNow) {
+    return;
+  }
+
+  auto current = snapshot();
+  overBudget.resize(current.heaps.size());
+  for (uint32_t i = 0; i < current.heaps.size(); i++) {
+    auto &heap = current.heaps[i];
+    bool over = static_cast<double>(heap.usage) >
+                static_cast<double>(heap.budget) * config.overBudgetFraction;
+    if (over && !overBudget[i]) {
+      log(LogLevel::Warning, "Memory heap {} over budget: {} of {} MiB", i,
+          heap.usage >> 20, heap.budget >> 20);
+      if (overBudgetCallback) {
+        overBudgetCallback(current, i);
+      }
+    }
+    overBudget[i] = over;
+  }
+
+  if (logNow) {
+    logSnapshot(current);
+  }
+}
+
+void XveMemoryBudget::logSnapshot(const XveMemorySnapshot &snapshot) {
+  std::string heaps;
+  for (uint32_t i = 0; i < snapshot.heaps.size(); i++) {
+    auto &heap = snapshot.heaps[i];
+    if (heap.allocated == 0 && heap.usage == 0) {
+      continue;
+    }
+    heaps += std::format("{}heap {}{}: {}/{} MiB (ours {} MiB)",
+                         heaps.empty() ? "" : ", ", i,
+                         heap.deviceLocal ? " (device)" : "",
+                         heap.usage >> 20, heap.budget >> 20,
+                         heap.allocated >> 20);
+  }
+
+  std::string categories;
+  for (size_t i = 0; i < XVE_MEMORY_CATEGORY_COUNT; i++) {
+    auto bytes = snapshot.categoryBytes[i];
+    if (bytes == 0) {
+      continue;
+    }
+    categories += std::format(
+        "{}{} {} KiB", categories.empty() ? "" : ", ",
+        memoryCategoryName(static_cast<XveMemoryCategory>(i)), bytes >> 10);
+  }
+
+  log(LogLevel::Info, "Memory{}: {}; {}",
+      snapshot.driverBudget ? "" : " (estimated budget)", heaps, categories);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include "xve_memory_allocator.hpp"
+#include <array>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct XveMemoryBudgetConfig {
+  /// update() takes a snapshot every this many calls.
+  uint32_t checkInterval = 60;
+  /// ...and logs one every this many calls; 0 never logs.
+  uint32_t logInterval = 600;
+  /// A heap counts as over budget past this fraction of its budget, leaving
+  /// headroom to evict before the driver starts paging.
+  double overBudgetFraction = 0.9;
+};
+
+struct XveMemoryHeapUsage {
+  vk::DeviceSize size = 0;
+  /// What the process can use before the driver starts paging.
+  vk::DeviceSize budget = 0;
+  /// The driver's figure for the whole process when it reports one,
+  /// otherwise the blocks our allocator holds.
+  vk::DeviceSize usage = 0;
+  /// Blocks our allocator holds in this heap.
+  vk::DeviceSize allocated = 0;
+  bool deviceLocal = false;
+};
+
+struct XveMemorySnapshot {
+  std::vector<XveMemoryHeapUsage> heaps;
+  /// Bytes handed out per XveMemoryCategory.
+  std::array<vk::DeviceSize, XVE_MEMORY_CATEGORY_COUNT> categoryBytes{};
+  /// Budgets and usage come from VK_EXT_memory_budget rather than estimates.
+  bool driverBudget = false;
+};
+
+/// Compares what the allocator holds, by heap and by category, with the
+/// heap budgets from VK_EXT_memory_budget. Without the extension a heap's
+/// budget is taken as a fixed fraction of its size.
+class XveMemoryBudget : Logger {
+public:
+  /// Called with the heap that went over budget; fires again only after
+  /// that heap has dropped back under.
+  using OverBudgetCallback =
+      std::function<void(const XveMemorySnapshot &, uint32_t heapIndex)>;
+
+  /// Budget assumed without VK_EXT_memory_budget, as a fraction of heap size.
+  static constexpr double FALLBACK_BUDGET_FRACTION = 0.8;
+
+  explicit XveMemoryBudget(XveDevice &deviceRef,
+                           const XveMemoryBudgetConfig &config = {});
+
+  XveMemorySnapshot snapshot() const;
+
+  void setOverBudgetCallback(OverBudgetCallback callback) {
+    overBudgetCallback = std::move(callback);
+  }
+
+  /// Call once per frame. Checks heaps against their budgets and logs at
+  /// the configured intervals.
+  void update();
+
+  void logSnapshot(const XveMemorySnapshot &snapshot);
+
+private:
+  XveDevice &device;
+  XveMemoryBudgetConfig config;
+  OverBudgetCallback overBudgetCallback;
+  uint64_t updateCount = 0;
+  std::vector<bool> overBudget;
+};
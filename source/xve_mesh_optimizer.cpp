@@ -0,0 +1,149 @@
+#include "xve_mesh_optimizer.hpp"
+
+#include <cassert>
+#include <limits>
+
+std::vector<uint32_t>
+XveMeshOptimizer::optimizeVertexCache(const std::vector<uint32_t> &indices,
+                                      uint32_t vertexCount,
+                                      uint32_t cacheSize) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+
+  auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount == 0) {
+    return {};
+  }
+
+  // Vertex -> triangle adjacency in CSR form.
+  std::vector<uint32_t> liveTriangles(vertexCount, 0);
+  for (auto index : indices) {
+    liveTriangles[index]++;
+  }
+
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+  }
+
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> fill(adjacencyOffsets.begin(),
+                             adjacencyOffsets.end() - 1);
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    for (uint32_t k = 0; k < 3; k++) {
+      auto v = indices[t * 3 + k];
+      adjacency[fill[v]++] = t;
+    }
+  }
+
+  std::vector<uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnd;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  constexpr auto NONE = std::numeric_limits<uint32_t>::max();
+  uint32_t timestamp = cacheSize + 1;
+  uint32_t cursor = 0;
+  uint32_t fanning = 0;
+
+  auto skipDeadEnd = [&]() -> uint32_t {
+    while (!deadEnd.empty()) {
+      auto v = deadEnd.back();
+      deadEnd.pop_back();
+      if (liveTriangles[v] > 0) {
+        return v;
+      }
+    }
+    while (cursor < vertexCount) {
+      if (liveTriangles[cursor] > 0) {
+        return cursor;
+      }
+      cursor++;
+    }
+    return NONE;
+  };
+
+  while (fanning != NONE) {
+    candidates.clear();
+
+    for (auto a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1];
+         a++) {
+      auto t = adjacency[a];
+      if (emitted[t]) {
+        continue;
+      }
+
+      for (uint32_t k = 0; k < 3; k++) {
+        auto v = indices[t * 3 + k];
+        result.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        liveTriangles[v]--;
+        if (timestamp - cacheTime[v] > cacheSize) {
+          cacheTime[v] = timestamp++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // Prefer the candidate that will still be in cache after its remaining
+    // triangles are emitted, and among those the one that entered earliest.
+    auto best = NONE;
+    int64_t bestPriority = -1;
+    for (auto v : candidates) {
+      if (liveTriangles[v] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+        priority = timestamp - cacheTime[v];
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        best = v;
+      }
+    }
+
+    fanning = best != NONE ? best : skipDeadEnd();
+  }
+
+  return result;
+}
+
+uint32_t XveMeshOptimizer::buildFetchRemap(const std::vector<uint32_t> &indices,
+                                           uint32_t vertexCount,
+                                           std::vector<uint32_t> &remap) {
+  constexpr auto UNUSED = std::numeric_limits<uint32_t>::max();
+  remap.assign(vertexCount, UNUSED);
+
+  uint32_t next = 0;
+  for (auto index : indices) {
+    if (remap[index] == UNUSED) {
+      remap[index] = next++;
+    }
+  }
+  return next;
+}
+
+float XveMeshOptimizer::computeAcmr(const std::vector<uint32_t> &indices,
+                                   uint32_t vertexCount, uint32_t cacheSize) {
+  if (indices.empty()) {
+    return 0.0f;
+  }
+
+  // FIFO cache: a vertex is resident while fewer than cacheSize misses have
+  // happened since it was loaded.
+  constexpr auto NEVER = std::numeric_limits<uint64_t>::max();
+  std::vector<uint64_t> loadedAt(vertexCount, NEVER);
+  uint64_t misses = 0;
+
+  for (auto index : indices) {
+    if (loadedAt[index] == NEVER || misses - loadedAt[index] >= cacheSize) {
+      loadedAt[index] = misses++;
+    }
+  }
+
+  return static_cast<float>(misses) /
+         static_cast<float>(indices.size() / 3);
+}
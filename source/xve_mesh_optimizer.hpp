@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// CPU-side index buffer optimizations for triangle lists.
+class XveMeshOptimizer {
+public:
+  static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+  /// Reorders triangles for post-transform vertex cache locality using
+  /// Tipsify (Sander, Nehab, Barczak 2007). Runs in linear time.
+  static std::vector<uint32_t>
+  optimizeVertexCache(const std::vector<uint32_t> &indices,
+                      uint32_t vertexCount,
+                      uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+  /// Builds a vertex remap table ordering vertices by first use in
+  /// `indices`, so vertex fetch walks memory mostly linearly. Unreferenced
+  /// vertices are dropped. Returns the new vertex count.
+  static uint32_t buildFetchRemap(const std::vector<uint32_t> &indices,
+                                  uint32_t vertexCount,
+                                  std::vector<uint32_t> &remap);
+
+  /// Average cache miss ratio: transformed vertices per triangle with a FIFO
+  /// cache of `cacheSize` entries. 3.0 is worst case, ~0.5 is ideal.
+  static float computeAcmr(const std::vector<uint32_t> &indices,
+                           uint32_t vertexCount,
+                           uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+};
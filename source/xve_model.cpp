@@ -1,59 +1,161 @@
 #include "xve_model.hpp"
+#include "xve_mesh_optimizer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
 #include <vulkan/vulkan_enums.hpp>
 
-XveModel::XveModel(XveDevice &deviceRef, const std::vector<Vertex> &vertices)
-    : device(deviceRef) {
-  createVertexBuffer(vertices);
+struct VertexHash {
+  size_t operator()(const XveModel::Vertex &vertex) const {
+    // Adding 0.0f folds -0.0f into 0.0f so equal vertices hash equally.
+    float components[] = {
+        vertex.position.x + 0.0f, vertex.position.y + 0.0f,
+        vertex.position.z + 0.0f, vertex.color.r + 0.0f,
+        vertex.color.g + 0.0f,    vertex.color.b + 0.0f,
+    };
+
+    uint64_t hash = 14695981039346656037ull;
+    for (auto component : components) {
+      uint32_t bits;
+      std::memcpy(&bits, &component, sizeof(bits));
+      hash = (hash ^ bits) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+  }
+};
+
+void XveModel::Builder::optimize() {
+  if (indices.empty()) {
+    indices.resize(vertices.size());
+    std::iota(indices.begin(), indices.end(), 0);
+  }
+
+  std::unordered_map<Vertex, uint32_t, VertexHash> uniqueIndices;
+  uniqueIndices.reserve(vertices.size());
+  std::vector<Vertex> uniqueVertices;
+  for (auto &index : indices) {
+    auto [it, inserted] = uniqueIndices.try_emplace(
+        vertices[index], static_cast<uint32_t>(uniqueVertices.size()));
+    if (inserted) {
+      uniqueVertices.push_back(vertices[index]);
+    }
+    index = it->second;
+  }
+
+  auto uniqueCount = static_cast<uint32_t>(uniqueVertices.size());
+  indices = XveMeshOptimizer::optimizeVertexCache(indices, uniqueCount);
+
+  std::vector<uint32_t> remap;
+  auto usedCount =
+      XveMeshOptimizer::buildFetchRemap(indices, uniqueCount, remap);
+
+  vertices.resize(usedCount);
+  for (uint32_t v = 0; v < uniqueCount; v++) {
+    if (remap[v] != std::numeric_limits<uint32_t>::max()) {
+      vertices[remap[v]] = uniqueVertices[v];
+    }
+  }
+  for (auto &index : indices) {
+    index = remap[index];
+  }
 }
 
-XveModel::~XveModel() {
-  device.getDevice().destroyBuffer(vertexBuffer);
-  device.getDevice().freeMemory(vertexBufferMemory);
+XveModel::XveModel(XveGeometryPool &poolRef, XveUploadManager &uploadManager,
+                   const Builder &builder)
+    : pool(poolRef) {
+  assert(builder.vertices.size() >= 3 && "Vertex count must be at least 3");
+  computeBoundingSphere(builder.vertices);
+  handle = pool.allocate(uploadManager, builder.vertices.data(),
+                         static_cast<uint32_t>(builder.vertices.size()),
+                         builder.indices);
 }
 
-void XveModel::createVertexBuffer(const std::vector<Vertex> &vertices) {
-  vertexCount = static_cast<uint32_t>(vertices.size());
-  assert(vertexCount >= 3 && "Vertex count must be at least 3");
+XveModel::~XveModel() { pool.free(handle); }
 
-  vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+void XveModel::computeBoundingSphere(const std::vector<Vertex> &vertices) {
+  // Centered on the bounding box: not minimal, but one pass and stable.
+  glm::vec3 low{std::numeric_limits<float>::max()};
+  glm::vec3 high{std::numeric_limits<float>::lowest()};
+  for (auto &vertex : vertices) {
+    low = glm::min(low, vertex.position);
+    high = glm::max(high, vertex.position);
+  }
+  auto center = (low + high) * 0.5f;
 
-  device.createBuffer(bufferSize, vk::BufferUsageFlagBits::eVertexBuffer,
-                      vk::MemoryPropertyFlagBits::eHostVisible |
-                          vk::MemoryPropertyFlagBits::eHostCoherent,
-                      vertexBuffer, vertexBufferMemory);
+  float radius = 0.0f;
+  for (auto &vertex : vertices) {
+    radius = std::max(radius, glm::length(vertex.position - center));
+  }
+  boundingSphere = glm::vec4{center, radius};
+}
 
-  void *data;
-  device.getDevice().mapMemory(vertexBufferMemory, {}, bufferSize, {}, &data);
-  memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-  device.getDevice().unmapMemory(vertexBufferMemory);
+void XveModel::draw(vk::CommandBuffer commandBuffer, uint32_t instanceCount,
+                    uint32_t firstInstance) {
+  auto &range = getRange();
+  if (range.indexCount > 0) {
+    commandBuffer.drawIndexed(range.indexCount, instanceCount,
+                              range.firstIndex,
+                              static_cast<int32_t>(range.firstVertex),
+                              firstInstance);
+  } else {
+    commandBuffer.draw(range.vertexCount, instanceCount, range.firstVertex,
+                       firstInstance);
+  }
 }
 
-void XveModel::draw(vk::CommandBuffer commandBuffer) {
-  commandBuffer.draw(vertexCount, 1, 0, 0);
+void XveModel::bindInstances(vk::CommandBuffer commandBuffer,
+                             vk::Buffer instanceBuffer,
+                             vk::DeviceSize offset) {
+  commandBuffer.bindVertexBuffers(1, 1, &instanceBuffer, &offset);
 }
 
 void XveModel::bind(vk::CommandBuffer commandBuffer) {
-  vk::Buffer buffers[] = {vertexBuffer};
-  vk::DeviceSize offsets[] = {0};
-
-  commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
+  pool.bind(commandBuffer);
 }
 
 std::vector<vk::VertexInputBindingDescription>
 XveModel::Vertex::getBindingDescription() {
-  std::vector<vk::VertexInputBindingDescription> bindingDescriptions(1);
+  std::vector<vk::VertexInputBindingDescription> bindingDescriptions(2);
   bindingDescriptions[0].binding = 0;
   bindingDescriptions[0].stride = sizeof(Vertex);
   bindingDescriptions[0].inputRate = vk::VertexInputRate::eVertex;
+
+  bindingDescriptions[1].binding = 1;
+  bindingDescriptions[1].stride = sizeof(Instance);
+  bindingDescriptions[1].inputRate = vk::VertexInputRate::eInstance;
   return bindingDescriptions;
 }
 
 std::vector<vk::VertexInputAttributeDescription>
 XveModel::Vertex::getAttributeDescription() {
-  std::vector<vk::VertexInputAttributeDescription> attributeDescriptions(1);
+  std::vector<vk::VertexInputAttributeDescription> attributeDescriptions(2);
   attributeDescriptions[0].binding = 0;
   attributeDescriptions[0].location = 0;
-  attributeDescriptions[0].format = vk::Format::eR32G32Sfloat;
-  attributeDescriptions[0].offset = 0;
+  attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
+  attributeDescriptions[0].offset = offsetof(Vertex, position);
+
+  attributeDescriptions[1].binding = 0;
+  attributeDescriptions[1].location = 1;
+  attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
+  attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+  // A mat4 attribute takes one location per column.
+  for (uint32_t column = 0; column < 4; column++) {
+    attributeDescriptions.push_back({
+        2 + column,
+        1,
+        vk::Format::eR32G32B32A32Sfloat,
+        static_cast<uint32_t>(offsetof(Instance, transform) +
+                              column * sizeof(glm::vec4)),
+    });
+  }
+  attributeDescriptions.push_back({
+      6,
+      1,
+      vk::Format::eR32G32B32A32Sfloat,
+      offsetof(Instance, color),
+  });
   return attributeDescriptions;
 }
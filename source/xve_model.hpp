@@ -1,6 +1,8 @@
 #pragma once
 
 #include "xve_device.hpp"
+#include "xve_geometry_pool.hpp"
+#include "xve_upload_manager.hpp"
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
@@ -11,7 +13,12 @@
 class XveModel {
 public:
   struct Vertex {
-    glm::vec2 position;
+    glm::vec3 position;
+    glm::vec3 color;
+
+    bool operator==(const Vertex &other) const {
+      return position == other.position && color == other.color;
+    }
 
     static std::vector<vk::VertexInputBindingDescription>
     getBindingDescription();
@@ -19,20 +26,54 @@ public:
     getAttributeDescription();
   };
 
-  XveModel(XveDevice &deviceRef, const std::vector<Vertex> &vertices);
+  /// Per-instance data, read at instance rate from vertex binding 1.
+  struct Instance {
+    glm::mat4 transform{1.0f};
+    glm::vec4 color{1.0f};
+  };
+
+  struct Builder {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    /// Merges identical vertices, reorders triangles for the post-transform
+    /// cache and vertices for fetch locality. Non-indexed input is treated as
+    /// a plain triangle list.
+    void optimize();
+  };
+
+  /// Stores the mesh in `pool`, which must have been created with a
+  /// stride of sizeof(Vertex) and must outlive the model.
+  XveModel(XveGeometryPool &poolRef, XveUploadManager &uploadManager,
+           const Builder &builder);
   ~XveModel();
 
   XveModel(const XveModel &) = delete;
   XveModel &operator=(const XveModel &) = delete;
 
+  /// Binds the pool's buffers; every model in the same pool shares them.
   void bind(vk::CommandBuffer commandBuffer);
-  void draw(vk::CommandBuffer commandBuffer);
+  /// Binds `Instance` data for the following draws.
+  static void bindInstances(vk::CommandBuffer commandBuffer,
+                            vk::Buffer instanceBuffer,
+                            vk::DeviceSize offset);
+  void draw(vk::CommandBuffer commandBuffer, uint32_t instanceCount = 1,
+            uint32_t firstInstance = 0);
+
+  bool isIndexed() const { return getRange().indexCount > 0; }
+  uint32_t getIndexCount() const { return getRange().indexCount; }
+  /// Where the mesh lives in the pool. May change when the pool compacts.
+  const XveGeometryPool::Range &getRange() const {
+    return pool.getRange(handle);
+  }
+  XveGeometryPool &getPool() const { return pool; }
+  /// Model-space bounding sphere: center in xyz, radius in w.
+  glm::vec4 getBoundingSphere() const { return boundingSphere; }
 
 private:
-  void createVertexBuffer(const std::vector<Vertex> &vertices);
+  void computeBoundingSphere(const std::vector<Vertex> &vertices);
 
-  XveDevice &device;
-  vk::Buffer vertexBuffer;
-  vk::DeviceMemory vertexBufferMemory;
-  uint32_t vertexCount;
+  XveGeometryPool &pool;
+  XveGeometryPool::Handle handle;
+  glm::vec4 boundingSphere{0.0f};
 };
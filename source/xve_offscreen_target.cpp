@@ -0,0 +1,390 @@
+#include "xve_offscreen_target.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <limits>
+
+XveOffscreenTarget::XveOffscreenTarget(XveDevice &deviceRef,
+                                       vk::Extent2D extent_,
+                                       uint32_t framesInFlight_,
+                                       bool dynamicRendering_,
+                                       const XveAttachmentConfig &attachments)
+    : device(deviceRef), extent(extent_), framesInFlight(framesInFlight_),
+      dynamicRendering(dynamicRendering_),
+      frameAttachments(deviceRef, attachments) {
+  if (dynamicRendering && !device.getFeatures().dynamicRendering) {
+    log(LogLevel::Warning,
+        "Dynamic rendering unsupported, falling back to a render pass");
+    dynamicRendering = false;
+  }
+  if (!dynamicRendering) {
+    createRenderPass();
+  }
+  createImages();
+  createSyncObjects();
+  log(LogLevel::Info, "Rendering offscreen at {}x{}", extent.width,
+      extent.height);
+}
+
+XveOffscreenTarget::~XveOffscreenTarget() {
+  for (auto fence : inFlightFences) {
+    device.getDevice().destroyFence(fence);
+  }
+  destroyImages();
+  device.getDevice().destroyRenderPass(renderPass);
+}
+
+std::string XveOffscreenTarget::describe() const {
+  return std::format(
+      "offscreen {}x{}, {} images, {}{}{}", extent.width, extent.height,
+      colorImages.size(), vk::to_string(getDepthFormat()),
+      frameAttachments.isMultisampled()
+          ? std::format(", {}x MSAA", vk::to_string(getSampleCount()))
+          : std::string{},
+      dynamicRendering ? ", dynamic rendering" : "");
+}
+
+XveRenderTarget::MemoryUsage XveOffscreenTarget::getMemoryUsage() const {
+  vk::DeviceSize colorBytes = 0;
+  for (auto &allocation : colorImageAllocations) {
+    colorBytes += allocation.size;
+  }
+  auto attachmentBytes = frameAttachments.getMemoryBytes();
+  return {colorBytes, attachmentBytes,
+          frameAttachments.getSetMemoryBytes() * colorImages.size()};
+}
+
+void XveOffscreenTarget::createRenderPass() {
+  auto samples = frameAttachments.getSampleCount();
+  auto multisampled = frameAttachments.isMultisampled();
+
+  // With MSAA the color image only receives the resolve.
+  auto colorAttachment = vk::AttachmentDescription{
+      vk::AttachmentDescriptionFlags(),
+      COLOR_FORMAT,
+      vk::SampleCountFlagBits::e1,
+      multisampled ? vk::AttachmentLoadOp::eDontCare
+                   : vk::AttachmentLoadOp::eClear,
+      vk::AttachmentStoreOp::eStore,
+      vk::AttachmentLoadOp::eDontCare,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined,
+      vk::ImageLayout::eTransferSrcOptimal,
+  };
+
+  auto depthAttachment = vk::AttachmentDescription{
+      vk::AttachmentDescriptionFlags(),
+      frameAttachments.getDepthFormat(),
+      samples,
+      vk::AttachmentLoadOp::eClear,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::AttachmentLoadOp::eDontCare,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined,
+      vk::ImageLayout::eDepthStencilAttachmentOptimal,
+  };
+
+  auto multisampledAttachment = vk::AttachmentDescription{
+      vk::AttachmentDescriptionFlags(),
+      COLOR_FORMAT,
+      samples,
+      vk::AttachmentLoadOp::eClear,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::AttachmentLoadOp::eDontCare,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined,
+      vk::ImageLayout::eColorAttachmentOptimal,
+  };
+
+  auto colorAttachmentRef = vk::AttachmentReference{
+      multisampled ? 2u : 0u,
+      vk::ImageLayout::eColorAttachmentOptimal,
+  };
+  auto resolveAttachmentRef = vk::AttachmentReference{
+      0,
+      vk::ImageLayout::eColorAttachmentOptimal,
+  };
+  auto depthAttachmentRef = vk::AttachmentReference{
+      1,
+      vk::ImageLayout::eDepthStencilAttachmentOptimal,
+  };
+
+  auto subpass = vk::SubpassDescription{
+      vk::SubpassDescriptionFlags(),
+      vk::PipelineBindPoint::eGraphics,
+      {},
+      {},
+      1,
+      &colorAttachmentRef,
+      multisampled ? &resolveAttachmentRef : nullptr,
+      &depthAttachmentRef,
+  };
+
+  std::array<vk::SubpassDependency, 2> dependencies = {
+      vk::SubpassDependency{
+          vk::SubpassExternal,
+          0,
+          vk::PipelineStageFlagBits::eColorAttachmentOutput |
+              vk::PipelineStageFlagBits::eEarlyFragmentTests,
+          vk::PipelineStageFlagBits::eColorAttachmentOutput |
+              vk::PipelineStageFlagBits::eEarlyFragmentTests,
+          {},
+          vk::AccessFlagBits::eColorAttachmentWrite |
+              vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+      },
+      // Makes the color writes visible to readback copies.
+      vk::SubpassDependency{
+          0,
+          vk::SubpassExternal,
+          vk::PipelineStageFlagBits::eColorAttachmentOutput,
+          vk::PipelineStageFlagBits::eTransfer,
+          vk::AccessFlagBits::eColorAttachmentWrite,
+          vk::AccessFlagBits::eTransferRead,
+      },
+  };
+
+  std::vector<vk::AttachmentDescription> attachments = {colorAttachment,
+                                                        depthAttachment};
+  if (multisampled) {
+    attachments.push_back(multisampledAttachment);
+  }
+
+  auto createInfo = vk::RenderPassCreateInfo{
+      vk::RenderPassCreateFlags(),
+      static_cast<uint32_t>(attachments.size()),
+      attachments.data(),
+      1,
+      &subpass,
+      static_cast<uint32_t>(dependencies.size()),
+      dependencies.data(),
+  };
+
+  try {
+    renderPass = device.getDevice().createRenderPass(createInfo);
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create offscreen render pass. Error: {}", e.what()));
+  }
+}
+
+void XveOffscreenTarget::createImages() {
+  colorImages.resize(framesInFlight);
+  colorImageAllocations.resize(framesInFlight);
+  colorImageViews.resize(framesInFlight);
+  framebuffers.resize(framesInFlight);
+  // With dynamic rendering the frame's render graph owns the depth buffer.
+  if (!dynamicRendering) {
+    frameAttachments.create(extent, COLOR_FORMAT, framesInFlight);
+  }
+
+  auto createImage = [this](vk::Format format, vk::ImageUsageFlags usage,
+                            vk::ImageAspectFlags aspect, vk::Image &image,
+                            XveAllocation &allocation, vk::ImageView &view) {
+    auto imageInfo = vk::ImageCreateInfo{
+        vk::ImageCreateFlags(),
+        vk::ImageType::e2D,
+        format,
+        vk::Extent3D{extent.width, extent.height, 1},
+        1,
+        1,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        usage,
+        vk::SharingMode::eExclusive,
+        {},
+        {},
+        vk::ImageLayout::eUndefined,
+    };
+    device.createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                       image, allocation, XveMemoryCategory::Attachments);
+
+    auto viewInfo = vk::ImageViewCreateInfo{
+        vk::ImageViewCreateFlags(),
+        image,
+        vk::ImageViewType::e2D,
+        format,
+        {},
+        {aspect, 0, 1, 0, 1},
+    };
+    view = device.getDevice().createImageView(viewInfo);
+  };
+
+  try {
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+      createImage(COLOR_FORMAT,
+                  vk::ImageUsageFlagBits::eColorAttachment |
+                      vk::ImageUsageFlagBits::eTransferSrc,
+                  vk::ImageAspectFlagBits::eColor, colorImages[i],
+                  colorImageAllocations[i], colorImageViews[i]);
+      if (dynamicRendering) {
+        continue;
+      }
+
+      std::vector<vk::ImageView> attachments = {
+          colorImageViews[i], frameAttachments.getDepthView(i)};
+      if (frameAttachments.isMultisampled()) {
+        attachments.push_back(frameAttachments.getColorView(i));
+      }
+      auto framebufferInfo = vk::FramebufferCreateInfo{
+          vk::FramebufferCreateFlags(),
+          renderPass,
+          static_cast<uint32_t>(attachments.size()),
+          attachments.data(),
+          extent.width,
+          extent.height,
+          1,
+      };
+      framebuffers[i] = device.getDevice().createFramebuffer(framebufferInfo);
+    }
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create offscreen images. Error: {}", e.what()));
+  }
+}
+
+void XveOffscreenTarget::destroyImages() {
+  frameAttachments.destroy();
+  for (uint32_t i = 0; i < colorImages.size(); i++) {
+    device.getDevice().destroyFramebuffer(framebuffers[i]);
+    device.getDevice().destroyImageView(colorImageViews[i]);
+    device.destroyImage(colorImages[i], colorImageAllocations[i]);
+  }
+  colorImages.clear();
+}
+
+void XveOffscreenTarget::createSyncObjects() {
+  auto fenceInfo = vk::FenceCreateInfo{
+      vk::FenceCreateFlagBits::eSignaled,
+  };
+
+  inFlightFences.resize(framesInFlight);
+  for (auto &fence : inFlightFences) {
+    try {
+      fence = device.getDevice().createFence(fenceInfo);
+    } catch (const vk::SystemError &e) {
+      throw std::runtime_error(
+          std::format("Failed to create Fence. Error: {}", e.what()));
+    }
+  }
+}
+
+vk::Result XveOffscreenTarget::acquireNextImage(uint32_t *imageIndex) {
+  auto waitStart = std::chrono::steady_clock::now();
+  device.getDevice().waitForFences(1, &inFlightFences[currentFrame], vk::True,
+                                   std::numeric_limits<uint64_t>::max());
+  auto waitEnd = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::milli> waited = waitEnd - waitStart;
+  syncStats.lastWaitMs = waited.count();
+  syncStats.totalWaitMs += waited.count();
+  syncStats.maxWaitMs = std::max(syncStats.maxWaitMs, waited.count());
+  if (profiler) {
+    profiler->recordCpuScope("frame wait", waitStart, waitEnd);
+  }
+
+  *imageIndex = currentFrame;
+  return vk::Result::eSuccess;
+}
+
+vk::Result
+XveOffscreenTarget::submitCommandBuffers(const vk::CommandBuffer *buffers,
+                                         uint32_t *imageIndex) {
+  auto submitStart = std::chrono::steady_clock::now();
+
+  vk::SubmitInfo submitInfo = {};
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = buffers;
+
+  device.getDevice().resetFences(1, &inFlightFences[currentFrame]);
+  device.getGraphicsQueue().submit(1, &submitInfo,
+                                   inFlightFences[currentFrame]);
+  syncStats.frameCount++;
+  if (profiler) {
+    profiler->recordCpuScope("submit", submitStart,
+                             std::chrono::steady_clock::now());
+  }
+
+  lastImage = *imageIndex;
+  currentFrame = (currentFrame + 1) % framesInFlight;
+  return vk::Result::eSuccess;
+}
+
+void XveOffscreenTarget::recreate(vk::Extent2D extent_) {
+  device.getDevice().waitForFences(
+      static_cast<uint32_t>(inFlightFences.size()), inFlightFences.data(),
+      vk::True, std::numeric_limits<uint64_t>::max());
+  destroyImages();
+  extent = extent_;
+  createImages();
+}
+
+void XveOffscreenTarget::readback(uint32_t imageIndex,
+                                  const std::string &filepath) {
+  // The slot's fence guards the last frame rendered into this image.
+  device.getDevice().waitForFences(1, &inFlightFences[imageIndex], vk::True,
+                                   std::numeric_limits<uint64_t>::max());
+
+  vk::DeviceSize size = vk::DeviceSize{extent.width} * extent.height * 4;
+  vk::Buffer buffer;
+  XveAllocation allocation;
+  device.createBuffer(size, vk::BufferUsageFlagBits::eTransferDst,
+                      vk::MemoryPropertyFlagBits::eHostVisible |
+                          vk::MemoryPropertyFlagBits::eHostCoherent,
+                      buffer, allocation, XveMemoryCategory::Staging);
+
+  auto allocInfo = vk::CommandBufferAllocateInfo{
+      device.getCommandPool(),
+      vk::CommandBufferLevel::ePrimary,
+      1,
+  };
+  auto commandBuffer =
+      device.getDevice().allocateCommandBuffers(allocInfo).front();
+
+  commandBuffer.begin(vk::CommandBufferBeginInfo{
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+  });
+  auto region = vk::BufferImageCopy{
+      0,
+      0,
+      0,
+      {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+      {0, 0, 0},
+      {extent.width, extent.height, 1},
+  };
+  commandBuffer.copyImageToBuffer(colorImages[imageIndex],
+                                  vk::ImageLayout::eTransferSrcOptimal, buffer,
+                                  region);
+  commandBuffer.end();
+
+  vk::SubmitInfo submitInfo = {};
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  device.getGraphicsQueue().submit(1, &submitInfo, nullptr);
+  device.getGraphicsQueue().waitIdle();
+  device.getDevice().freeCommandBuffers(device.getCommandPool(), commandBuffer);
+
+  std::ofstream file{filepath, std::ios::binary | std::ios::trunc};
+  if (!file.is_open()) {
+    device.destroyBuffer(buffer, allocation);
+    throw std::runtime_error(
+        std::format("Failed to open readback file: {}", filepath));
+  }
+
+  file << std::format("P6\n{} {}\n255\n", extent.width, extent.height);
+  auto pixels = static_cast<const char *>(allocation.mappedData);
+  std::vector<char> row(extent.width * 3);
+  for (uint32_t y = 0; y < extent.height; y++) {
+    auto source = pixels + size_t{y} * extent.width * 4;
+    for (uint32_t x = 0; x < extent.width; x++) {
+      row[x * 3 + 0] = source[x * 4 + 0];
+      row[x * 3 + 1] = source[x * 4 + 1];
+      row[x * 3 + 2] = source[x * 4 + 2];
+    }
+    file.write(row.data(), row.size());
+  }
+
+  device.destroyBuffer(buffer, allocation);
+  log(LogLevel::Info, "Wrote image {} to {}", imageIndex, filepath);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include "xve_frame_attachments.hpp"
+#include "xve_render_target.hpp"
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// Renders into plain images instead of a swapchain, one per frame in flight,
+/// so the app runs without a display (e.g. on lavapipe in CI). Color images
+/// end each frame in TransferSrcOptimal, ready for readback.
+/// `dynamicRendering` skips the render pass, framebuffers and depth images;
+/// it is ignored when the device lacks dynamic rendering.
+class XveOffscreenTarget : public XveRenderTarget, Logger {
+public:
+  static constexpr vk::Format COLOR_FORMAT = vk::Format::eR8G8B8A8Unorm;
+
+  XveOffscreenTarget(XveDevice &deviceRef, vk::Extent2D extent,
+                     uint32_t framesInFlight = 2,
+                     bool dynamicRendering = false,
+                     const XveAttachmentConfig &attachments = {});
+  ~XveOffscreenTarget() override;
+
+  XveOffscreenTarget(const XveOffscreenTarget &) = delete;
+  XveOffscreenTarget &operator=(const XveOffscreenTarget &) = delete;
+
+  vk::Extent2D getExtent() const override { return extent; }
+  vk::RenderPass getRenderPass() const override { return renderPass; }
+  /// Images and frame slots correspond one to one here.
+  vk::Framebuffer getFramebuffer(size_t imageIndex,
+                                 size_t) const override {
+    return framebuffers[imageIndex];
+  }
+  bool usesDynamicRendering() const override { return dynamicRendering; }
+  vk::Format getColorFormat() const override { return COLOR_FORMAT; }
+  vk::Format getDepthFormat() const override {
+    return frameAttachments.getDepthFormat();
+  }
+  vk::SampleCountFlagBits getSampleCount() const override {
+    return frameAttachments.getSampleCount();
+  }
+  vk::Image getColorImage(size_t i) const override { return colorImages[i]; }
+  vk::ImageView getColorImageView(size_t i) const override {
+    return colorImageViews[i];
+  }
+  vk::ImageLayout getFinalColorLayout() const override {
+    return vk::ImageLayout::eTransferSrcOptimal;
+  }
+  uint32_t getFramesInFlight() const override { return framesInFlight; }
+  uint32_t getCurrentFrame() const override { return currentFrame; }
+  const SyncStats &getSyncStats() const override { return syncStats; }
+  MemoryUsage getMemoryUsage() const override;
+  std::string describe() const override;
+  void setProfiler(XveProfiler *profiler_) override { profiler = profiler_; }
+
+  /// Image index always equals the frame slot.
+  vk::Result acquireNextImage(uint32_t *imageIndex) override;
+  vk::Result submitCommandBuffers(const vk::CommandBuffer *buffers,
+                                  uint32_t *imageIndex) override;
+  /// Waits for the GPU; offscreen targets are only resized by hand.
+  void recreate(vk::Extent2D extent) override;
+
+  /// Index of the image written by the most recent submission.
+  uint32_t getLastImage() const { return lastImage; }
+
+  /// Waits for the image's last frame and writes it as a binary PPM (P6).
+  void readback(uint32_t imageIndex, const std::string &filepath);
+
+private:
+  XveDevice &device;
+  vk::Extent2D extent;
+  uint32_t framesInFlight;
+  uint32_t currentFrame = 0;
+  uint32_t lastImage = 0;
+  bool dynamicRendering;
+
+  vk::RenderPass renderPass;
+  std::vector<vk::Image> colorImages;
+  std::vector<XveAllocation> colorImageAllocations;
+  std::vector<vk::ImageView> colorImageViews;
+  // Image index equals the frame slot, so these line up with colorImages.
+  XveFrameAttachments frameAttachments;
+  std::vector<vk::Framebuffer> framebuffers;
+  std::vector<vk::Fence> inFlightFences;
+
+  SyncStats syncStats;
+  XveProfiler *profiler = nullptr;
+
+  void createRenderPass();
+  void createImages();
+  void destroyImages();
+  void createSyncObjects();
+};
@@ -1,6 +1,7 @@
 #include "xve_pipeline.hpp"
 #include "xve_model.hpp"
 
+#include <chrono>
 #include <fstream>
 
 std::vector<char> XvePipeline::readFile(const std::string &filepath) {
@@ -102,15 +103,18 @@ void XvePipeline::bind(vk::CommandBuffer commandBuffer) {
 
 XvePipeline::XvePipeline(XveDevice &device_, const std::string &vertFilepath,
                          const std::string &fragFilepath,
-                         const PipelineConfigInfo &configInfo)
-    : device(device_) {
+                         const PipelineConfigInfo &configInfo,
+                         vk::PipelineCache pipelineCache)
+    : device(device_), pipelineLayout(configInfo.pipelineLayout) {
   if (configInfo.pipelineLayout == nullptr) {
     throw std::logic_error("Can't create graphics pipeline: no pipelineLayout "
                            "provided in configInfo.");
   }
-  if (configInfo.renderPass == nullptr) {
-    throw std::logic_error("Can't create graphics pipeline: no renderPass "
-                           "provided in configInfo.");
+  if (configInfo.renderPass == nullptr &&
+      configInfo.colorAttachmentFormat == vk::Format::eUndefined) {
+    throw std::logic_error("Can't create graphics pipeline: neither a "
+                           "renderPass nor attachment formats provided in "
+                           "configInfo.");
   }
 
   auto vertCode = readFile(vertFilepath);
@@ -142,6 +146,21 @@ XvePipeline::XvePipeline(XveDevice &device_, const std::string &vertFilepath,
       attributeDescriptions.data(),
   };
 
+  // configInfo may be a copy (e.g. captured by a compile job), so its
+  // viewport/blend state pointers can't be trusted; rebuild them here.
+  auto viewportInfo = configInfo.viewportInfo;
+  viewportInfo.pViewports = &configInfo.viewport;
+  viewportInfo.pScissors = &configInfo.scissor;
+
+  auto colorBlendInfo = configInfo.colorBlendInfo;
+  colorBlendInfo.pAttachments = &configInfo.colorBlendAttachment;
+
+  auto dynamicStateInfo = vk::PipelineDynamicStateCreateInfo{
+      vk::PipelineDynamicStateCreateFlags(),
+      static_cast<uint32_t>(configInfo.dynamicStateEnables.size()),
+      configInfo.dynamicStateEnables.data(),
+  };
+
   auto createInfo =
       vk::GraphicsPipelineCreateInfo{{},
                                      2,
@@ -149,12 +168,12 @@ XvePipeline::XvePipeline(XveDevice &device_, const std::string &vertFilepath,
                                      &vertexInputInfo,
                                      &configInfo.inputAssemblyInfo,
                                      nullptr,
-                                     &configInfo.viewportInfo,
+                                     &viewportInfo,
                                      &configInfo.rasterizationInfo,
                                      &configInfo.multisampleInfo,
                                      &configInfo.depthStencilInfo,
-                                     &configInfo.colorBlendInfo,
-                                     nullptr,
+                                     &colorBlendInfo,
+                                     &dynamicStateInfo,
 
                                      configInfo.pipelineLayout,
                                      configInfo.renderPass,
@@ -164,8 +183,26 @@ XvePipeline::XvePipeline(XveDevice &device_, const std::string &vertFilepath,
                                      -1,
                                      nullptr};
 
-  auto result = device.getDevice().createGraphicsPipeline(nullptr, createInfo);
+  auto renderingInfo = vk::PipelineRenderingCreateInfo{
+      0, 1, &configInfo.colorAttachmentFormat,
+      configInfo.depthAttachmentFormat, vk::Format::eUndefined};
+  if (configInfo.renderPass == nullptr) {
+    createInfo.pNext = &renderingInfo;
+  }
+
+  if (!pipelineCache) {
+    pipelineCache = device.getPipelineCache().get();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto result =
+      device.getDevice().createGraphicsPipeline(pipelineCache, createInfo);
   graphicsPipeline = result.value;
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  log(LogLevel::Debug, "Graphics pipeline created in {:.3f} ms",
+      elapsed.count());
 }
 
 XvePipeline::~XvePipeline() {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "xve_device.hpp"
+#include <type_traits>
 
 struct PipelineConfigInfo {
   vk::Viewport viewport;
@@ -12,26 +13,82 @@ struct PipelineConfigInfo {
   vk::PipelineColorBlendAttachmentState colorBlendAttachment;
   vk::PipelineColorBlendStateCreateInfo colorBlendInfo;
   vk::PipelineDepthStencilStateCreateInfo depthStencilInfo;
+  /// Viewport and scissor are dynamic by default so pipelines survive a
+  /// swapchain resize; the static viewport/scissor above are then ignored.
+  std::vector<vk::DynamicState> dynamicStateEnables = {
+      vk::DynamicState::eViewport,
+      vk::DynamicState::eScissor,
+  };
   vk::PipelineLayout pipelineLayout = nullptr;
   vk::RenderPass renderPass = nullptr;
   uint32_t subpass = 0;
+  /// Without a renderPass the pipeline is built for dynamic rendering into
+  /// attachments of these formats.
+  vk::Format colorAttachmentFormat = vk::Format::eUndefined;
+  vk::Format depthAttachmentFormat = vk::Format::eUndefined;
 };
 
 class XvePipeline : Logger {
 private:
-  static std::vector<char> readFile(const std::string &filepath);
   XveDevice &device;
 
   vk::Pipeline graphicsPipeline;
+  vk::PipelineLayout pipelineLayout;
   vk::ShaderModule vertShaderModule;
   vk::ShaderModule fragShaderModule;
 
   vk::ShaderModule createShaderModule(const std::vector<char> &code);
 
+  template <class T> static constexpr void checkPushConstantType() {
+    static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_SIZE,
+                  "Push constants beyond the guaranteed 128 bytes; use "
+                  "XveDynamicUniforms instead");
+    static_assert(sizeof(T) % 4 == 0,
+                  "Push constant sizes must be a multiple of 4");
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Push constants are copied as raw bytes");
+  }
+
 public:
+  /// Every implementation supports at least this many push constant bytes.
+  static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+  static constexpr vk::ShaderStageFlags DEFAULT_PUSH_CONSTANT_STAGES =
+      vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+
+  /// The range for a `T` at offset 0, for the pipeline layout. `T` must
+  /// match the shader's push_constant block byte for byte.
+  template <class T>
+  static constexpr vk::PushConstantRange pushConstantRange(
+      vk::ShaderStageFlags stages = DEFAULT_PUSH_CONSTANT_STAGES) {
+    checkPushConstantType<T>();
+    return vk::PushConstantRange{stages, 0, sizeof(T)};
+  }
+
+  /// `layout` must include pushConstantRange<T>(stages).
+  template <class T>
+  static void pushConstants(vk::CommandBuffer commandBuffer,
+                            vk::PipelineLayout layout,
+                            vk::ShaderStageFlags stages, const T &data) {
+    checkPushConstantType<T>();
+    commandBuffer.pushConstants(layout, stages, 0, sizeof(T), &data);
+  }
+
+  /// Pushes `data` through the layout this pipeline was created with.
+  template <class T>
+  void push(vk::CommandBuffer commandBuffer, const T &data,
+            vk::ShaderStageFlags stages = DEFAULT_PUSH_CONSTANT_STAGES) const {
+    pushConstants(commandBuffer, pipelineLayout, stages, data);
+  }
+
+  /// Reads a whole SPIR-V (or any binary) file.
+  static std::vector<char> readFile(const std::string &filepath);
+
+  /// Safe to call from worker threads. Uses the device-wide pipeline cache
+  /// unless another one is given.
   XvePipeline(XveDevice &deviceRef, const std::string &vertFilepath,
               const std::string &fragFilepath,
-              const PipelineConfigInfo &configInfo);
+              const PipelineConfigInfo &configInfo,
+              vk::PipelineCache pipelineCache = nullptr);
   ~XvePipeline();
 
   static PipelineConfigInfo defaultPipelineConfigInfo(uint32_t width,
@@ -0,0 +1,103 @@
+#include "xve_pipeline_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+
+XvePipelineCache::XvePipelineCache(vk::PhysicalDevice physicalDevice,
+                                   vk::Device device_,
+                                   std::filesystem::path filepath_)
+    : device(device_), filepath(std::move(filepath_)) {
+  deviceProperties = physicalDevice.getProperties();
+
+  auto initialData = loadCompatibleData();
+
+  auto createInfo = vk::PipelineCacheCreateInfo{
+      vk::PipelineCacheCreateFlags(),
+      initialData.size(),
+      initialData.data(),
+  };
+
+  try {
+    pipelineCache = device.createPipelineCache(createInfo);
+  } catch (const vk::SystemError &e) {
+    // A driver may still reject data that passed the header check; start
+    // from an empty cache rather than failing startup.
+    log(LogLevel::Warning, "Pipeline cache data rejected: {}", e.what());
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+    pipelineCache = device.createPipelineCache(createInfo);
+  }
+}
+
+XvePipelineCache::~XvePipelineCache() {
+  try {
+    save();
+  } catch (const std::exception &e) {
+    log(LogLevel::Error, "Failed to save pipeline cache: {}", e.what());
+  }
+  device.destroyPipelineCache(pipelineCache);
+}
+
+std::vector<char> XvePipelineCache::loadCompatibleData() {
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) {
+    log(LogLevel::Info, "No pipeline cache at {}, starting cold",
+        filepath.string());
+    return {};
+  }
+
+  size_t fileSize = static_cast<size_t>(file.tellg());
+  std::vector<char> data(fileSize);
+  file.seekg(0);
+  file.read(data.data(), fileSize);
+
+  if (!isCompatible(data)) {
+    log(LogLevel::Info, "Pipeline cache at {} is stale, starting cold",
+        filepath.string());
+    return {};
+  }
+
+  log(LogLevel::Info, "Loaded {} bytes of pipeline cache", data.size());
+  return data;
+}
+
+bool XvePipelineCache::isCompatible(const std::vector<char> &data) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == deviceProperties.vendorID &&
+         header.deviceID == deviceProperties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID,
+                     deviceProperties.pipelineCacheUUID.data(),
+                     VK_UUID_SIZE) == 0;
+}
+
+void XvePipelineCache::save() {
+  auto data = device.getPipelineCacheData(pipelineCache);
+
+  auto tmpPath = filepath;
+  tmpPath += ".tmp";
+
+  {
+    std::ofstream file{tmpPath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      throw std::runtime_error(std::format(
+          "Can't open pipeline cache file: {}", tmpPath.string()));
+    }
+    file.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    file.flush();
+    if (!file) {
+      throw std::runtime_error(std::format(
+          "Failed to write pipeline cache file: {}", tmpPath.string()));
+    }
+  }
+
+  std::filesystem::rename(tmpPath, filepath);
+  log(LogLevel::Info, "Saved {} bytes of pipeline cache", data.size());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "logger.hpp"
+#include <filesystem>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// Device-wide vk::PipelineCache persisted between runs. The file is only
+/// reused when its header matches the current vendor, device and driver
+/// cache UUID; otherwise the cache starts empty.
+class XvePipelineCache : Logger {
+private:
+  vk::Device device;
+  vk::PhysicalDeviceProperties deviceProperties;
+  std::filesystem::path filepath;
+
+  vk::PipelineCache pipelineCache;
+
+  std::vector<char> loadCompatibleData();
+  bool isCompatible(const std::vector<char> &data);
+
+public:
+  XvePipelineCache(vk::PhysicalDevice physicalDevice, vk::Device device,
+                   std::filesystem::path filepath);
+  ~XvePipelineCache();
+
+  XvePipelineCache(const XvePipelineCache &) = delete;
+  XvePipelineCache &operator=(const XvePipelineCache &) = delete;
+
+  vk::PipelineCache get() const { return pipelineCache; }
+
+  /// Writes the cache to a temporary file and renames it over the old one,
+  /// so a crash mid-write never leaves a truncated cache behind.
+  void save();
+};
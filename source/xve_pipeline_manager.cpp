@@ -0,0 +1,153 @@
+#include "xve_pipeline_manager.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <type_traits>
+
+class KeyHasher {
+private:
+  uint64_t hash = 14695981039346656037ull;
+
+public:
+  void addBytes(const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  }
+
+  template <class T> void add(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    addBytes(&value, sizeof(value));
+  }
+
+  void add(const std::string &value) {
+    add(value.size());
+    addBytes(value.data(), value.size());
+  }
+
+  uint64_t value() const { return hash; }
+};
+
+uint64_t XvePipelineManager::hashKey(const std::string &vertFilepath,
+                                     const std::string &fragFilepath,
+                                     const PipelineConfigInfo &configInfo) {
+  KeyHasher hasher;
+  hasher.add(vertFilepath);
+  hasher.add(fragFilepath);
+
+  // Only state that ends up in the pipeline is hashed; sType/pNext and the
+  // internal pointers of the create infos are skipped.
+  hasher.add(configInfo.viewport);
+  hasher.add(configInfo.scissor);
+
+  auto &inputAssembly = configInfo.inputAssemblyInfo;
+  hasher.add(inputAssembly.topology);
+  hasher.add(inputAssembly.primitiveRestartEnable);
+
+  auto &rasterization = configInfo.rasterizationInfo;
+  hasher.add(rasterization.depthClampEnable);
+  hasher.add(rasterization.rasterizerDiscardEnable);
+  hasher.add(rasterization.polygonMode);
+  hasher.add(rasterization.cullMode);
+  hasher.add(rasterization.frontFace);
+  hasher.add(rasterization.depthBiasEnable);
+  hasher.add(rasterization.depthBiasConstantFactor);
+  hasher.add(rasterization.depthBiasClamp);
+  hasher.add(rasterization.depthBiasSlopeFactor);
+  hasher.add(rasterization.lineWidth);
+
+  auto &multisample = configInfo.multisampleInfo;
+  hasher.add(multisample.rasterizationSamples);
+  hasher.add(multisample.sampleShadingEnable);
+  hasher.add(multisample.minSampleShading);
+  hasher.add(multisample.alphaToCoverageEnable);
+  hasher.add(multisample.alphaToOneEnable);
+
+  hasher.add(configInfo.colorBlendAttachment);
+  hasher.add(configInfo.colorBlendInfo.logicOpEnable);
+  hasher.add(configInfo.colorBlendInfo.logicOp);
+  hasher.add(configInfo.colorBlendInfo.blendConstants);
+
+  auto &depthStencil = configInfo.depthStencilInfo;
+  hasher.add(depthStencil.depthTestEnable);
+  hasher.add(depthStencil.depthWriteEnable);
+  hasher.add(depthStencil.depthCompareOp);
+  hasher.add(depthStencil.depthBoundsTestEnable);
+  hasher.add(depthStencil.stencilTestEnable);
+  hasher.add(depthStencil.front);
+  hasher.add(depthStencil.back);
+  hasher.add(depthStencil.minDepthBounds);
+  hasher.add(depthStencil.maxDepthBounds);
+
+  hasher.add(configInfo.dynamicStateEnables.size());
+  for (auto state : configInfo.dynamicStateEnables) {
+    hasher.add(state);
+  }
+
+  hasher.add(static_cast<VkPipelineLayout>(configInfo.pipelineLayout));
+  hasher.add(static_cast<VkRenderPass>(configInfo.renderPass));
+  hasher.add(configInfo.subpass);
+  hasher.add(configInfo.colorAttachmentFormat);
+  hasher.add(configInfo.depthAttachmentFormat);
+
+  return hasher.value();
+}
+
+XvePipelineManager::XvePipelineManager(XveDevice &deviceRef,
+                                       uint32_t threadCount)
+    : device(deviceRef), threadPool(threadCount) {
+  log(LogLevel::Info, "Compiling pipelines on {} worker threads",
+      threadPool.size());
+}
+
+XvePipelineManager::~XvePipelineManager() { waitIdle(); }
+
+XvePipelineHandle
+XvePipelineManager::request(const std::string &vertFilepath,
+                            const std::string &fragFilepath,
+                            const PipelineConfigInfo &configInfo) {
+  auto key = hashKey(vertFilepath, fragFilepath, configInfo);
+
+  std::lock_guard lock{mutex};
+  if (auto it = pipelines.find(key); it != pipelines.end()) {
+    return it->second;
+  }
+
+  auto state = std::make_shared<XvePipelineHandle::State>();
+  state->key = key;
+
+  // The job owns copies of everything it reads; the caller's config may go
+  // out of scope before the worker picks it up.
+  state->done =
+      threadPool
+          .submit([this, state, vertFilepath, fragFilepath, configInfo]() {
+            auto start = std::chrono::steady_clock::now();
+            try {
+              state->pipeline = std::make_unique<XvePipeline>(
+                  device, vertFilepath, fragFilepath, configInfo);
+              state->ready = true;
+            } catch (const std::exception &e) {
+              state->failed = true;
+              log(LogLevel::Error, "Pipeline {:016x} failed to compile: {}",
+                  state->key, e.what());
+              return;
+            }
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+            log(LogLevel::Debug, "Pipeline {:016x} ready in {:.3f} ms",
+                state->key, elapsed.count());
+          })
+          .share();
+
+  XvePipelineHandle handle{state};
+  pipelines.emplace(key, handle);
+  return handle;
+}
+
+void XvePipelineManager::waitIdle() {
+  std::lock_guard lock{mutex};
+  for (auto &[key, handle] : pipelines) {
+    handle.wait();
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include "xve_pipeline.hpp"
+#include "xve_thread_pool.hpp"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Handle to a pipeline that may still be compiling. Cheap to copy; all
+/// copies refer to the same pipeline.
+class XvePipelineHandle {
+public:
+  struct State {
+    uint64_t key;
+    std::unique_ptr<XvePipeline> pipeline;
+    std::atomic<bool> ready = false;
+    std::atomic<bool> failed = false;
+    std::shared_future<void> done;
+  };
+
+  XvePipelineHandle() = default;
+  explicit XvePipelineHandle(std::shared_ptr<State> state_)
+      : state(std::move(state_)) {}
+
+  explicit operator bool() const { return state != nullptr; }
+
+  uint64_t key() const { return state->key; }
+  bool isReady() const { return state && state->ready.load(); }
+  bool hasFailed() const { return state && state->failed.load(); }
+
+  /// The compiled pipeline, or nullptr while it is still being built.
+  XvePipeline *get() const {
+    return isReady() ? state->pipeline.get() : nullptr;
+  }
+
+  void wait() const {
+    if (state) {
+      state->done.wait();
+    }
+  }
+
+private:
+  std::shared_ptr<State> state;
+};
+
+/// Compiles graphics pipelines on a worker pool. Requests are keyed by a hash
+/// of the shaders and PipelineConfigInfo, so asking for the same permutation
+/// twice returns the same handle instead of compiling it again.
+class XvePipelineManager : Logger {
+public:
+  XvePipelineManager(
+      XveDevice &deviceRef,
+      uint32_t threadCount = XveThreadPool::defaultThreadCount());
+  ~XvePipelineManager();
+
+  XvePipelineManager(const XvePipelineManager &) = delete;
+  XvePipelineManager &operator=(const XvePipelineManager &) = delete;
+
+  static uint64_t hashKey(const std::string &vertFilepath,
+                          const std::string &fragFilepath,
+                          const PipelineConfigInfo &configInfo);
+
+  XvePipelineHandle request(const std::string &vertFilepath,
+                            const std::string &fragFilepath,
+                            const PipelineConfigInfo &configInfo);
+
+  /// Pipeline used by resolve() while a requested one is still compiling.
+  void setFallback(XvePipelineHandle handle) { fallback = std::move(handle); }
+
+  /// The handle's pipeline when ready, otherwise the fallback (which may be
+  /// nullptr if the fallback isn't ready either).
+  XvePipeline *resolve(const XvePipelineHandle &handle) const {
+    if (auto *pipeline = handle.get()) {
+      return pipeline;
+    }
+    return fallback.get();
+  }
+
+  void waitIdle();
+
+  uint32_t threadCount() const { return threadPool.size(); }
+
+private:
+  XveDevice &device;
+
+  std::mutex mutex;
+  std::unordered_map<uint64_t, XvePipelineHandle> pipelines;
+  XvePipelineHandle fallback;
+
+  // Declared last so workers are joined before the pipelines they build
+  // are destroyed.
+  XveThreadPool threadPool;
+};
@@ -0,0 +1,231 @@
+#include "xve_profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string_view>
+
+XveProfiler::XveProfiler(XveDevice &deviceRef, uint32_t framesInFlight,
+                         uint32_t maxGpuScopes_)
+    : device(deviceRef), maxGpuScopes(maxGpuScopes_) {
+  auto physicalDevice = device.getPhysicalDevice();
+  auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+  timestampsSupported =
+      queueFamilies[device.getGraphicsQueueFamily()].timestampValidBits > 0;
+  timestampPeriodNs = physicalDevice.getProperties().limits.timestampPeriod;
+
+  frames.resize(framesInFlight);
+  if (!timestampsSupported) {
+    log(LogLevel::Warning,
+        "Graphics queue has no timestamp support, GPU scopes disabled");
+    return;
+  }
+
+  auto queryPoolInfo = vk::QueryPoolCreateInfo{
+      vk::QueryPoolCreateFlags(),
+      vk::QueryType::eTimestamp,
+      maxGpuScopes * 2,
+  };
+
+  for (auto &frame : frames) {
+    try {
+      frame.queryPool = device.getDevice().createQueryPool(queryPoolInfo);
+    } catch (const vk::SystemError &e) {
+      throw std::runtime_error(std::format(
+          "Failed to create timestamp query pool. Error: {}", e.what()));
+    }
+  }
+}
+
+XveProfiler::~XveProfiler() {
+  for (auto &frame : frames) {
+    if (frame.queryPool) {
+      device.getDevice().destroyQueryPool(frame.queryPool);
+    }
+  }
+}
+
+void XveProfiler::beginFrame(uint32_t frameIndex) {
+  currentFrame = frameIndex;
+  auto &frame = frames[frameIndex];
+  if (!timestampsSupported || frame.queryCount == 0) {
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    return;
+  }
+
+  std::vector<uint64_t> timestamps(frame.queryCount);
+  auto result = device.getDevice().getQueryPoolResults(
+      frame.queryPool, 0, frame.queryCount,
+      timestamps.size() * sizeof(uint64_t), timestamps.data(),
+      sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+  // Not-ready means the slot wasn't actually retired; drop the frame rather
+  // than block on it.
+  if (result == vk::Result::eSuccess) {
+    auto frameStart = timestamps[frame.scopes.front().beginQuery];
+    for (auto &scope : frame.scopes) {
+      frameStart = std::min(frameStart, timestamps[scope.beginQuery]);
+    }
+
+    std::chrono::duration<double, std::micro> recordOffset =
+        frame.recordTime - epoch;
+    for (auto &scope : frame.scopes) {
+      auto begin = timestamps[scope.beginQuery];
+      auto end = timestamps[scope.beginQuery + 1];
+      auto durationUs = (end - begin) * timestampPeriodNs / 1000.0;
+      auto offsetUs = (begin - frameStart) * timestampPeriodNs / 1000.0;
+
+      std::lock_guard lock(mutex);
+      addSample(gpuStats, scope.name, durationUs / 1000.0);
+      addEvent({scope.name, true, 0, recordOffset.count() + offsetUs,
+                durationUs});
+    }
+  }
+
+  frame.scopes.clear();
+  frame.queryCount = 0;
+}
+
+void XveProfiler::resetQueries(vk::CommandBuffer commandBuffer) {
+  auto &frame = frames[currentFrame];
+  frame.recordTime = Clock::now();
+  if (timestampsSupported) {
+    commandBuffer.resetQueryPool(frame.queryPool, 0, maxGpuScopes * 2);
+  }
+}
+
+uint32_t XveProfiler::beginGpuScope(vk::CommandBuffer commandBuffer,
+                                    const char *name) {
+  auto &frame = frames[currentFrame];
+  if (!timestampsSupported || frame.scopes.size() == maxGpuScopes) {
+    return UINT32_MAX;
+  }
+
+  auto id = static_cast<uint32_t>(frame.scopes.size());
+  frame.scopes.push_back({name, frame.queryCount});
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                               frame.queryPool, frame.queryCount);
+  frame.queryCount += 2;
+  return id;
+}
+
+void XveProfiler::endGpuScope(vk::CommandBuffer commandBuffer, uint32_t id) {
+  if (id == UINT32_MAX) {
+    return;
+  }
+  auto &frame = frames[currentFrame];
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                               frame.queryPool,
+                               frame.scopes[id].beginQuery + 1);
+}
+
+void XveProfiler::recordCpuScope(const char *name, Clock::time_point start,
+                                 Clock::time_point end) {
+  std::chrono::duration<double, std::micro> startUs = start - epoch;
+  std::chrono::duration<double, std::micro> durationUs = end - start;
+
+  std::lock_guard lock(mutex);
+  addSample(cpuStats, name, durationUs.count() / 1000.0);
+  addEvent({name, false, threadId(), startUs.count(), durationUs.count()});
+}
+
+void XveProfiler::addSample(StatsMap &stats, const char *name, double ms) {
+  auto it = stats.find(std::string_view(name));
+  if (it == stats.end()) {
+    it = stats.emplace(name, RollingStats{}).first;
+    it->second.samples.reserve(STATS_WINDOW);
+  }
+
+  auto &scopeStats = it->second;
+  if (scopeStats.samples.size() < STATS_WINDOW) {
+    scopeStats.samples.push_back(ms);
+  } else {
+    scopeStats.samples[scopeStats.next] = ms;
+  }
+  scopeStats.next = (scopeStats.next + 1) % STATS_WINDOW;
+  scopeStats.count++;
+}
+
+void XveProfiler::addEvent(const TraceEvent &event) {
+  if (events.size() == MAX_TRACE_EVENTS) {
+    events.pop_front();
+  }
+  events.push_back(event);
+}
+
+uint32_t XveProfiler::threadId() {
+  // Trace thread 0 is the GPU lane.
+  auto [it, inserted] = threadIds.emplace(
+      std::this_thread::get_id(), static_cast<uint32_t>(threadIds.size() + 1));
+  return it->second;
+}
+
+std::vector<XveProfiler::ScopeSummary> XveProfiler::getSummaries() const {
+  std::lock_guard lock(mutex);
+
+  std::vector<ScopeSummary> summaries;
+  auto summarize = [&summaries](const StatsMap &stats, bool gpu) {
+    for (auto &[name, scopeStats] : stats) {
+      auto sorted = scopeStats.samples;
+      std::sort(sorted.begin(), sorted.end());
+
+      double sum = 0.0;
+      for (auto sample : sorted) {
+        sum += sample;
+      }
+      auto p99Index = static_cast<size_t>(
+          std::ceil(0.99 * static_cast<double>(sorted.size())) - 1);
+
+      summaries.push_back({name, gpu, scopeStats.count, sorted.front(),
+                           sum / sorted.size(), sorted[p99Index]});
+    }
+  };
+  summarize(cpuStats, false);
+  summarize(gpuStats, true);
+  return summaries;
+}
+
+void XveProfiler::reset() {
+  std::lock_guard lock(mutex);
+  cpuStats.clear();
+  gpuStats.clear();
+  events.clear();
+}
+
+void XveProfiler::logSummaries() {
+  for (auto &summary : getSummaries()) {
+    log(LogLevel::Info,
+        "{} {:<10} min {:.3f} ms, avg {:.3f} ms, p99 {:.3f} ms ({} samples)",
+        summary.gpu ? "GPU" : "CPU", summary.name, summary.minMs,
+        summary.avgMs, summary.p99Ms, summary.count);
+  }
+}
+
+void XveProfiler::writeChromeTrace(const std::string &filepath) {
+  std::ofstream file{filepath, std::ios::trunc};
+  if (!file.is_open()) {
+    log(LogLevel::Warning, "Failed to write profile trace: {}", filepath);
+    return;
+  }
+
+  std::lock_guard lock(mutex);
+  file << "{\"traceEvents\":[\n";
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+          "\"args\":{\"name\":\"GPU\"}}";
+  for (auto &[id, tid] : threadIds) {
+    file << std::format(",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                        "\"tid\":{},\"args\":{{\"name\":\"CPU {}\"}}}}",
+                        tid, tid);
+  }
+  for (auto &event : events) {
+    file << std::format(",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\","
+                        "\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                        event.name, event.gpu ? "gpu" : "cpu", event.threadId,
+                        event.startUs, event.durationUs);
+  }
+  file << "\n]}\n";
+
+  log(LogLevel::Info, "Wrote {} profile events to {}", events.size(),
+      filepath);
+}
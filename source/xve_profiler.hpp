@@ -0,0 +1,154 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// CPU scoped timers plus GPU timestamp queries, one query pool per frame in
+/// flight. A slot's results are read in beginFrame(), after the swapchain has
+/// waited for that slot, so readback never stalls. Every scope feeds rolling
+/// min/avg/p99 statistics and a bounded event log for Chrome's trace viewer.
+/// Scope names are kept by pointer and must be string literals.
+class XveProfiler : Logger {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr uint32_t DEFAULT_MAX_GPU_SCOPES = 64;
+  /// Samples kept per scope for the rolling statistics.
+  static constexpr size_t STATS_WINDOW = 512;
+  /// Oldest trace events are dropped past this count.
+  static constexpr size_t MAX_TRACE_EVENTS = 200000;
+
+  struct ScopeSummary {
+    std::string name;
+    bool gpu;
+    uint64_t count;
+    double minMs;
+    double avgMs;
+    double p99Ms;
+  };
+
+  class CpuScope {
+  public:
+    CpuScope(XveProfiler &profiler, const char *name)
+        : profiler(profiler), name(name), start(Clock::now()) {}
+    ~CpuScope() { profiler.recordCpuScope(name, start, Clock::now()); }
+
+    CpuScope(const CpuScope &) = delete;
+    CpuScope &operator=(const CpuScope &) = delete;
+
+  private:
+    XveProfiler &profiler;
+    const char *name;
+    Clock::time_point start;
+  };
+
+  class GpuScope {
+  public:
+    GpuScope(XveProfiler &profiler, vk::CommandBuffer commandBuffer,
+             const char *name)
+        : profiler(profiler), commandBuffer(commandBuffer),
+          id(profiler.beginGpuScope(commandBuffer, name)) {}
+    ~GpuScope() { profiler.endGpuScope(commandBuffer, id); }
+
+    GpuScope(const GpuScope &) = delete;
+    GpuScope &operator=(const GpuScope &) = delete;
+
+  private:
+    XveProfiler &profiler;
+    vk::CommandBuffer commandBuffer;
+    uint32_t id;
+  };
+
+  XveProfiler(XveDevice &deviceRef, uint32_t framesInFlight,
+              uint32_t maxGpuScopes = DEFAULT_MAX_GPU_SCOPES);
+  ~XveProfiler();
+
+  XveProfiler(const XveProfiler &) = delete;
+  XveProfiler &operator=(const XveProfiler &) = delete;
+
+  /// Collects the slot's previous GPU results. The GPU must be done with it.
+  void beginFrame(uint32_t frameIndex);
+  /// Must be recorded before any GPU scope of the frame, outside a render
+  /// pass.
+  void resetQueries(vk::CommandBuffer commandBuffer);
+
+  /// For spans that don't fit a lexical scope.
+  void recordCpuScope(const char *name, Clock::time_point start,
+                      Clock::time_point end);
+
+  uint32_t beginGpuScope(vk::CommandBuffer commandBuffer, const char *name);
+  void endGpuScope(vk::CommandBuffer commandBuffer, uint32_t id);
+
+  bool hasGpuTimestamps() const { return timestampsSupported; }
+
+  std::vector<ScopeSummary> getSummaries() const;
+  /// Drops all statistics and trace events, e.g. between benchmark runs.
+  void reset();
+  void logSummaries();
+  /// Writes the event log in Chrome trace event format (chrome://tracing,
+  /// Perfetto).
+  void writeChromeTrace(const std::string &filepath);
+
+private:
+  struct GpuScopeRecord {
+    const char *name;
+    uint32_t beginQuery;
+  };
+
+  struct FrameQueries {
+    vk::QueryPool queryPool;
+    std::vector<GpuScopeRecord> scopes;
+    uint32_t queryCount = 0;
+    // CPU time at which the frame was recorded; GPU events are placed on
+    // the trace relative to it since the two clocks aren't calibrated.
+    Clock::time_point recordTime;
+  };
+
+  struct TraceEvent {
+    const char *name;
+    bool gpu;
+    uint32_t threadId;
+    double startUs;
+    double durationUs;
+  };
+
+  struct RollingStats {
+    std::vector<double> samples;
+    size_t next = 0;
+    uint64_t count = 0;
+  };
+  using StatsMap = std::map<std::string, RollingStats, std::less<>>;
+
+  XveDevice &device;
+  bool timestampsSupported = false;
+  double timestampPeriodNs = 1.0;
+  uint32_t maxGpuScopes;
+
+  std::vector<FrameQueries> frames;
+  uint32_t currentFrame = 0;
+
+  Clock::time_point epoch = Clock::now();
+
+  mutable std::mutex mutex;
+  StatsMap cpuStats;
+  StatsMap gpuStats;
+  std::deque<TraceEvent> events;
+  std::map<std::thread::id, uint32_t> threadIds;
+
+  void addSample(StatsMap &stats, const char *name, double ms);
+  void addEvent(const TraceEvent &event);
+  uint32_t threadId();
+};
+
+#define XVE_CONCAT_INNER(a, b) a##b
+#define XVE_CONCAT(a, b) XVE_CONCAT_INNER(a, b)
+#define XVE_PROFILE_SCOPE(profiler, name)                                      \
+  XveProfiler::CpuScope XVE_CONCAT(xveProfileScope, __LINE__)(profiler, name)
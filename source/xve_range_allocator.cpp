@@ -0,0 +1,88 @@
+#include "xve_range_allocator.hpp"
+
+#include <cassert>
+
+XveRangeAllocator::XveRangeAllocator(uint64_t capacity_)
+    : capacity(capacity_) {
+  if (capacity > 0) {
+    insertFreeRange(0, capacity);
+  }
+}
+
+void XveRangeAllocator::insertFreeRange(uint64_t offset, uint64_t size) {
+  freeByOffset.emplace(offset, size);
+  freeBySize.emplace(size, offset);
+}
+
+void XveRangeAllocator::eraseFreeRange(
+    std::map<uint64_t, uint64_t>::iterator it) {
+  auto [first, last] = freeBySize.equal_range(it->second);
+  for (auto sizeIt = first; sizeIt != last; ++sizeIt) {
+    if (sizeIt->second == it->first) {
+      freeBySize.erase(sizeIt);
+      break;
+    }
+  }
+  freeByOffset.erase(it);
+}
+
+std::optional<uint64_t> XveRangeAllocator::allocate(uint64_t size,
+                                                    uint64_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0 &&
+         "Alignment must be a power of two");
+  if (size == 0) {
+    return std::nullopt;
+  }
+
+  // Best fit: smallest free range that still holds the aligned request.
+  for (auto it = freeBySize.lower_bound(size); it != freeBySize.end(); ++it) {
+    uint64_t rangeOffset = it->second;
+    uint64_t rangeSize = it->first;
+    uint64_t alignedOffset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+    uint64_t padding = alignedOffset - rangeOffset;
+    if (padding + size > rangeSize) {
+      continue;
+    }
+
+    eraseFreeRange(freeByOffset.find(rangeOffset));
+    if (padding > 0) {
+      insertFreeRange(rangeOffset, padding);
+    }
+    uint64_t tail = rangeSize - padding - size;
+    if (tail > 0) {
+      insertFreeRange(alignedOffset + size, tail);
+    }
+
+    usedBytes += size;
+    allocationCount++;
+    return alignedOffset;
+  }
+
+  return std::nullopt;
+}
+
+void XveRangeAllocator::free(uint64_t offset, uint64_t size) {
+  assert(offset + size <= capacity && "Freed range is out of bounds");
+  assert(allocationCount > 0 && "Double free in range allocator");
+
+  usedBytes -= size;
+  allocationCount--;
+
+  auto next = freeByOffset.lower_bound(offset);
+  if (next != freeByOffset.end() && next->first == offset + size) {
+    size += next->second;
+    eraseFreeRange(next);
+  }
+
+  auto prev = freeByOffset.lower_bound(offset);
+  if (prev != freeByOffset.begin()) {
+    --prev;
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      eraseFreeRange(prev);
+    }
+  }
+
+  insertFreeRange(offset, size);
+}
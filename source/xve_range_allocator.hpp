@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+/// Free-list allocator for offset ranges inside a fixed-size region.
+/// Knows nothing about Vulkan: callers map the returned offsets onto device
+/// memory blocks or buffers themselves.
+class XveRangeAllocator {
+private:
+  uint64_t capacity;
+  uint64_t usedBytes = 0;
+  uint32_t allocationCount = 0;
+
+  // Free ranges keyed by offset (for coalescing) and by size (for best-fit).
+  std::map<uint64_t, uint64_t> freeByOffset;
+  std::multimap<uint64_t, uint64_t> freeBySize;
+
+  void insertFreeRange(uint64_t offset, uint64_t size);
+  void eraseFreeRange(std::map<uint64_t, uint64_t>::iterator it);
+
+public:
+  explicit XveRangeAllocator(uint64_t capacity);
+
+  std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment = 1);
+  void free(uint64_t offset, uint64_t size);
+
+  uint64_t getCapacity() const { return capacity; }
+  uint64_t getUsedBytes() const { return usedBytes; }
+  uint64_t getFreeBytes() const { return capacity - usedBytes; }
+  uint32_t getAllocationCount() const { return allocationCount; }
+  uint32_t getFreeRangeCount() const {
+    return static_cast<uint32_t>(freeByOffset.size());
+  }
+  uint64_t getLargestFreeRange() const {
+    return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+  }
+  bool empty() const { return allocationCount == 0; }
+};
@@ -0,0 +1,693 @@
+#include "xve_render_graph.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+struct UsageInfo {
+  vk::PipelineStageFlags2 stages;
+  vk::AccessFlags2 access;
+  vk::ImageLayout layout;
+  vk::ImageUsageFlags usage;
+};
+
+UsageInfo usageInfo(XveImageUsage usage) {
+  switch (usage) {
+  case XveImageUsage::ColorAttachment:
+    return {vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            vk::AccessFlagBits2::eColorAttachmentRead |
+                vk::AccessFlagBits2::eColorAttachmentWrite,
+            vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ImageUsageFlagBits::eColorAttachment};
+  case XveImageUsage::DepthAttachment:
+    return {vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                vk::PipelineStageFlagBits2::eLateFragmentTests,
+            vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            vk::ImageUsageFlagBits::eDepthStencilAttachment};
+  case XveImageUsage::SampledFragment:
+    return {vk::PipelineStageFlagBits2::eFragmentShader,
+            vk::AccessFlagBits2::eShaderSampledRead,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageUsageFlagBits::eSampled};
+  case XveImageUsage::SampledCompute:
+    return {vk::PipelineStageFlagBits2::eComputeShader,
+            vk::AccessFlagBits2::eShaderSampledRead,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageUsageFlagBits::eSampled};
+  case XveImageUsage::TransferSrc:
+    return {vk::PipelineStageFlagBits2::eAllTransfer,
+            vk::AccessFlagBits2::eTransferRead,
+            vk::ImageLayout::eTransferSrcOptimal,
+            vk::ImageUsageFlagBits::eTransferSrc};
+  case XveImageUsage::TransferDst:
+    return {vk::PipelineStageFlagBits2::eAllTransfer,
+            vk::AccessFlagBits2::eTransferWrite,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageUsageFlagBits::eTransferDst};
+  }
+  throw std::logic_error("Unknown XveImageUsage");
+}
+
+constexpr vk::AccessFlags2 WRITE_ACCESS =
+    vk::AccessFlagBits2::eColorAttachmentWrite |
+    vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderWrite |
+    vk::AccessFlagBits2::eMemoryWrite;
+
+bool isDepthFormat(vk::Format format) {
+  switch (format) {
+  case vk::Format::eD16Unorm:
+  case vk::Format::eX8D24UnormPack32:
+  case vk::Format::eD32Sfloat:
+  case vk::Format::eD16UnormS8Uint:
+  case vk::Format::eD24UnormS8Uint:
+  case vk::Format::eD32SfloatS8Uint:
+    return true;
+  default:
+    return false;
+  }
+}
+
+vk::ImageAspectFlags aspectFor(vk::Format format) {
+  switch (format) {
+  case vk::Format::eD16UnormS8Uint:
+  case vk::Format::eD24UnormS8Uint:
+  case vk::Format::eD32SfloatS8Uint:
+    return vk::ImageAspectFlagBits::eDepth |
+           vk::ImageAspectFlagBits::eStencil;
+  default:
+    return isDepthFormat(format) ? vk::ImageAspectFlagBits::eDepth
+                                 : vk::ImageAspectFlagBits::eColor;
+  }
+}
+
+} // namespace
+
+void XveRenderGraph::PassBuilder::setColorAttachment(
+    ResourceId image, std::optional<vk::ClearColorValue> clear,
+    std::optional<ResourceId> resolve) {
+  auto &target = graph.passes[pass];
+  target.color = Attachment{image, clear.has_value(), resolve};
+  if (clear) {
+    target.color->clearValue.color = *clear;
+  }
+  target.uses.push_back({image, XveImageUsage::ColorAttachment, true});
+  // Resolve writes happen in the color attachment output stage.
+  if (resolve) {
+    target.uses.push_back({*resolve, XveImageUsage::ColorAttachment, true});
+  }
+}
+
+void XveRenderGraph::PassBuilder::setDepthAttachment(
+    ResourceId image, std::optional<vk::ClearDepthStencilValue> clear) {
+  auto &target = graph.passes[pass];
+  target.depth = Attachment{image, clear.has_value()};
+  if (clear) {
+    target.depth->clearValue.depthStencil = *clear;
+  }
+  target.uses.push_back({image, XveImageUsage::DepthAttachment, true});
+}
+
+void XveRenderGraph::PassBuilder::read(ResourceId image,
+                                       XveImageUsage usage) {
+  graph.passes[pass].uses.push_back({image, usage, false});
+}
+
+void XveRenderGraph::PassBuilder::write(ResourceId image,
+                                        XveImageUsage usage) {
+  graph.passes[pass].uses.push_back({image, usage, true});
+}
+
+void XveRenderGraph::PassBuilder::setSideEffects() {
+  graph.passes[pass].sideEffects = true;
+}
+
+void XveRenderGraph::PassBuilder::useSecondaryCommandBuffers() {
+  graph.passes[pass].secondaryCommandBuffers = true;
+}
+
+XveRenderGraph::XveRenderGraph(XveDevice &deviceRef, uint32_t framesInFlight)
+    : device(deviceRef), framesInFlight(framesInFlight) {}
+
+XveRenderGraph::~XveRenderGraph() {
+  retiredMemory.flushAll();
+  for (auto &physical : physicalImages) {
+    device.getDevice().destroyImageView(physical.view);
+    device.getDevice().destroyImage(physical.image);
+  }
+  for (auto &slot : memorySlots) {
+    device.getAllocator().free(slot.allocation);
+  }
+}
+
+void XveRenderGraph::beginFrame(uint64_t frame) {
+  currentFrame = frame;
+  if (frame >= framesInFlight) {
+    retiredMemory.flush(frame - framesInFlight);
+  }
+  passes.clear();
+  resources.clear();
+  finalBarriers.clear();
+}
+
+XveRenderGraph::ResourceId XveRenderGraph::importImage(
+    const std::string &name, vk::Image image, vk::ImageView view,
+    vk::Format format, vk::Extent2D extent, vk::ImageLayout initialLayout,
+    vk::ImageLayout finalLayout, vk::PipelineStageFlags2 initialStages) {
+  Resource resource{.name = name,
+                    .imported = true,
+                    .image = image,
+                    .view = view,
+                    .format = format,
+                    .extent = extent,
+                    .finalLayout = finalLayout};
+  resource.initialState = {initialStages, {}, initialLayout};
+  resources.push_back(std::move(resource));
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+XveRenderGraph::ResourceId
+XveRenderGraph::createImage(const std::string &name, vk::Format format,
+                            vk::Extent2D extent,
+                            vk::SampleCountFlagBits samples) {
+  resources.push_back(Resource{
+      .name = name, .format = format, .extent = extent, .samples = samples});
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+void XveRenderGraph::addPass(const char *name, const SetupFunction &setup,
+                             ExecuteFunction execute) {
+  passes.push_back(Pass{.name = name, .execute = std::move(execute)});
+  PassBuilder builder{*this, static_cast<uint32_t>(passes.size() - 1)};
+  setup(builder);
+}
+
+void XveRenderGraph::compile() {
+  stats = {};
+  stats.passCount = static_cast<uint32_t>(passes.size());
+
+  cullPasses();
+  for (uint32_t i = 0; i < passes.size(); i++) {
+    if (!passes[i].live) {
+      stats.culledPassCount++;
+      continue;
+    }
+    for (auto &use : passes[i].uses) {
+      auto &resource = resources[use.image];
+      resource.firstPass = std::min(resource.firstPass, i);
+      resource.lastPass = std::max(resource.lastPass, i);
+      resource.usage |= usageInfo(use.usage).usage;
+    }
+  }
+
+  placeTransients();
+  computeBarriers();
+}
+
+void XveRenderGraph::cullPasses() {
+  // Walking backwards, an image is needed while some later live pass (or
+  // the frame's output) still depends on its current contents.
+  std::vector<bool> needed(resources.size());
+  for (size_t i = 0; i < resources.size(); i++) {
+    needed[i] = resources[i].imported;
+  }
+
+  auto clears = [](const Pass &pass, const ImageUse &use) {
+    if (use.usage != XveImageUsage::ColorAttachment &&
+        use.usage != XveImageUsage::DepthAttachment) {
+      return false;
+    }
+    auto &attachment =
+        use.usage == XveImageUsage::ColorAttachment ? pass.color : pass.depth;
+    return attachment &&
+           ((attachment->image == use.image && attachment->clear) ||
+            attachment->resolve == use.image);
+  };
+
+  for (auto i = passes.size(); i-- > 0;) {
+    auto &pass = passes[i];
+    pass.live = pass.sideEffects ||
+                std::any_of(pass.uses.begin(), pass.uses.end(),
+                            [&needed](const ImageUse &use) {
+                              return use.write && needed[use.image];
+                            });
+    if (!pass.live) {
+      continue;
+    }
+
+    // A cleared or resolved attachment doesn't depend on earlier writers;
+    // anything read, loaded or partially written does.
+    for (auto &use : pass.uses) {
+      if (clears(pass, use)) {
+        needed[use.image] = false;
+      }
+    }
+    for (auto &use : pass.uses) {
+      if (!clears(pass, use)) {
+        needed[use.image] = true;
+      }
+    }
+  }
+}
+
+std::optional<uint32_t>
+XveRenderGraph::findMemoryType(uint32_t typeBits,
+                               vk::MemoryPropertyFlags properties) const {
+  auto memProperties = device.getPhysicalDevice().getMemoryProperties();
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    if ((typeBits & (1u << i)) &&
+        (memProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+void XveRenderGraph::placeTransients() {
+  std::vector<uint32_t> transients;
+  for (uint32_t i = 0; i < resources.size(); i++) {
+    auto &resource = resources[i];
+    if (!resource.imported && resource.firstPass <= resource.lastPass) {
+      transients.push_back(i);
+    }
+  }
+
+  // The same images with the same lifetimes as last frame, which is the
+  // steady state: keep the existing placement.
+  auto matches = transients.size() == physicalImages.size();
+  for (size_t i = 0; matches && i < transients.size(); i++) {
+    auto &resource = resources[transients[i]];
+    auto &physical = physicalImages[i];
+    matches = resource.format == physical.format &&
+              resource.extent == physical.extent &&
+              resource.samples == physical.samples &&
+              resource.usage == physical.usage &&
+              resource.firstPass == physical.firstPass &&
+              resource.lastPass == physical.lastPass;
+  }
+  if (!matches) {
+    retirePhysicalImages();
+    createPhysicalImages(transients);
+  }
+
+  for (uint32_t i = 0; i < transients.size(); i++) {
+    auto &resource = resources[transients[i]];
+    resource.physical = i;
+    resource.image = physicalImages[i].image;
+    resource.view = physicalImages[i].view;
+  }
+
+  stats.transientImageCount = static_cast<uint32_t>(physicalImages.size());
+  for (auto &physical : physicalImages) {
+    stats.unaliasedBytes += physical.size;
+  }
+  for (auto &slot : memorySlots) {
+    if (!slot.lazy) {
+      stats.transientBytes += slot.requirements.size;
+    }
+  }
+}
+
+void XveRenderGraph::createPhysicalImages(
+    const std::vector<uint32_t> &transients) {
+  auto hasLazyMemory =
+      findMemoryType(~0u, vk::MemoryPropertyFlagBits::eLazilyAllocated)
+          .has_value();
+  auto attachmentUsage = vk::ImageUsageFlagBits::eColorAttachment |
+                         vk::ImageUsageFlagBits::eDepthStencilAttachment;
+
+  physicalImages.resize(transients.size());
+  std::vector<vk::MemoryRequirements> requirements(transients.size());
+  for (size_t i = 0; i < transients.size(); i++) {
+    auto &resource = resources[transients[i]];
+    auto &physical = physicalImages[i];
+    physical = PhysicalImage{resource.format,    resource.extent,
+                             resource.samples,   resource.usage,
+                             resource.firstPass, resource.lastPass,
+                             nullptr,            nullptr,
+                             0,                  0};
+
+    // Images that are only ever attachments never need to leave tile
+    // memory on tilers, so they can live in lazily allocated memory.
+    auto usage = resource.usage;
+    if (hasLazyMemory && !(usage & ~attachmentUsage)) {
+      usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+    }
+
+    try {
+      physical.image = device.getDevice().createImage(vk::ImageCreateInfo{
+          vk::ImageCreateFlags(),
+          vk::ImageType::e2D,
+          resource.format,
+          vk::Extent3D{resource.extent.width, resource.extent.height, 1},
+          1,
+          1,
+          resource.samples,
+          vk::ImageTiling::eOptimal,
+          usage,
+          vk::SharingMode::eExclusive,
+          {},
+          {},
+          vk::ImageLayout::eUndefined,
+      });
+    } catch (const vk::SystemError &e) {
+      throw std::runtime_error(std::format(
+          "Failed to create transient image {}. Error: {}", resource.name,
+          e.what()));
+    }
+    requirements[i] = device.getDevice().getImageMemoryRequirements(
+        physical.image);
+    physical.size = requirements[i].size;
+  }
+
+  // Greedy interval placement in order of first use: each image takes the
+  // first slot whose occupants are all done with it by then.
+  std::vector<uint32_t> order(transients.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return physicalImages[a].firstPass < physicalImages[b].firstPass;
+  });
+
+  memorySlots.clear();
+  for (auto i : order) {
+    auto &physical = physicalImages[i];
+    auto &required = requirements[i];
+
+    if (hasLazyMemory) {
+      auto lazyType = findMemoryType(
+          required.memoryTypeBits,
+          vk::MemoryPropertyFlagBits::eLazilyAllocated);
+      if (lazyType) {
+        physical.slot = static_cast<uint32_t>(memorySlots.size());
+        memorySlots.push_back(
+            MemorySlot{.requirements = required, .lazy = true});
+        memorySlots.back().occupants.push_back(i);
+        memorySlots.back().allocation = device.getAllocator().allocate(
+            required, *lazyType, XveMemoryAllocator::ResourceKind::Optimal,
+            XveMemoryCategory::Attachments);
+        continue;
+      }
+    }
+
+    auto slotIt = std::find_if(
+        memorySlots.begin(), memorySlots.end(),
+        [&](const MemorySlot &slot) {
+          return !slot.lazy && slot.lastPass < physical.firstPass &&
+                 findMemoryType(slot.requirements.memoryTypeBits &
+                                    required.memoryTypeBits,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal);
+        });
+    if (slotIt == memorySlots.end()) {
+      memorySlots.push_back(MemorySlot{.requirements = required});
+      slotIt = std::prev(memorySlots.end());
+    } else {
+      slotIt->requirements.size =
+          std::max(slotIt->requirements.size, required.size);
+      slotIt->requirements.alignment =
+          std::max(slotIt->requirements.alignment, required.alignment);
+      slotIt->requirements.memoryTypeBits &= required.memoryTypeBits;
+    }
+    slotIt->lastPass = physical.lastPass;
+    slotIt->occupants.push_back(i);
+    physical.slot = static_cast<uint32_t>(slotIt - memorySlots.begin());
+  }
+
+  for (auto &slot : memorySlots) {
+    if (slot.lazy) {
+      continue;
+    }
+    slot.allocation = device.getAllocator().allocate(
+        slot.requirements,
+        device.findMemoryType(slot.requirements.memoryTypeBits,
+                              vk::MemoryPropertyFlagBits::eDeviceLocal),
+        XveMemoryAllocator::ResourceKind::Optimal,
+        XveMemoryCategory::Attachments);
+  }
+
+  try {
+    for (auto &physical : physicalImages) {
+      auto &allocation = memorySlots[physical.slot].allocation;
+      device.getDevice().bindImageMemory(physical.image, allocation.memory,
+                                         allocation.offset);
+      physical.view = device.getDevice().createImageView(
+          vk::ImageViewCreateInfo{
+              vk::ImageViewCreateFlags(),
+              physical.image,
+              vk::ImageViewType::e2D,
+              physical.format,
+              {},
+              {aspectFor(physical.format), 0, 1, 0, 1},
+          });
+    }
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to bind transient images. Error: {}", e.what()));
+  }
+
+  vk::DeviceSize placedBytes = 0;
+  vk::DeviceSize unaliasedBytes = 0;
+  for (auto &slot : memorySlots) {
+    placedBytes += slot.lazy ? 0 : slot.requirements.size;
+  }
+  for (auto &required : requirements) {
+    unaliasedBytes += required.size;
+  }
+  log(LogLevel::Info,
+      "Placed {} transient images in {} memory slots: {} KiB, {} KiB "
+      "without aliasing",
+      physicalImages.size(), memorySlots.size(), placedBytes / 1024,
+      unaliasedBytes / 1024);
+}
+
+void XveRenderGraph::retirePhysicalImages() {
+  if (physicalImages.empty() && memorySlots.empty()) {
+    return;
+  }
+
+  // Frames up to the previous one may still be reading this memory.
+  auto retireValue = currentFrame == 0 ? 0 : currentFrame - 1;
+  retiredMemory.push(retireValue, [&device = device,
+                                   images = std::move(physicalImages),
+                                   slots = std::move(memorySlots)]() mutable {
+    for (auto &physical : images) {
+      device.getDevice().destroyImageView(physical.view);
+      device.getDevice().destroyImage(physical.image);
+    }
+    for (auto &slot : slots) {
+      device.getAllocator().free(slot.allocation);
+    }
+  });
+  physicalImages.clear();
+  memorySlots.clear();
+}
+
+void XveRenderGraph::computeBarriers() {
+  std::vector<AccessState> states(resources.size());
+  std::vector<bool> started(resources.size());
+  std::vector<uint32_t> physicalToResource(physicalImages.size());
+  for (uint32_t i = 0; i < resources.size(); i++) {
+    if (resources[i].physical != UINT32_MAX) {
+      physicalToResource[resources[i].physical] = i;
+    }
+  }
+
+  // A transient's memory was last touched by the previous occupant of its
+  // slot, or, for the first occupant, by the last one of the previous frame.
+  auto initialState = [&](const Resource &resource) {
+    if (resource.imported) {
+      return resource.initialState;
+    }
+    auto &slot = memorySlots[physicalImages[resource.physical].slot];
+    auto position = std::find(slot.occupants.begin(), slot.occupants.end(),
+                              resource.physical) -
+                    slot.occupants.begin();
+    auto previous = position > 0
+                        ? states[physicalToResource[slot.occupants[position -
+                                                                   1]]]
+                        : slot.endState;
+    return AccessState{previous.stages, previous.writeAccess,
+                       vk::ImageLayout::eUndefined};
+  };
+
+  auto makeBarrier = [this](const Resource &resource,
+                            const AccessState &state,
+                            vk::PipelineStageFlags2 dstStages,
+                            vk::AccessFlags2 dstAccess,
+                            vk::ImageLayout newLayout) {
+    return vk::ImageMemoryBarrier2{
+        state.stages,
+        state.writeAccess,
+        dstStages,
+        dstAccess,
+        state.layout,
+        newLayout,
+        vk::QueueFamilyIgnored,
+        vk::QueueFamilyIgnored,
+        resource.image,
+        {aspectFor(resource.format), 0, 1, 0, 1},
+    };
+  };
+
+  for (uint32_t i = 0; i < passes.size(); i++) {
+    auto &pass = passes[i];
+    pass.barriers.clear();
+    if (!pass.live) {
+      continue;
+    }
+
+    for (auto &use : pass.uses) {
+      auto &resource = resources[use.image];
+      auto &state = states[use.image];
+      if (!started[use.image]) {
+        state = initialState(resource);
+        started[use.image] = true;
+      }
+
+      auto target = usageInfo(use.usage);
+      std::optional<Attachment> *attachment = nullptr;
+      if (use.usage == XveImageUsage::ColorAttachment) {
+        attachment = &pass.color;
+      } else if (use.usage == XveImageUsage::DepthAttachment) {
+        attachment = &pass.depth;
+      }
+      // A resolve target is overwritten entirely.
+      auto discards = attachment && *attachment &&
+                      (*attachment)->resolve == use.image;
+      if (attachment && *attachment && (*attachment)->image == use.image) {
+        auto &info = **attachment;
+        info.loadOp = info.clear ? vk::AttachmentLoadOp::eClear
+                      : state.layout != vk::ImageLayout::eUndefined
+                          ? vk::AttachmentLoadOp::eLoad
+                          : vk::AttachmentLoadOp::eDontCare;
+        info.storeOp = !resource.imported && resource.lastPass == i
+                           ? vk::AttachmentStoreOp::eDontCare
+                           : vk::AttachmentStoreOp::eStore;
+        discards = info.loadOp != vk::AttachmentLoadOp::eLoad;
+      }
+
+      // Read-after-read in the same layout needs nothing; later writers
+      // just have to wait for every reader.
+      auto hazard = state.layout != target.layout || state.writeAccess ||
+                    (use.write && state.stages);
+      if (!hazard) {
+        state.stages |= target.stages;
+        continue;
+      }
+
+      if (discards) {
+        state.layout = vk::ImageLayout::eUndefined;
+      }
+      pass.barriers.push_back(makeBarrier(resource, state, target.stages,
+                                          target.access, target.layout));
+      state = AccessState{target.stages,
+                          use.write ? target.access & WRITE_ACCESS
+                                    : vk::AccessFlags2{},
+                          target.layout};
+    }
+    stats.barrierCount += static_cast<uint32_t>(pass.barriers.size());
+  }
+
+  // Imported images leave in their final layout. Presentation waits on the
+  // submission's semaphore; anything else reads in a later submission.
+  for (uint32_t i = 0; i < resources.size(); i++) {
+    auto &resource = resources[i];
+    if (!resource.imported) {
+      continue;
+    }
+    auto state = started[i] ? states[i] : resource.initialState;
+    if (state.layout == resource.finalLayout && !state.writeAccess) {
+      continue;
+    }
+    auto presenting = resource.finalLayout == vk::ImageLayout::ePresentSrcKHR;
+    finalBarriers.push_back(makeBarrier(
+        resource, state,
+        presenting ? vk::PipelineStageFlagBits2::eNone
+                   : vk::PipelineStageFlagBits2::eAllCommands,
+        presenting ? vk::AccessFlags2{} : vk::AccessFlagBits2::eMemoryRead,
+        resource.finalLayout));
+  }
+  stats.barrierCount += static_cast<uint32_t>(finalBarriers.size());
+
+  for (auto &slot : memorySlots) {
+    slot.endState = states[physicalToResource[slot.occupants.back()]];
+  }
+}
+
+void XveRenderGraph::execute(vk::CommandBuffer commandBuffer) {
+  auto barrier = [commandBuffer](
+                     const std::vector<vk::ImageMemoryBarrier2> &barriers) {
+    if (barriers.empty()) {
+      return;
+    }
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{
+        vk::DependencyFlags(), 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data()});
+  };
+
+  auto attachmentInfo = [this](const Attachment &attachment,
+                               vk::ImageLayout layout) {
+    return vk::RenderingAttachmentInfo{
+        resources[attachment.image].view,
+        layout,
+        attachment.resolve ? vk::ResolveModeFlagBits::eAverage
+                           : vk::ResolveModeFlagBits::eNone,
+        attachment.resolve ? resources[*attachment.resolve].view : nullptr,
+        attachment.resolve ? layout : vk::ImageLayout::eUndefined,
+        attachment.loadOp,
+        attachment.storeOp,
+        attachment.clearValue,
+    };
+  };
+
+  for (auto &pass : passes) {
+    if (!pass.live) {
+      continue;
+    }
+    barrier(pass.barriers);
+
+    std::optional<XveProfiler::GpuScope> scope;
+    if (profiler) {
+      scope.emplace(*profiler, commandBuffer, pass.name);
+    }
+
+    auto rendering = pass.color || pass.depth;
+    if (rendering) {
+      vk::RenderingAttachmentInfo colorInfo;
+      vk::RenderingAttachmentInfo depthInfo;
+      if (pass.color) {
+        colorInfo = attachmentInfo(*pass.color,
+                                   vk::ImageLayout::eColorAttachmentOptimal);
+      }
+      if (pass.depth) {
+        depthInfo = attachmentInfo(
+            *pass.depth, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+      }
+      auto extent = resources[pass.color ? pass.color->image
+                                         : pass.depth->image]
+                        .extent;
+      commandBuffer.beginRendering(vk::RenderingInfo{
+          pass.secondaryCommandBuffers
+              ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers
+              : vk::RenderingFlags(),
+          vk::Rect2D{vk::Offset2D{0, 0}, extent},
+          1,
+          0,
+          pass.color ? 1u : 0u,
+          pass.color ? &colorInfo : nullptr,
+          pass.depth ? &depthInfo : nullptr,
+      });
+    }
+
+    pass.execute(commandBuffer);
+
+    if (rendering) {
+      commandBuffer.endRendering();
+    }
+  }
+
+  barrier(finalBarriers);
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_deletion_queue.hpp"
+#include "xve_device.hpp"
+#include "xve_profiler.hpp"
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// How a pass uses an image, which fixes the layout, stages and access the
+/// graph synchronizes it with.
+enum class XveImageUsage {
+  ColorAttachment,
+  DepthAttachment,
+  SampledFragment,
+  SampledCompute,
+  TransferSrc,
+  TransferDst,
+};
+
+struct XveRenderGraphStats {
+  uint32_t passCount = 0;
+  uint32_t culledPassCount = 0;
+  uint32_t barrierCount = 0;
+  uint32_t transientImageCount = 0;
+  /// Memory backing transient images after aliasing, and what they would
+  /// take without it. Lazily allocated images count as zero.
+  vk::DeviceSize transientBytes = 0;
+  vk::DeviceSize unaliasedBytes = 0;
+};
+
+/// Describes a frame as passes that declare the images they read and write,
+/// then records it with the barriers in between worked out automatically.
+/// The graph is rebuilt every frame: beginFrame(), import and create images,
+/// addPass() for each pass, compile(), execute().
+///
+/// compile() drops passes whose output nobody reads, places transient images
+/// so that those with disjoint lifetimes share memory (or uses lazily
+/// allocated memory for attachment-only images where the device has it),
+/// and emits a barrier only where a layout changes or a write is involved.
+/// Passes with attachments are wrapped in dynamic rendering, so the device
+/// must support it.
+class XveRenderGraph : Logger {
+public:
+  using ResourceId = uint32_t;
+
+  class PassBuilder {
+  public:
+    /// Clears the attachment when `clear` is given, otherwise loads it (or
+    /// leaves it undefined when nothing wrote it earlier in the frame). A
+    /// multisampled attachment can be averaged into `resolve` at the end.
+    void setColorAttachment(
+        ResourceId image,
+        std::optional<vk::ClearColorValue> clear = std::nullopt,
+        std::optional<ResourceId> resolve = std::nullopt);
+    void setDepthAttachment(
+        ResourceId image,
+        std::optional<vk::ClearDepthStencilValue> clear = std::nullopt);
+    void read(ResourceId image, XveImageUsage usage);
+    void write(ResourceId image, XveImageUsage usage);
+    /// Keeps the pass even though no image it writes is read, e.g. when it
+    /// writes buffers the graph doesn't track.
+    void setSideEffects();
+    /// The pass executes secondary command buffers inside its rendering.
+    void useSecondaryCommandBuffers();
+
+  private:
+    friend class XveRenderGraph;
+    PassBuilder(XveRenderGraph &graphRef, uint32_t passIndex)
+        : graph(graphRef), pass(passIndex) {}
+
+    XveRenderGraph &graph;
+    uint32_t pass;
+  };
+
+  using SetupFunction = std::function<void(PassBuilder &)>;
+  using ExecuteFunction = std::function<void(vk::CommandBuffer)>;
+
+  XveRenderGraph(XveDevice &deviceRef, uint32_t framesInFlight);
+  ~XveRenderGraph();
+
+  XveRenderGraph(const XveRenderGraph &) = delete;
+  XveRenderGraph &operator=(const XveRenderGraph &) = delete;
+
+  /// Clears the previous frame's passes and images. `frame` counts up from
+  /// 0 and the caller must have waited for its frame slot, so transient
+  /// memory that compile() replaced framesInFlight frames ago can be freed.
+  void beginFrame(uint64_t frame);
+
+  /// An image owned elsewhere (e.g. a swapchain image). It enters the frame
+  /// in `initialLayout` after `initialStages` and is left in `finalLayout`.
+  /// Imported images are the graph's outputs.
+  ResourceId importImage(
+      const std::string &name, vk::Image image, vk::ImageView view,
+      vk::Format format, vk::Extent2D extent, vk::ImageLayout initialLayout,
+      vk::ImageLayout finalLayout,
+      vk::PipelineStageFlags2 initialStages =
+          vk::PipelineStageFlagBits2::eAllCommands);
+  /// An image that lives only within the frame; its usage flags come from
+  /// the passes that use it.
+  ResourceId
+  createImage(const std::string &name, vk::Format format, vk::Extent2D extent,
+              vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1);
+
+  /// `name` labels the pass's GPU scope, so it must outlive the profiler's
+  /// results; pass a literal.
+  void addPass(const char *name, const SetupFunction &setup,
+               ExecuteFunction execute);
+
+  void compile();
+  void execute(vk::CommandBuffer commandBuffer);
+
+  const XveRenderGraphStats &getStats() const { return stats; }
+
+  /// Times each pass as a GPU scope, excluding the barriers before it.
+  void setProfiler(XveProfiler *profiler_) { profiler = profiler_; }
+
+private:
+  struct ImageUse {
+    ResourceId image;
+    XveImageUsage usage;
+    bool write;
+  };
+
+  struct Attachment {
+    ResourceId image;
+    bool clear = false;
+    std::optional<ResourceId> resolve;
+    vk::ClearValue clearValue;
+    vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eDontCare;
+    vk::AttachmentStoreOp storeOp = vk::AttachmentStoreOp::eStore;
+  };
+
+  struct Pass {
+    const char *name;
+    ExecuteFunction execute;
+    std::vector<ImageUse> uses;
+    std::optional<Attachment> color;
+    std::optional<Attachment> depth;
+    bool sideEffects = false;
+    bool secondaryCommandBuffers = false;
+    bool live = false;
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+  };
+
+  /// What has touched an image since its last barrier.
+  struct AccessState {
+    vk::PipelineStageFlags2 stages;
+    vk::AccessFlags2 writeAccess;
+    vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+  };
+
+  struct Resource {
+    std::string name;
+    bool imported = false;
+    vk::Image image;
+    vk::ImageView view;
+    vk::Format format;
+    vk::Extent2D extent;
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+    vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+    AccessState initialState;
+    vk::ImageUsageFlags usage;
+    // Live passes only; firstPass > lastPass when no live pass uses it.
+    uint32_t firstPass = UINT32_MAX;
+    uint32_t lastPass = 0;
+    uint32_t physical = UINT32_MAX;
+  };
+
+  /// Memory shared by transient images whose lifetimes don't overlap.
+  struct MemorySlot {
+    XveAllocation allocation;
+    vk::MemoryRequirements requirements;
+    bool lazy = false;
+    uint32_t lastPass = 0;
+    // Occupants in pass order; each waits on the one before, the first on
+    // the last from the previous frame.
+    std::vector<uint32_t> occupants;
+    AccessState endState;
+  };
+
+  struct PhysicalImage {
+    vk::Format format;
+    vk::Extent2D extent;
+    vk::SampleCountFlagBits samples;
+    vk::ImageUsageFlags usage;
+    uint32_t firstPass;
+    uint32_t lastPass;
+    vk::Image image;
+    vk::ImageView view;
+    vk::DeviceSize size;
+    uint32_t slot;
+  };
+
+  XveDevice &device;
+  uint32_t framesInFlight;
+  uint64_t currentFrame = 0;
+  XveProfiler *profiler = nullptr;
+  XveDeletionQueue retiredMemory;
+
+  std::vector<Pass> passes;
+  std::vector<Resource> resources;
+  std::vector<vk::ImageMemoryBarrier2> finalBarriers;
+
+  std::vector<PhysicalImage> physicalImages;
+  std::vector<MemorySlot> memorySlots;
+
+  XveRenderGraphStats stats;
+
+  void cullPasses();
+  void placeTransients();
+  void createPhysicalImages(const std::vector<uint32_t> &transients);
+  void retirePhysicalImages();
+  void computeBarriers();
+  std::optional<uint32_t>
+  findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) const;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "xve_model.hpp"
+#include "xve_pipeline_manager.hpp"
+
+struct XveRenderObject {
+  XveModel *model;
+  XvePipelineHandle pipeline;
+  glm::mat4 transform{1.0f};
+  glm::vec4 color{1.0f};
+};
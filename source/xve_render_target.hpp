@@ -0,0 +1,67 @@
+#pragma once
+
+#include "xve_profiler.hpp"
+#include <cstdint>
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+/// Where XveApp renders a frame: the window's swapchain or offscreen images.
+/// Both hand out one framebuffer per image, compatible with getRenderPass(),
+/// and pace the CPU to framesInFlight frames ahead of the GPU. Targets created
+/// for dynamic rendering have neither, nor depth images: import the color
+/// image into an XveRenderGraph, which provides the depth buffer.
+class XveRenderTarget {
+public:
+  struct SyncStats {
+    uint64_t frameCount = 0;
+    double lastWaitMs = 0.0;
+    double totalWaitMs = 0.0;
+    double maxWaitMs = 0.0;
+  };
+
+  struct MemoryUsage {
+    /// Color images the target owns; a swapchain's belong to the driver.
+    vk::DeviceSize colorBytes = 0;
+    /// Depth and multisampled color as allocated. Zero with dynamic
+    /// rendering, where the render graph owns them.
+    vk::DeviceSize attachmentBytes = 0;
+    /// What one set per target image would take: a measured set times the
+    /// image count. Only above attachmentBytes when there are more images
+    /// than frames in flight.
+    vk::DeviceSize perImageAttachmentBytes = 0;
+  };
+
+  virtual ~XveRenderTarget() = default;
+
+  virtual vk::Extent2D getExtent() const = 0;
+  virtual vk::RenderPass getRenderPass() const = 0;
+  /// For rendering into `imageIndex` from frame slot `frameIndex`, which
+  /// picks the depth and MSAA color set where those are per frame slot.
+  virtual vk::Framebuffer getFramebuffer(size_t imageIndex,
+                                         size_t frameIndex) const = 0;
+  virtual bool usesDynamicRendering() const = 0;
+  virtual vk::Format getColorFormat() const = 0;
+  virtual vk::Format getDepthFormat() const = 0;
+  /// Of the color and depth attachments drawn into; above e1 they are
+  /// resolved into the color image.
+  virtual vk::SampleCountFlagBits getSampleCount() const = 0;
+  virtual vk::Image getColorImage(size_t imageIndex) const = 0;
+  virtual vk::ImageView getColorImageView(size_t imageIndex) const = 0;
+  /// The layout color images are left in at the end of a frame.
+  virtual vk::ImageLayout getFinalColorLayout() const = 0;
+  virtual uint32_t getFramesInFlight() const = 0;
+  virtual uint32_t getCurrentFrame() const = 0;
+  virtual const SyncStats &getSyncStats() const = 0;
+  virtual MemoryUsage getMemoryUsage() const = 0;
+  /// One-line summary of the target's configuration for logs.
+  virtual std::string describe() const = 0;
+
+  /// Times the frame wait, acquire, submit and present as CPU scopes.
+  virtual void setProfiler(XveProfiler *profiler) = 0;
+
+  /// Waits for the current frame slot, then picks the image to render into.
+  virtual vk::Result acquireNextImage(uint32_t *imageIndex) = 0;
+  virtual vk::Result submitCommandBuffers(const vk::CommandBuffer *buffers,
+                                          uint32_t *imageIndex) = 0;
+  virtual void recreate(vk::Extent2D extent) = 0;
+};
@@ -1,41 +1,147 @@
 #include "xve_swap_chain.hpp"
 #include "VkBootstrap.h"
+#include <algorithm>
+#include <chrono>
 #include <limits>
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan_enums.hpp>
 
-XveSwapChain::XveSwapChain(XveDevice &deviceRef, vk::Extent2D windowExtent)
-    : device(deviceRef), swapChainExtent(windowExtent) {
-  createSwapChain();
+XveSwapChain::XveSwapChain(XveDevice &deviceRef, vk::Extent2D windowExtent,
+                           const XveSwapChainConfig &config)
+    : framesInFlight(config.framesInFlight), syncMode(config.syncMode),
+      desiredPresentMode(config.presentMode),
+      desiredImageCount(config.desiredImageCount),
+      dynamicRendering(config.dynamicRendering), device(deviceRef),
+      frameAttachments(deviceRef, config.attachments),
+      swapChainExtent(windowExtent) {
+  if (syncMode == XveSyncMode::TimelineSemaphore &&
+      !device.getFeatures().timelineSemaphore) {
+    log(LogLevel::Warning,
+        "Timeline semaphores unsupported, falling back to fences");
+    syncMode = XveSyncMode::Fences;
+  }
+  if (dynamicRendering && !device.getFeatures().dynamicRendering) {
+    log(LogLevel::Warning,
+        "Dynamic rendering unsupported, falling back to a render pass");
+    dynamicRendering = false;
+  }
+
+  createSwapChain(windowExtent);
   createImageViews();
-  createRenderPass();
-  createDepthResources();
-  createFramebuffers();
+  if (!dynamicRendering) {
+    createRenderPass();
+  }
   createSyncObjects();
 }
 
-void XveSwapChain::createSwapChain() {
+std::string XveSwapChain::describe() const {
+  return std::format(
+      "swapchain {}x{}, {} images, {}, {} sync, {}{}{}", swapChainExtent.width,
+      swapChainExtent.height, imageCount(), vk::to_string(getPresentMode()),
+      syncMode == XveSyncMode::TimelineSemaphore ? "timeline" : "fence",
+      vk::to_string(getDepthFormat()),
+      frameAttachments.isMultisampled()
+          ? std::format(", {}x MSAA", vk::to_string(getSampleCount()))
+          : std::string{},
+      dynamicRendering ? ", dynamic rendering" : "");
+}
+
+void XveSwapChain::createSwapChain(vk::Extent2D extent) {
   vkb::SwapchainBuilder swapChainBuilder{device.getBDevice()};
-  bSwapChain = swapChainBuilder.set_old_swapchain(nullptr).build().value();
+  swapChainBuilder.set_old_swapchain(bSwapChain)
+      .set_desired_extent(extent.width, extent.height)
+      .set_desired_present_mode(
+          static_cast<VkPresentModeKHR>(desiredPresentMode))
+      .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+  if (desiredImageCount != 0) {
+    swapChainBuilder.set_desired_min_image_count(desiredImageCount);
+  }
+  auto bNewSwapChain = swapChainBuilder.build();
+  if (!bNewSwapChain) {
+    throw std::runtime_error(std::format("Failed to create swapchain: {}",
+                                         bNewSwapChain.error().message()));
+  }
+  bSwapChain = bNewSwapChain.value();
+  swapChainExtent = bSwapChain.extent;
+
+  swapChainImages.clear();
   auto bSwapChainImages = bSwapChain.get_images().value();
   for (auto image : bSwapChainImages) {
     swapChainImages.push_back(image);
   }
-  log(LogLevel::Info, "{}", bSwapChain.get_images().value().size());
+  log(LogLevel::Info, "Swapchain {}x{} with {} images, present mode {}",
+      swapChainExtent.width, swapChainExtent.height, swapChainImages.size(),
+      vk::to_string(getPresentMode()));
+  if (getPresentMode() != desiredPresentMode) {
+    log(LogLevel::Warning, "Present mode {} unavailable",
+        vk::to_string(desiredPresentMode));
+  }
 }
 
 void XveSwapChain::createImageViews() {
+  swapChainImageViews.clear();
   auto cSwapChainImageViews = bSwapChain.get_image_views().value();
   for (auto &iview : cSwapChainImageViews) {
     swapChainImageViews.push_back(iview);
   }
 }
 
+void XveSwapChain::retireSwapChainResources() {
+  deferDestroy([&device = device, oldSwapChain = bSwapChain,
+                imageViews = std::move(swapChainImageViews),
+                framebuffers = std::move(swapChainFramebuffers),
+                attachments = frameAttachments]() mutable {
+    for (auto framebuffer : framebuffers) {
+      device.getDevice().destroyFramebuffer(framebuffer);
+    }
+    attachments.destroy();
+    for (auto imageView : imageViews) {
+      device.getDevice().destroyImageView(imageView);
+    }
+    vkb::destroy_swapchain(oldSwapChain);
+  });
+
+  swapChainImageViews.clear();
+  swapChainFramebuffers.clear();
+  frameAttachments.release();
+}
+
+void XveSwapChain::recreate(vk::Extent2D extent) {
+  // The retired swapchain stays alive until its frames finish, so it can
+  // still be handed to the builder as oldSwapchain.
+  retireSwapChainResources();
+  createSwapChain(extent);
+  createImageViews();
+  framebuffersDirty = true;
+
+  if (syncMode == XveSyncMode::TimelineSemaphore) {
+    imageTimelineValues.assign(imageCount(), 0);
+  } else {
+    imagesInFlight.assign(imageCount(), VK_NULL_HANDLE);
+  }
+}
+
+void XveSwapChain::ensureFramebuffers() {
+  if (!framebuffersDirty) {
+    return;
+  }
+  // With dynamic rendering the frame's render graph owns the depth buffer
+  // and takes the color views directly at record time.
+  if (!dynamicRendering) {
+    createFrameAttachments();
+    createFramebuffers();
+  }
+  framebuffersDirty = false;
+}
+
 void XveSwapChain::createRenderPass() {
+  auto samples = frameAttachments.getSampleCount();
+  auto multisampled = frameAttachments.isMultisampled();
+
   auto depthAttachment = vk::AttachmentDescription{
       vk::AttachmentDescriptionFlags(),
-      findDepthFormat(),
-      vk::SampleCountFlagBits::e1,
+      frameAttachments.getDepthFormat(),
+      samples,
       vk::AttachmentLoadOp::eClear,
       vk::AttachmentStoreOp::eDontCare,
       vk::AttachmentLoadOp::eDontCare,
@@ -49,15 +155,38 @@ void XveSwapChain::createRenderPass() {
       vk::ImageLayout::eDepthStencilAttachmentOptimal,
   };
 
+  // With MSAA the swapchain image only receives the resolve, so its old
+  // contents are never loaded.
   auto colorAttachment = vk::AttachmentDescription{
-      vk::AttachmentDescriptionFlags(), (vk::Format)bSwapChain.image_format,
-      vk::SampleCountFlagBits::e1,      vk::AttachmentLoadOp::eClear,
-      vk::AttachmentStoreOp::eDontCare, vk::AttachmentLoadOp::eDontCare,
-      vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined,
+      vk::AttachmentDescriptionFlags(),
+      getColorFormat(),
+      vk::SampleCountFlagBits::e1,
+      multisampled ? vk::AttachmentLoadOp::eDontCare
+                   : vk::AttachmentLoadOp::eClear,
+      vk::AttachmentStoreOp::eStore,
+      vk::AttachmentLoadOp::eDontCare,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined,
       vk::ImageLayout::ePresentSrcKHR,
   };
 
+  auto multisampledAttachment = vk::AttachmentDescription{
+      vk::AttachmentDescriptionFlags(),
+      getColorFormat(),
+      samples,
+      vk::AttachmentLoadOp::eClear,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::AttachmentLoadOp::eDontCare,
+      vk::AttachmentStoreOp::eDontCare,
+      vk::ImageLayout::eUndefined,
+      vk::ImageLayout::eColorAttachmentOptimal,
+  };
+
   auto colorAttachmentRef = vk::AttachmentReference{
+      multisampled ? 2u : 0u,
+      vk::ImageLayout::eColorAttachmentOptimal,
+  };
+  auto resolveAttachmentRef = vk::AttachmentReference{
       0,
       vk::ImageLayout::eColorAttachmentOptimal,
   };
@@ -69,7 +198,7 @@ void XveSwapChain::createRenderPass() {
       {},
       1,
       &colorAttachmentRef,
-      {},
+      multisampled ? &resolveAttachmentRef : nullptr,
       &depthAttachmentRef,
   };
 
@@ -85,8 +214,11 @@ void XveSwapChain::createRenderPass() {
           vk::AccessFlagBits::eDepthStencilAttachmentWrite,
   };
 
-  std::array<vk::AttachmentDescription, 2> attachments = {colorAttachment,
-                                                          depthAttachment};
+  std::vector<vk::AttachmentDescription> attachments = {colorAttachment,
+                                                        depthAttachment};
+  if (multisampled) {
+    attachments.push_back(multisampledAttachment);
+  }
 
   auto createInfo = vk::RenderPassCreateInfo{
       vk::RenderPassCreateFlags(),
@@ -108,22 +240,67 @@ void XveSwapChain::createRenderPass() {
 
 /// Hard zone):
 
+void XveSwapChain::recordWait(double waitMs) {
+  syncStats.lastWaitMs = waitMs;
+  syncStats.totalWaitMs += waitMs;
+  syncStats.maxWaitMs = std::max(syncStats.maxWaitMs, waitMs);
+}
+
+void XveSwapChain::waitForTimeline(uint64_t value) {
+  // Cheap query first: in the common case the GPU is already past `value`
+  // and no wait call is needed at all.
+  if (device.getDevice().getSemaphoreCounterValue(frameTimeline) >= value) {
+    return;
+  }
+
+  auto waitInfo = vk::SemaphoreWaitInfo{
+      vk::SemaphoreWaitFlags(), 1, &frameTimeline, &value,
+  };
+  device.getDevice().waitSemaphores(waitInfo,
+                                    std::numeric_limits<uint64_t>::max());
+}
+
 vk::Result XveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  device.getDevice().waitForFences(1, &inFlightFences[currentFrame], vk::True,
-                                   std::numeric_limits<uint64_t>::max());
-  return device.getDevice().acquireNextImageKHR(
+  auto waitStart = std::chrono::steady_clock::now();
+  if (syncMode == XveSyncMode::TimelineSemaphore) {
+    waitForTimeline(frameTimelineValues[currentFrame]);
+  } else {
+    device.getDevice().waitForFences(1, &inFlightFences[currentFrame],
+                                     vk::True,
+                                     std::numeric_limits<uint64_t>::max());
+  }
+  std::chrono::duration<double, std::milli> waited =
+      std::chrono::steady_clock::now() - waitStart;
+  recordWait(waited.count());
+  if (profiler) {
+    profiler->recordCpuScope("frame wait", waitStart,
+                             std::chrono::steady_clock::now());
+  }
+
+  // This slot's previous frame is done, and with it every frame submitted
+  // framesInFlight frames ago or earlier.
+  if (submittedFrames + 1 >= framesInFlight) {
+    deletionQueue.flush(submittedFrames + 1 - framesInFlight);
+  }
+
+  auto acquireStart = std::chrono::steady_clock::now();
+  auto result = device.getDevice().acquireNextImageKHR(
       bSwapChain.swapchain, std::numeric_limits<uint64_t>::max(),
       imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, imageIndex);
+  if (profiler) {
+    profiler->recordCpuScope("acquire", acquireStart,
+                             std::chrono::steady_clock::now());
+  }
+
+  if (result == vk::Result::eSuccess || result == vk::Result::eSuboptimalKHR) {
+    ensureFramebuffers();
+  }
+  return result;
 }
 
 vk::Result XveSwapChain::submitCommandBuffers(const vk::CommandBuffer *buffers,
                                               uint32_t *imageIndex) {
-  if (imagesInFlight[*imageIndex] != nullptr) {
-    device.getDevice().waitForFences(1, &imagesInFlight[*imageIndex], VK_TRUE,
-                                     UINT64_MAX);
-  }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
-
+  auto submitStart = std::chrono::steady_clock::now();
   vk::SubmitInfo submitInfo = {};
 
   vk::Semaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
@@ -136,19 +313,53 @@ vk::Result XveSwapChain::submitCommandBuffers(const vk::CommandBuffer *buffers,
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = buffers;
 
-  vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+  if (syncMode == XveSyncMode::TimelineSemaphore) {
+    // The image may still be in use by a frame from another slot when
+    // images outnumber frames in flight.
+    waitForTimeline(imageTimelineValues[*imageIndex]);
+
+    auto signalValue = ++frameTimelineValue;
+    frameTimelineValues[currentFrame] = signalValue;
+    imageTimelineValues[*imageIndex] = signalValue;
+
+    vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame],
+                                        frameTimeline};
+    // Binary semaphores ignore their value entry.
+    uint64_t signalValues[] = {0, signalValue};
+    auto timelineInfo = vk::TimelineSemaphoreSubmitInfo{
+        0, nullptr, 2, signalValues,
+    };
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = 2;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    device.getGraphicsQueue().submit(1, &submitInfo, nullptr);
+  } else {
+    if (imagesInFlight[*imageIndex] != nullptr) {
+      device.getDevice().waitForFences(1, &imagesInFlight[*imageIndex],
+                                       VK_TRUE, UINT64_MAX);
+    }
+    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+
+    vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = signalSemaphores;
 
-  device.getDevice().waitForFences(1, &inFlightFences[currentFrame], vk::True,
-                                   std::numeric_limits<uint64_t>::max());
-  device.getDevice().resetFences(1, &inFlightFences[currentFrame]);
-  device.getGraphicsQueue().submit(1, &submitInfo,
-                                   inFlightFences[currentFrame]);
+    // acquireNextImage already waited on this fence; only reset it here.
+    device.getDevice().resetFences(1, &inFlightFences[currentFrame]);
+    device.getGraphicsQueue().submit(1, &submitInfo,
+                                     inFlightFences[currentFrame]);
+  }
+  syncStats.frameCount++;
+  submittedFrames++;
+  if (profiler) {
+    profiler->recordCpuScope("submit", submitStart,
+                             std::chrono::steady_clock::now());
+  }
 
   vk::PresentInfoKHR presentInfo = {};
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
   vk::SwapchainKHR swapChains[] = {bSwapChain.swapchain};
   presentInfo.swapchainCount = 1;
@@ -156,121 +367,110 @@ vk::Result XveSwapChain::submitCommandBuffers(const vk::CommandBuffer *buffers,
 
   presentInfo.pImageIndices = imageIndex;
 
+  auto presentStart = std::chrono::steady_clock::now();
   auto result = device.getPresentQueue().presentKHR(&presentInfo);
+  if (profiler) {
+    profiler->recordCpuScope("present", presentStart,
+                             std::chrono::steady_clock::now());
+  }
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % framesInFlight;
 
   return result;
 }
 
 /// Potential errors zone:
 
-void XveSwapChain::createDepthResources() {
-  vk::Format depthFormat = findDepthFormat();
-  vk::Extent2D swapChainExtent = getSwapChainExtent();
-
-  depthImages.resize(bSwapChain.image_count);
-  depthImageMemorys.resize(bSwapChain.image_count);
-  depthImageViews.resize(bSwapChain.image_count);
-
-  for (size_t i = 0; i < depthImages.size(); i++) {
-    auto imageInfo = vk::ImageCreateInfo{
-        vk::ImageCreateFlags(),
-        vk::ImageType::e2D,
-        depthFormat,
-        vk::Extent3D{swapChainExtent.width, swapChainExtent.height, 1},
-        1,
-        1,
-        vk::SampleCountFlagBits::e1,
-        vk::ImageTiling::eOptimal,
-        vk::ImageUsageFlagBits::eDepthStencilAttachment,
-        vk::SharingMode::eExclusive,
-        {},
-        {},
-        vk::ImageLayout::eUndefined,
-    };
-
-    try {
-      depthImages[i] = device.getDevice().createImage(imageInfo);
-    } catch (const vk::SystemError &e) {
-      throw std::runtime_error(
-          std::format("Failed to create image. Error: {}", e.what()));
-    }
-
-    auto memoryRequirements =
-        device.getDevice().getImageMemoryRequirements(depthImages[i]);
-
-    auto allocInfo = vk::MemoryAllocateInfo{
-        memoryRequirements.size,
-        device.findMemoryType(memoryRequirements.memoryTypeBits,
-                              vk::MemoryPropertyFlagBits::eDeviceLocal)};
-
-    try {
-      depthImageMemorys[i] = device.getDevice().allocateMemory(allocInfo);
-      device.getDevice().bindImageMemory(depthImages[i], depthImageMemorys[i],
-                                         0);
-    } catch (const vk::SystemError &e) {
-      throw std::runtime_error(std::format(
-          "Failed to allocate or bind image memory. Error: {}", e.what()));
-    }
+void XveSwapChain::createFrameAttachments() {
+  // An image is only rendered to again once the frame that last used it has
+  // finished (submit waits for that), so per-image sets are safe as well;
+  // they are the cheaper choice unless images outnumber frames in flight.
+  attachmentsPerImage = imageCount() <= framesInFlight;
+  frameAttachments.create(swapChainExtent, getColorFormat(),
+                          attachmentsPerImage ? imageCount()
+                                              : framesInFlight);
+
+  auto usage = getMemoryUsage();
+  if (attachmentsPerImage) {
+    log(LogLevel::Info,
+        "Frame attachments: {} KiB, one set per swapchain image ({} images "
+        "for {} frames in flight, so per-frame sets would save nothing)",
+        usage.attachmentBytes / 1024, imageCount(), framesInFlight);
+  } else {
+    log(LogLevel::Info,
+        "Frame attachments: {} KiB for {} frames in flight, saving {} KiB "
+        "over one set per swapchain image",
+        usage.attachmentBytes / 1024, framesInFlight,
+        (usage.perImageAttachmentBytes - usage.attachmentBytes) / 1024);
+  }
+}
 
-    auto viewInfo = vk::ImageViewCreateInfo{
-        vk::ImageViewCreateFlags(),
-        depthImages[i],
-        vk::ImageViewType::e2D,
-        depthFormat,
-        {},
-        {
-            vk::ImageAspectFlagBits::eDepth,
-            0,
-            1,
-            0,
-            1,
-        },
-    };
+void XveSwapChain::createFramebuffers() {
+  auto multisampled = frameAttachments.isMultisampled();
+  auto setsPerImage = attachmentsPerImage ? 1 : framesInFlight;
+  swapChainFramebuffers.resize(bSwapChain.image_count * setsPerImage);
 
-    try {
-      depthImageViews[i] = device.getDevice().createImageView(viewInfo);
-    } catch (const vk::SystemError &e) {
-      throw std::runtime_error(
-          std::format("Failed to create image view. Error: {}", e.what()));
+  for (size_t i = 0; i < bSwapChain.image_count; i++) {
+    for (size_t frame = 0; frame < setsPerImage; frame++) {
+      auto set = attachmentsPerImage ? i : frame;
+      std::vector<vk::ImageView> attachments = {
+          swapChainImageViews[i], frameAttachments.getDepthView(set)};
+      if (multisampled) {
+        attachments.push_back(frameAttachments.getColorView(set));
+      }
+
+      auto createInfo = vk::FramebufferCreateInfo{
+          vk::FramebufferCreateFlags(),
+          renderPass,
+          static_cast<uint32_t>(attachments.size()),
+          attachments.data(),
+          swapChainExtent.width,
+          swapChainExtent.height,
+          1,
+      };
+
+      try {
+        swapChainFramebuffers[i * setsPerImage + frame] =
+            device.getDevice().createFramebuffer(createInfo);
+      } catch (const vk::SystemError &e) {
+        throw std::runtime_error(
+            std::format("Failed to create framebuffer. Error: {}", e.what()));
+      }
     }
   }
 }
 
-void XveSwapChain::createFramebuffers() {
-  swapChainFramebuffers.resize(bSwapChain.image_count);
+XveRenderTarget::MemoryUsage XveSwapChain::getMemoryUsage() const {
+  return {
+      .attachmentBytes = frameAttachments.getMemoryBytes(),
+      .perImageAttachmentBytes =
+          frameAttachments.getSetMemoryBytes() * bSwapChain.image_count,
+  };
+}
 
-  for (size_t i = 0; i < bSwapChain.image_count; i++) {
-    std::array<vk::ImageView, 2> attachments = {swapChainImageViews[i],
-                                                depthImageViews[i]};
-
-    vk::Extent2D swapChainExtent = getSwapChainExtent();
-    auto createInfo = vk::FramebufferCreateInfo{
-        vk::FramebufferCreateFlags(),
-        renderPass,
-        static_cast<uint32_t>(attachments.size()),
-        attachments.data(),
-        swapChainExtent.width,
-        swapChainExtent.height,
-        1,
+void XveSwapChain::createSyncObjects() {
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  if (syncMode == XveSyncMode::TimelineSemaphore) {
+    frameTimelineValues.resize(framesInFlight, 0);
+    imageTimelineValues.resize(imageCount(), 0);
+
+    auto timelineTypeInfo =
+        vk::SemaphoreTypeCreateInfo{vk::SemaphoreType::eTimeline, 0};
+    auto timelineInfo = vk::SemaphoreCreateInfo{
+        vk::SemaphoreCreateFlags(),
+        &timelineTypeInfo,
     };
-
     try {
-      swapChainFramebuffers[i] =
-          device.getDevice().createFramebuffer(createInfo);
+      frameTimeline = device.getDevice().createSemaphore(timelineInfo);
     } catch (const vk::SystemError &e) {
-      throw std::runtime_error(
-          std::format("Failed to create framebuffer. Error: {}", e.what()));
+      throw std::runtime_error(std::format(
+          "Failed to create timeline semaphore. Error: {}", e.what()));
     }
+  } else {
+    inFlightFences.resize(framesInFlight);
+    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
   }
-}
-
-void XveSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
   auto semaphoreInfo = vk::SemaphoreCreateInfo{
       vk::SemaphoreCreateFlags(),
@@ -280,13 +480,15 @@ void XveSwapChain::createSyncObjects() {
       vk::FenceCreateFlagBits::eSignaled,
   };
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < framesInFlight; i++) {
     try {
       imageAvailableSemaphores[i] =
           device.getDevice().createSemaphore(semaphoreInfo);
       renderFinishedSemaphores[i] =
           device.getDevice().createSemaphore(semaphoreInfo);
-      inFlightFences[i] = device.getDevice().createFence(fenceInfo);
+      if (syncMode == XveSyncMode::Fences) {
+        inFlightFences[i] = device.getDevice().createFence(fenceInfo);
+      }
     } catch (const vk::SystemError &e) {
       throw std::runtime_error(std::format(
           "Failed to create Semaphore or Fence. Error: {}", e.what()));
@@ -295,6 +497,8 @@ void XveSwapChain::createSyncObjects() {
 }
 
 XveSwapChain::~XveSwapChain() {
+  deletionQueue.flushAll();
+
   for (auto imageView : swapChainImageViews) {
     device.getDevice().destroyImageView(imageView);
   }
@@ -305,20 +509,21 @@ XveSwapChain::~XveSwapChain() {
     bSwapChain.swapchain = nullptr;
   }
 
-  for (size_t i = 0; i < depthImages.size(); i++) {
-    device.getDevice().destroyImageView(depthImageViews[i]);
-    device.getDevice().destroyImage(depthImages[i]);
-    device.getDevice().freeMemory(depthImageMemorys[i]);
-  }
+  frameAttachments.destroy();
 
   for (auto framebuffer : swapChainFramebuffers) {
     device.getDevice().destroyFramebuffer(framebuffer);
   }
   device.getDevice().destroyRenderPass(renderPass);
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < framesInFlight; i++) {
     device.getDevice().destroySemaphore(renderFinishedSemaphores[i]);
     device.getDevice().destroySemaphore(imageAvailableSemaphores[i]);
-    device.getDevice().destroyFence(inFlightFences[i]);
+  }
+  for (auto fence : inFlightFences) {
+    device.getDevice().destroyFence(fence);
+  }
+  if (frameTimeline) {
+    device.getDevice().destroySemaphore(frameTimeline);
   }
 }
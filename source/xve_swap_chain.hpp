@@ -1,29 +1,67 @@
 #pragma once
 
 #include "logger.hpp"
+#include "xve_deletion_queue.hpp"
 #include "xve_device.hpp"
+#include "xve_frame_attachments.hpp"
+#include "xve_profiler.hpp"
+#include "xve_render_target.hpp"
 #include "xve_window.hpp"
 #include <VkBootstrap.h>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
-class XveSwapChain : Logger {
+enum class XveSyncMode {
+  /// One fence per frame in flight plus per-image fence tracking.
+  Fences,
+  /// A single Vulkan 1.2 timeline semaphore; each submission signals the
+  /// next value and the CPU only waits when it is framesInFlight ahead.
+  TimelineSemaphore,
+};
+
+struct XveSwapChainConfig {
+  uint32_t framesInFlight = 2;
+  XveSyncMode syncMode = XveSyncMode::Fences;
+  /// Falls back to FIFO, which every driver supports, when unavailable.
+  vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+  /// Minimum number of swapchain images; 0 keeps the vk-bootstrap default.
+  /// Fewer images mean less queued latency under FIFO.
+  uint32_t desiredImageCount = 0;
+  /// Skip the render pass, framebuffers and depth images and render through
+  /// an XveRenderGraph. Ignored when the device lacks dynamic rendering.
+  bool dynamicRendering = false;
+  XveAttachmentConfig attachments;
+};
+
+class XveSwapChain : public XveRenderTarget, Logger {
 private:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  uint32_t framesInFlight;
+  XveSyncMode syncMode;
+  vk::PresentModeKHR desiredPresentMode;
+  uint32_t desiredImageCount;
+  bool dynamicRendering;
 
   vkb::Swapchain bSwapChain;
 
   std::vector<vk::Framebuffer> swapChainFramebuffers;
   vk::RenderPass renderPass;
 
-  std::vector<vk::Image> depthImages;
-  std::vector<vk::DeviceMemory> depthImageMemorys;
-  std::vector<vk::ImageView> depthImageViews;
   std::vector<vk::Image> swapChainImages;
   std::vector<vk::ImageView> swapChainImageViews;
 
   XveDevice &device;
-  vk::Extent2D windowExtent;
+  // Depth (and MSAA color) per frame in flight, with one framebuffer per
+  // image and frame slot pair. That only saves memory with more images than
+  // frames in flight; otherwise there is one set and framebuffer per image.
+  XveFrameAttachments frameAttachments;
+  bool attachmentsPerImage = false;
+
+  // Attachments and framebuffers are rebuilt on first use after a
+  // recreate, so back-to-back resize events only pay for the swapchain.
+  bool framebuffersDirty = true;
+
+  uint64_t submittedFrames = 0;
+  XveDeletionQueue deletionQueue;
 
   std::vector<vk::Semaphore> imageAvailableSemaphores;
   std::vector<vk::Semaphore> renderFinishedSemaphores;
@@ -31,35 +69,87 @@ private:
   std::vector<vk::Fence> imagesInFlight;
   size_t currentFrame = 0;
 
+  vk::Semaphore frameTimeline;
+  uint64_t frameTimelineValue = 0;
+  std::vector<uint64_t> frameTimelineValues;
+  std::vector<uint64_t> imageTimelineValues;
+
+  SyncStats syncStats;
+  XveProfiler *profiler = nullptr;
+
   vk::Extent2D swapChainExtent;
 
-  void createSwapChain();
+  void createSwapChain(vk::Extent2D extent);
   void createImageViews();
-  void createDepthResources();
+  void createFrameAttachments();
   void createRenderPass();
   void createFramebuffers();
   void createSyncObjects();
+  void ensureFramebuffers();
+  void retireSwapChainResources();
+  void waitForTimeline(uint64_t value);
+  void recordWait(double waitMs);
 
 public:
   vk::Extent2D getSwapChainExtent() const { return swapChainExtent; }
-  vk::RenderPass getRenderPass() const { return renderPass; }
-  vk::Framebuffer getFramebuffer(size_t i) const {
-    return swapChainFramebuffers[i];
+  vk::Extent2D getExtent() const override { return swapChainExtent; }
+  vk::RenderPass getRenderPass() const override { return renderPass; }
+  vk::Framebuffer getFramebuffer(size_t imageIndex,
+                                 size_t frameIndex) const override {
+    return attachmentsPerImage
+               ? swapChainFramebuffers[imageIndex]
+               : swapChainFramebuffers[imageIndex * framesInFlight +
+                                       frameIndex];
+  }
+  bool usesDynamicRendering() const override { return dynamicRendering; }
+  vk::Format getColorFormat() const override {
+    return static_cast<vk::Format>(bSwapChain.image_format);
+  }
+  vk::Format getDepthFormat() const override {
+    return frameAttachments.getDepthFormat();
+  }
+  vk::SampleCountFlagBits getSampleCount() const override {
+    return frameAttachments.getSampleCount();
+  }
+  MemoryUsage getMemoryUsage() const override;
+  vk::Image getColorImage(size_t i) const override {
+    return swapChainImages[i];
+  }
+  vk::ImageView getColorImageView(size_t i) const override {
+    return swapChainImageViews[i];
+  }
+  vk::ImageLayout getFinalColorLayout() const override {
+    return vk::ImageLayout::ePresentSrcKHR;
   }
   uint32_t imageCount() const { return bSwapChain.image_count; }
-
-  vk::Format findDepthFormat() {
-    return device.findSupportedFormat(
-        {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint,
-         vk::Format::eD24UnormS8Uint},
-        vk::ImageTiling::eOptimal,
-        vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+  uint32_t getFramesInFlight() const override { return framesInFlight; }
+  XveSyncMode getSyncMode() const { return syncMode; }
+  vk::PresentModeKHR getPresentMode() const {
+    return static_cast<vk::PresentModeKHR>(bSwapChain.present_mode);
   }
+  const SyncStats &getSyncStats() const override { return syncStats; }
+  std::string describe() const override;
+  void setProfiler(XveProfiler *profiler_) override { profiler = profiler_; }
+  uint32_t getCurrentFrame() const override {
+    return static_cast<uint32_t>(currentFrame);
+  }
+
+  XveSwapChain(XveDevice &deviceRef, vk::Extent2D windowExtent,
+               const XveSwapChainConfig &config = {});
+  ~XveSwapChain() override;
 
-  XveSwapChain(XveDevice &deviceRef, vk::Extent2D windowExtent);
-  ~XveSwapChain();
+  /// Rebuilds the swapchain for `extent`, handing the old one to the driver
+  /// as oldSwapchain. Old images, views, attachments and framebuffers are
+  /// destroyed once the frames that used them have finished, not by
+  /// idling the device.
+  void recreate(vk::Extent2D extent) override;
+
+  /// Destroys `deleter`'s objects after every frame submitted so far is done.
+  void deferDestroy(std::function<void()> deleter) {
+    deletionQueue.push(submittedFrames, std::move(deleter));
+  }
 
-  vk::Result acquireNextImage(uint32_t *imageIndex);
+  vk::Result acquireNextImage(uint32_t *imageIndex) override;
   vk::Result submitCommandBuffers(const vk::CommandBuffer *buffers,
-                                  uint32_t *imageIndex);
+                                  uint32_t *imageIndex) override;
 };
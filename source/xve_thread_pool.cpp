@@ -0,0 +1,44 @@
+#include "xve_thread_pool.hpp"
+
+#include <algorithm>
+
+XveThreadPool::XveThreadPool(uint32_t threadCount) {
+  threadCount = std::max(threadCount, 1u);
+  workers.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+XveThreadPool::~XveThreadPool() {
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+uint32_t XveThreadPool::defaultThreadCount() {
+  auto hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void XveThreadPool::workerLoop() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock{mutex};
+      condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      // Drain remaining work before exiting so no future is left broken.
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
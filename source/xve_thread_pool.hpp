@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Fixed-size pool of worker threads consuming a FIFO task queue.
+class XveThreadPool {
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+
+  void workerLoop();
+
+public:
+  explicit XveThreadPool(uint32_t threadCount = defaultThreadCount());
+  ~XveThreadPool();
+
+  XveThreadPool(const XveThreadPool &) = delete;
+  XveThreadPool &operator=(const XveThreadPool &) = delete;
+
+  /// One worker per hardware thread, leaving one for the caller.
+  static uint32_t defaultThreadCount();
+
+  uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+  template <class F>
+  auto submit(F &&function) -> std::future<std::invoke_result_t<F>> {
+    using Result = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<F>(function));
+    auto future = task->get_future();
+    {
+      std::lock_guard lock{mutex};
+      tasks.emplace_back([task]() { (*task)(); });
+    }
+    condition.notify_one();
+    return future;
+  }
+};
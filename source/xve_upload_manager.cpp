@@ -0,0 +1,265 @@
+#include "xve_upload_manager.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+XveUploadManager::XveUploadManager(XveDevice &deviceRef,
+                                   vk::DeviceSize stagingSize_)
+    : device(deviceRef), stagingSize(stagingSize_) {
+  device.createBuffer(stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+                      vk::MemoryPropertyFlagBits::eHostVisible |
+                          vk::MemoryPropertyFlagBits::eHostCoherent,
+                      stagingBuffer, stagingAllocation,
+                      XveMemoryCategory::Staging);
+
+  log(LogLevel::Info, "Staging ring: {} KiB, uploading on {} queue",
+      stagingSize / 1024,
+      device.hasTransferQueue() ? "dedicated transfer" : "graphics");
+}
+
+XveUploadManager::~XveUploadManager() {
+  waitIdle();
+
+  // The pools belong to the device, so hand the command buffers back.
+  for (auto &batch : freeBatches) {
+    device.getDevice().freeCommandBuffers(device.getTransferCommandPool(), 1,
+                                          &batch.commandBuffer);
+    if (batch.acquireCommandBuffer) {
+      device.getDevice().freeCommandBuffers(device.getCommandPool(), 1,
+                                            &batch.acquireCommandBuffer);
+    }
+    device.getDevice().destroyFence(batch.fence);
+    device.getDevice().destroySemaphore(batch.semaphore);
+  }
+  device.destroyBuffer(stagingBuffer, stagingAllocation);
+}
+
+void XveUploadManager::createDeviceLocalBuffer(
+    const void *data, vk::DeviceSize size, vk::BufferUsageFlags usage,
+    vk::Buffer &buffer, XveAllocation &bufferAllocation,
+    XveMemoryCategory category) {
+  device.createBuffer(size, usage | vk::BufferUsageFlagBits::eTransferDst,
+                      vk::MemoryPropertyFlagBits::eDeviceLocal, buffer,
+                      bufferAllocation, category);
+
+  enqueue(buffer, 0, data, size);
+  // Added only once every chunk is enqueued: a flush forced by a full ring
+  // in between must leave the buffer with the transfer family.
+  if (device.hasTransferQueue()) {
+    pendingOwnershipTransfers.push_back(buffer);
+  }
+}
+
+void XveUploadManager::enqueue(vk::Buffer dst, vk::DeviceSize dstOffset,
+                               const void *data, vk::DeviceSize size) {
+  // Large uploads are split so a single mesh can't monopolize the ring.
+  auto maxChunk = stagingSize / 4;
+  auto bytes = static_cast<const char *>(data);
+
+  while (size > 0) {
+    auto chunk = std::min(size, maxChunk);
+    auto stagingOffset = reserveStaging(chunk);
+
+    std::memcpy(static_cast<char *>(stagingAllocation.mappedData) +
+                    stagingOffset,
+                bytes, static_cast<size_t>(chunk));
+    pendingCopies[static_cast<VkBuffer>(dst)].push_back(
+        vk::BufferCopy{stagingOffset, dstOffset, chunk});
+
+    stats.bytesUploaded += chunk;
+    stats.copyCount++;
+
+    bytes += chunk;
+    dstOffset += chunk;
+    size -= chunk;
+  }
+}
+
+vk::DeviceSize XveUploadManager::reserveStaging(vk::DeviceSize size) {
+  size = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+  assert(size <= stagingSize && "Upload chunk larger than staging ring");
+
+  for (;;) {
+    // A reservation never straddles the end of the ring: the tail is
+    // skipped and charged to the current batch instead.
+    auto wrapWaste = ringHead + size > stagingSize ? stagingSize - ringHead : 0;
+    if (ringUsed + wrapWaste + size <= stagingSize) {
+      if (wrapWaste > 0) {
+        ringHead = 0;
+      }
+      auto offset = ringHead;
+      ringHead = (ringHead + size) % stagingSize;
+      ringUsed += wrapWaste + size;
+      pendingRingBytes += wrapWaste + size;
+      return offset;
+    }
+
+    stats.stallCount++;
+    if (inFlight.empty()) {
+      flush();
+    }
+    retireOldest();
+  }
+}
+
+XveUploadManager::Batch XveUploadManager::acquireBatch() {
+  if (!freeBatches.empty()) {
+    auto batch = freeBatches.back();
+    freeBatches.pop_back();
+    return batch;
+  }
+
+  auto allocInfo = vk::CommandBufferAllocateInfo{
+      device.getTransferCommandPool(),
+      vk::CommandBufferLevel::ePrimary,
+      1,
+  };
+
+  Batch batch{};
+  try {
+    batch.commandBuffer =
+        device.getDevice().allocateCommandBuffers(allocInfo).front();
+    batch.fence = device.getDevice().createFence(vk::FenceCreateInfo{});
+    if (device.hasTransferQueue()) {
+      allocInfo.commandPool = device.getCommandPool();
+      batch.acquireCommandBuffer =
+          device.getDevice().allocateCommandBuffers(allocInfo).front();
+      batch.semaphore =
+          device.getDevice().createSemaphore(vk::SemaphoreCreateInfo{});
+    }
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(std::format(
+        "Failed to create upload command buffer. Error: {}", e.what()));
+  }
+  return batch;
+}
+
+uint64_t XveUploadManager::flush() {
+  if (pendingCopies.empty()) {
+    return nextTicket - 1;
+  }
+
+  auto batch = acquireBatch();
+  batch.ticket = nextTicket++;
+  batch.ringBytes = pendingRingBytes;
+  pendingRingBytes = 0;
+
+  // Release and acquire barriers must name the same buffers and families.
+  std::vector<vk::BufferMemoryBarrier> releases;
+  std::vector<vk::BufferMemoryBarrier> acquires;
+  for (auto buffer : pendingOwnershipTransfers) {
+    auto barrier = vk::BufferMemoryBarrier{
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlags(),
+        device.getTransferQueueFamily(),
+        device.getGraphicsQueueFamily(),
+        buffer,
+        0,
+        vk::WholeSize,
+    };
+    releases.push_back(barrier);
+    barrier.srcAccessMask = vk::AccessFlags();
+    barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+    acquires.push_back(barrier);
+  }
+  pendingOwnershipTransfers.clear();
+
+  auto beginInfo = vk::CommandBufferBeginInfo{
+      vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+  auto cmd = batch.commandBuffer;
+  cmd.begin(beginInfo);
+  for (auto &[dst, regions] : pendingCopies) {
+    cmd.copyBuffer(stagingBuffer, vk::Buffer{dst}, regions);
+  }
+  if (!releases.empty()) {
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eBottomOfPipe,
+                        vk::DependencyFlags(), {}, releases, {});
+  } else if (!device.hasTransferQueue()) {
+    // Copies share the queue with rendering, so a barrier is enough to make
+    // them visible to later submissions.
+    auto barrier = vk::MemoryBarrier{vk::AccessFlagBits::eTransferWrite,
+                                     vk::AccessFlagBits::eMemoryRead};
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eAllCommands,
+                        vk::DependencyFlags(), barrier, {}, {});
+  }
+  cmd.end();
+  pendingCopies.clear();
+
+  vk::SubmitInfo submitInfo = {};
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cmd;
+
+  try {
+    if (!device.hasTransferQueue()) {
+      device.getTransferQueue().submit(1, &submitInfo, batch.fence);
+    } else {
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = &batch.semaphore;
+      device.getTransferQueue().submit(1, &submitInfo, nullptr);
+
+      // The semaphore wait makes every copy visible to later graphics work,
+      // including those into concurrently shared buffers; exclusive ones
+      // additionally need the acquire.
+      auto acquireCmd = batch.acquireCommandBuffer;
+      if (!acquires.empty()) {
+        acquireCmd.begin(beginInfo);
+        acquireCmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                                   vk::PipelineStageFlagBits::eAllCommands,
+                                   vk::DependencyFlags(), {}, acquires, {});
+        acquireCmd.end();
+      }
+      vk::PipelineStageFlags waitStage =
+          vk::PipelineStageFlagBits::eAllCommands;
+      vk::SubmitInfo acquireInfo = {};
+      acquireInfo.waitSemaphoreCount = 1;
+      acquireInfo.pWaitSemaphores = &batch.semaphore;
+      acquireInfo.pWaitDstStageMask = &waitStage;
+      acquireInfo.commandBufferCount = acquires.empty() ? 0 : 1;
+      acquireInfo.pCommandBuffers = &acquireCmd;
+      device.getGraphicsQueue().submit(1, &acquireInfo, batch.fence);
+    }
+  } catch (const vk::SystemError &e) {
+    throw std::runtime_error(
+        std::format("Failed to submit upload batch. Error: {}", e.what()));
+  }
+
+  stats.batchCount++;
+  inFlight.push_back(batch);
+  return batch.ticket;
+}
+
+void XveUploadManager::retireOldest() {
+  auto batch = inFlight.front();
+  inFlight.pop_front();
+
+  device.getDevice().waitForFences(1, &batch.fence, vk::True,
+                                   std::numeric_limits<uint64_t>::max());
+  device.getDevice().resetFences(1, &batch.fence);
+
+  ringUsed -= batch.ringBytes;
+  if (ringUsed == 0) {
+    ringHead = 0;
+  }
+  completedTicket = batch.ticket;
+  freeBatches.push_back(batch);
+}
+
+void XveUploadManager::wait(uint64_t ticket) {
+  if (ticket >= nextTicket) {
+    flush();
+  }
+  while (completedTicket < ticket && !inFlight.empty()) {
+    retireOldest();
+  }
+}
+
+void XveUploadManager::waitIdle() {
+  flush();
+  while (!inFlight.empty()) {
+    retireOldest();
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "logger.hpp"
+#include "xve_device.hpp"
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+/// Streams data into device-local buffers through a persistently mapped,
+/// ring-buffered staging buffer. Uploads are batched: every copy enqueued
+/// between two flush() calls goes out as a single submission on the transfer
+/// queue (or the graphics queue when the device has no separate one).
+///
+/// With a separate transfer queue, each batch signals a semaphore that the
+/// graphics queue waits on in a small follow-up submission, which also
+/// acquires ownership of buffers made by createDeviceLocalBuffer(). Copies
+/// thus overlap with frames already queued, while anything submitted to the
+/// graphics queue after flush() sees the data without a CPU wait.
+///
+/// Not thread-safe; uploads are expected from the thread that owns the
+/// manager.
+class XveUploadManager : Logger {
+public:
+  static constexpr vk::DeviceSize DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+
+  struct Stats {
+    uint64_t bytesUploaded = 0;
+    uint64_t copyCount = 0;
+    uint64_t batchCount = 0;
+    uint64_t stallCount = 0;
+  };
+
+  XveUploadManager(XveDevice &deviceRef,
+                   vk::DeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+  ~XveUploadManager();
+
+  XveUploadManager(const XveUploadManager &) = delete;
+  XveUploadManager &operator=(const XveUploadManager &) = delete;
+
+  /// Creates a DEVICE_LOCAL buffer owned by the graphics queue family and
+  /// queues `data` to be copied into it on the next flush(). The buffer
+  /// uses exclusive sharing; ownership passes from the transfer family in
+  /// that flush.
+  void createDeviceLocalBuffer(const void *data, vk::DeviceSize size,
+                               vk::BufferUsageFlags usage, vk::Buffer &buffer,
+                               XveAllocation &bufferAllocation,
+                               XveMemoryCategory category =
+                                   XveMemoryCategory::Geometry);
+
+  /// Copies `data` into staging memory right away and records a copy into
+  /// `dst` for the next flush(). The caller's memory may be reused on return.
+  void enqueue(vk::Buffer dst, vk::DeviceSize dstOffset, const void *data,
+               vk::DeviceSize size);
+
+  /// Submits all pending copies as one batch. Returns a ticket for wait().
+  uint64_t flush();
+  void wait(uint64_t ticket);
+  void waitIdle();
+
+  Stats getStats() const { return stats; }
+
+private:
+  static constexpr vk::DeviceSize STAGING_ALIGNMENT = 16;
+
+  struct Batch {
+    uint64_t ticket;
+    vk::CommandBuffer commandBuffer;
+    // Only with a separate transfer queue: recorded on the graphics queue,
+    // waiting for `semaphore` from the copies.
+    vk::CommandBuffer acquireCommandBuffer;
+    vk::Semaphore semaphore;
+    // Signaled by the batch's last submission.
+    vk::Fence fence;
+    vk::DeviceSize ringBytes;
+  };
+
+  XveDevice &device;
+
+  vk::Buffer stagingBuffer;
+  XveAllocation stagingAllocation;
+  vk::DeviceSize stagingSize;
+  vk::DeviceSize ringHead = 0;
+  vk::DeviceSize ringUsed = 0;
+  vk::DeviceSize pendingRingBytes = 0;
+
+  std::unordered_map<VkBuffer, std::vector<vk::BufferCopy>> pendingCopies;
+  // Complete buffers to hand to the graphics family in the next flush().
+  std::vector<vk::Buffer> pendingOwnershipTransfers;
+  std::deque<Batch> inFlight;
+  std::vector<Batch> freeBatches;
+  uint64_t nextTicket = 1;
+  uint64_t completedTicket = 0;
+
+  Stats stats;
+
+  vk::DeviceSize reserveStaging(vk::DeviceSize size);
+  void retireOldest();
+  Batch acquireBatch();
+};
@@ -46,4 +46,18 @@ public:
         static_cast<uint32_t>(h),
     };
   }
+
+  /// Drawable size in pixels; differs from getExtent2D() on high-DPI displays.
+  vk::Extent2D getPixelExtent2D() {
+    int w, h;
+    SDL_GetWindowSizeInPixels(window, &w, &h);
+    return vk::Extent2D{
+        static_cast<uint32_t>(w),
+        static_cast<uint32_t>(h),
+    };
+  }
+
+  bool isMinimized() const {
+    return (SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED) != 0;
+  }
 };
@@ -0,0 +1,222 @@
+// Renders a binary log written by Logger::openBinaryLog() as text:
+//   xve_log_decode log.bin [out.txt]
+
+#include "logger.hpp"
+#include "xve_binary_log.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+using Arg = std::variant<bool, char, int64_t, uint64_t, double, std::string,
+                         const void *>;
+
+struct Message {
+  LogLevel level;
+  uint32_t formatId;
+  uint32_t nameId;
+  uint64_t timeNs;
+  std::vector<Arg> args;
+};
+
+class Reader {
+private:
+  std::string_view data;
+  size_t offset = 0;
+
+public:
+  explicit Reader(std::string_view data) : data(data) {}
+
+  bool done() const { return offset >= data.size(); }
+
+  template <class T> T get() {
+    if (offset + sizeof(T) > data.size()) {
+      throw std::runtime_error("Truncated record");
+    }
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+  }
+
+  std::string_view getBytes(size_t size) {
+    if (offset + size > data.size()) {
+      throw std::runtime_error("Truncated record");
+    }
+    auto bytes = data.substr(offset, size);
+    offset += size;
+    return bytes;
+  }
+
+  std::string getString() { return std::string{getBytes(get<uint32_t>())}; }
+};
+
+static Arg readArg(Reader &reader) {
+  using Type = XveBinaryLog::ArgType;
+  switch (reader.get<Type>()) {
+  case Type::Bool:
+    return reader.get<uint8_t>() != 0;
+  case Type::Char:
+    return reader.get<char>();
+  case Type::Int:
+    return reader.get<int64_t>();
+  case Type::Uint:
+    return reader.get<uint64_t>();
+  case Type::Float:
+    return reader.get<double>();
+  case Type::String:
+    return reader.getString();
+  case Type::Pointer:
+    return reinterpret_cast<const void *>(
+        static_cast<uintptr_t>(reader.get<uint64_t>()));
+  }
+  throw std::runtime_error("Unknown argument type");
+}
+
+/// Formats one argument with the replacement field's spec, e.g. ".3f".
+static std::string formatArg(const Arg &arg, std::string_view spec) {
+  auto fmt = std::string{"{:"} + std::string{spec} + "}";
+  return std::visit(
+      [&fmt](const auto &value) {
+        try {
+          return std::vformat(fmt, std::make_format_args(value));
+        } catch (const std::format_error &) {
+          return std::format("{}", value);
+        }
+      },
+      arg);
+}
+
+/// Substitutes {}, {n} and {n:spec} fields the same way std::vformat would.
+static std::string render(std::string_view fmt, const std::vector<Arg> &args) {
+  std::string result;
+  size_t nextArg = 0;
+  for (size_t i = 0; i < fmt.size(); i++) {
+    char c = fmt[i];
+    if (c == '}' && i + 1 < fmt.size() && fmt[i + 1] == '}') {
+      result.push_back('}');
+      i++;
+      continue;
+    }
+    if (c != '{') {
+      result.push_back(c);
+      continue;
+    }
+    if (i + 1 < fmt.size() && fmt[i + 1] == '{') {
+      result.push_back('{');
+      i++;
+      continue;
+    }
+
+    auto close = fmt.find('}', i);
+    if (close == std::string_view::npos) {
+      result.append(fmt.substr(i));
+      break;
+    }
+    auto field = fmt.substr(i + 1, close - i - 1);
+    auto colon = field.find(':');
+    auto index = field.substr(0, colon);
+    auto spec = colon == std::string_view::npos ? std::string_view{}
+                                                : field.substr(colon + 1);
+
+    // A non-numeric index renders like an out-of-range one.
+    size_t argIndex = nextArg;
+    bool parsed = true;
+    if (index.empty()) {
+      nextArg++;
+    } else {
+      auto end = index.data() + index.size();
+      auto [ptr, error] = std::from_chars(index.data(), end, argIndex);
+      parsed = error == std::errc{} && ptr == end;
+    }
+    if (parsed && argIndex < args.size()) {
+      result.append(formatArg(args[argIndex], spec));
+    } else {
+      result.append("{?}");
+    }
+    i = close;
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <log.bin> [out.txt]\n";
+    return 1;
+  }
+
+  std::ifstream file{argv[1], std::ios::binary};
+  if (!file.is_open()) {
+    std::cerr << "Failed to open " << argv[1] << "\n";
+    return 1;
+  }
+  std::string data{std::istreambuf_iterator<char>(file), {}};
+
+  std::ofstream outFile;
+  if (argc >= 3) {
+    outFile.open(argv[2]);
+  }
+  std::ostream &out = outFile.is_open() ? outFile : std::cout;
+
+  std::map<uint32_t, std::string> formatStrings;
+  std::map<uint32_t, std::string> names;
+  std::vector<Message> messages;
+
+  try {
+    Reader reader{data};
+    auto magic = reader.getBytes(sizeof(XveBinaryLog::MAGIC));
+    if (std::memcmp(magic.data(), XveBinaryLog::MAGIC, magic.size()) != 0 ||
+        reader.get<uint32_t>() != XveBinaryLog::VERSION) {
+      std::cerr << argv[1] << " is not a version "
+                << XveBinaryLog::VERSION << " binary log\n";
+      return 1;
+    }
+    auto startNs = reader.get<uint64_t>();
+
+    // Definitions can trail the messages that use them, so everything is
+    // read before anything is rendered.
+    while (!reader.done()) {
+      Reader record{reader.getBytes(reader.get<uint32_t>())};
+      switch (record.get<XveBinaryLog::RecordKind>()) {
+      case XveBinaryLog::RecordKind::FormatString: {
+        auto id = record.get<uint32_t>();
+        formatStrings[id] = record.getString();
+        break;
+      }
+      case XveBinaryLog::RecordKind::Name: {
+        auto id = record.get<uint32_t>();
+        names[id] = record.getString();
+        break;
+      }
+      case XveBinaryLog::RecordKind::Message: {
+        Message message{};
+        message.level = static_cast<LogLevel>(record.get<uint8_t>());
+        message.formatId = record.get<uint32_t>();
+        message.nameId = record.get<uint32_t>();
+        message.timeNs = record.get<uint64_t>() - startNs;
+        auto argCount = record.get<uint8_t>();
+        for (uint8_t i = 0; i < argCount; i++) {
+          message.args.push_back(readArg(record));
+        }
+        messages.push_back(std::move(message));
+        break;
+      }
+      }
+    }
+  } catch (const std::exception &e) {
+    // A crash can cut the last record short; keep what was read.
+    std::cerr << "Stopped reading: " << e.what() << "\n";
+  }
+
+  for (auto &message : messages) {
+    out << std::format("{:12.6f} [{}][{}]: {}\n", message.timeNs / 1e9,
+                       logLevelToString(message.level), names[message.nameId],
+                       render(formatStrings[message.formatId], message.args));
+  }
+  return 0;
+}